@@ -0,0 +1,103 @@
+/**
+ * @file BrickVoxelStorage.h
+ * @brief Sparse storage of the voxels in the effector boundaries bitmap.
+ *
+ * @section LICENSE
+ * License: newBSD
+ *  
+ * Copyright © 2012, HU University of Applied Sciences Utrecht.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **/
+
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <rexos_delta_robot/VoxelStorage.h>
+
+namespace rexos_delta_robot{
+	/**
+	 * Stores the voxels in bricks of 8x8x8 voxels. Bricks in which all voxels have the same value are stored as a single value, only the bricks on the edge of the valid area are stored as bits. Since the valid area is one solid volume, this uses a fraction of the memory of a DenseVoxelStorage for small voxel sizes.
+	 **/
+	class BrickVoxelStorage : public VoxelStorage{
+	public:
+		BrickVoxelStorage(const VoxelStorage& source, int width, int depth, int height);
+
+		bool get(int index) const;
+		void set(int index, bool value);
+		size_t getMemoryUsage() const;
+
+	private:
+		/**
+		 * @var int BRICK_SIZE
+		 * The amount of voxels on a side of a brick. A brick holds one word for every z layer, each word holds the 8x8 voxels of that layer.
+		 **/
+		static const int BRICK_SIZE = 8;
+
+		/**
+		 * Values of a brick in the bricks list which is not stored as bits. Other values are the position of the first word of the brick in the brickWords list.
+		 **/
+		enum brickEntry{
+			ALL_INVALID = -1,
+			ALL_VALID = -2
+		};
+
+		/**
+		 * @var int width
+		 * The width of the bitmap in voxels.
+		 **/
+		int width;
+
+		/**
+		 * @var int depth
+		 * The depth of the bitmap in voxels.
+		 **/
+		int depth;
+
+		/**
+		 * @var int height
+		 * The height of the bitmap in voxels.
+		 **/
+		int height;
+
+		/**
+		 * @var int bricksWide
+		 * The amount of bricks along the x axis.
+		 **/
+		int bricksWide;
+
+		/**
+		 * @var int bricksDeep
+		 * The amount of bricks along the y axis.
+		 **/
+		int bricksDeep;
+
+		/**
+		 * @var std::vector<int32_t> bricks
+		 * For every brick either ALL_INVALID, ALL_VALID or the position of its words in brickWords.
+		 **/
+		std::vector<int32_t> bricks;
+
+		/**
+		 * @var std::vector<uint64_t> brickWords
+		 * The words of all bricks that are stored as bits, BRICK_SIZE words per brick.
+		 **/
+		std::vector<uint64_t> brickWords;
+	};
+}
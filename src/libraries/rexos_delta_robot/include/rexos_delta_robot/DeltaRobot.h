@@ -32,6 +32,8 @@
 
 #pragma once
 
+#include <string>
+#include <vector>
 #include <modbus/modbus.h>
 #include <rexos_datatypes/Point3D.h>
 #include <rexos_datatypes/DeltaRobotMeasures.h>
@@ -39,6 +41,10 @@
 #include <rexos_motor/StepperMotor.h>
 #include <rexos_motor/MotorManager.h>
 #include <rexos_delta_robot/EffectorBoundaries.h>
+#include <rexos_delta_robot/ForwardKinematics.h>
+#include <rexos_delta_robot/InverseKinematicsLookupTable.h>
+#include <rexos_delta_robot/Measures.h>
+#include <rexos_delta_robot/TrajectoryPlanner.h>
 
 namespace rexos_delta_robot{
 	class InverseKinematicsModel;
@@ -47,6 +53,50 @@ namespace rexos_delta_robot{
 	 **/
 	class DeltaRobot{
 	public:
+		/**
+		 * A motion that has been planned but not yet queued.
+		 **/
+		struct PlannedMotion{
+			/**
+			 * @var Point3D<double> point
+			 * The point the motion moves the effector to.
+			 **/
+			rexos_datatypes::Point3D<double> point;
+
+			/**
+			 * @var MotorRotation rotations[3]
+			 * The rotations of the three motors.
+			 **/
+			rexos_datatypes::MotorRotation rotations[3];
+
+			/**
+			 * @var double maxAcceleration
+			 * The acceleration in radians/s² that the motor with the biggest motion accelerates at.
+			 **/
+			double maxAcceleration;
+
+			/**
+			 * @var double duration
+			 * The time in seconds the motion takes, or 0 if none of the motors have to move.
+			 **/
+			double duration;
+		};
+
+		/**
+		 * The way the effector moves between two points.
+		 **/
+		enum InterpolationMode{
+			/**
+			 * The motors move straight from their start angle to their end angle, the effector follows a curve.
+			 **/
+			JOINT,
+			/**
+			 * The effector follows a straight line, within the maximum chordal error.
+			 * The line is split into joint motions that are run as linked motions where the motors allow it, so the effector only stops where a motor changes direction.
+			 **/
+			LINEAR
+		};
+
 		DeltaRobot(rexos_datatypes::DeltaRobotMeasures& deltaRobotMeasures, rexos_motor::MotorManager* motorManager, rexos_motor::StepperMotor* (&motors)[3], modbus_t* modbusIO);
 		~DeltaRobot();
 
@@ -63,9 +113,23 @@ namespace rexos_delta_robot{
 		inline bool hasBoundaries(){ return boundariesGenerated; }
 
 		void generateBoundaries(double voxelSize);
-		bool checkPath(const rexos_datatypes::Point3D<double>& begin, const rexos_datatypes::Point3D<double>& end);
+		void generateBoundaries(double voxelSize, const std::string& cacheDirectory, EffectorBoundaries::StorageType storageType = EffectorBoundaries::DENSE, bool sharedMemory = false);
+		void generateKinematicsLookupTable(double voxelSize, double maxError = Measures::KINEMATICS_TOLERANCE);
+		void setMotorLimits(double motorMinAngles[3], double motorMaxAngles[3]);
+		bool checkPath(const rexos_datatypes::Point3D<double>& begin, const rexos_datatypes::Point3D<double>& end, double effectorRadius = 0);
+		int checkPolyline(const rexos_datatypes::Point3D<double>* points, int numberOfPoints, double effectorRadius = 0);
+
+		/**
+		 * Gets the interpolation mode used by moveTo.
+		 * @return The interpolation mode.
+		 **/
+		inline InterpolationMode getInterpolationMode(){ return interpolationMode; }
+		void setInterpolationMode(InterpolationMode interpolationMode, double maxChordalError = Measures::LINEAR_MAX_CHORDAL_ERROR);
 
+		double planMotion(const rexos_datatypes::Point3D<double>& point, double maxAcceleration, rexos_datatypes::MotorRotation (&rotations)[3]);
 		void moveTo(const rexos_datatypes::Point3D<double>& point, double maxAcceleration);
+		void moveAlongTrajectory(TrajectoryPlanner& trajectoryPlanner);
+		void waitForMotions(void);
 		void calibrateMotor(int motorIndex);
 		bool checkSensor(int sensorIndex);
 		bool calibrateMotors();
@@ -80,6 +144,30 @@ namespace rexos_delta_robot{
 		 **/
 		InverseKinematicsModel* kinematics;
 
+		/**
+		 * @var InverseKinematicsLookupTable* kinematicsLookupTable
+		 * A pointer to the lookup table that speeds up the kinematics model for motions, or NULL if it is not generated.
+		 **/
+		InverseKinematicsLookupTable* kinematicsLookupTable;
+
+		/**
+		 * @var InverseKinematicsModel* motionKinematics
+		 * A pointer to the kinematics model used for motions, either the kinematics lookup table or the kinematics model itself.
+		 **/
+		InverseKinematicsModel* motionKinematics;
+
+		/**
+		 * @var double kinematicsTolerance
+		 * The maximum distance in millimeters between a destination point and the location its motor angles lead to.
+		 **/
+		double kinematicsTolerance;
+
+		/**
+		 * @var ForwardKinematics* forwardKinematics
+		 * A pointer to the forward kinematics used to verify the motor angles calculated by the kinematics model.
+		 **/
+		ForwardKinematics* forwardKinematics;
+
 		/**
 		 * @var StepperMotor* motors
 		 * An array holding pointers to the three StepperMotors that are connected to the DeltaRobot. This array HAS to be of size 3.
@@ -100,10 +188,16 @@ namespace rexos_delta_robot{
 
 		/**
 		 * @var Point3D<double> effectorLocation
-		 * A 3D point in doubles that points to the location of the effector.
+		 * A 3D point in doubles that points to the location of the effector, at the end of the last motion that has finished.
 		 **/
 		rexos_datatypes::Point3D<double> effectorLocation;
 
+		/**
+		 * @var Point3D<double> plannedEffectorLocation
+		 * The location of the effector at the end of the last queued motion. The next motion is planned from here.
+		 **/
+		rexos_datatypes::Point3D<double> plannedEffectorLocation;
+
 		/**
 		 * @var bool boundariesGenerated
 		 * A boolean indicating whether the EffectorBoundaries have been generated or not.
@@ -118,13 +212,41 @@ namespace rexos_delta_robot{
 
 		/**
 		 * @var int currentMotionSlot
-		 * The motion slot currently in use. The deltarobot switches between these slots when moving.
+		 * The first motion slot of the group of CRD514KD::LINKED_MOTIONS_MAX slots currently in use. The deltarobot switches between these groups when moving.
 		 **/
 		int currentMotionSlot;
 
+		/**
+		 * @var boost::shared_future<void> motionCompletions[rexos_motor::CRD514KD::MOTION_SLOTS_USED]
+		 * For every motion slot, the completion of the motion that was last started from it. Only the first slot of a group is started from. The slots of a group are not overwritten before its motion has finished.
+		 **/
+		boost::shared_future<void> motionCompletions[rexos_motor::CRD514KD::MOTION_SLOTS_USED];
+
+		/**
+		 * @var Point3D<double> motionPoints[rexos_motor::CRD514KD::MOTION_SLOTS_USED]
+		 * For every motion slot, the effector location at the end of the motion that was last started from it.
+		 **/
+		rexos_datatypes::Point3D<double> motionPoints[rexos_motor::CRD514KD::MOTION_SLOTS_USED];
+
+		/**
+		 * @var InterpolationMode interpolationMode
+		 * The way the effector moves between two points.
+		 **/
+		InterpolationMode interpolationMode;
+
+		/**
+		 * @var double maxChordalError
+		 * The maximum distance in millimeters the effector may deviate from a straight line in linear interpolation mode.
+		 **/
+		double maxChordalError;
+
+		double planMotion(const rexos_datatypes::Point3D<double>& from, const double (&fromAngles)[3], const rexos_datatypes::Point3D<double>& point, double maxAcceleration, rexos_datatypes::MotorRotation (&rotations)[3]);
+		void planMotions(const rexos_datatypes::Point3D<double>& point, double maxAcceleration, std::vector<PlannedMotion>& motions);
+		void queueMotions(std::vector<PlannedMotion>& motions, bool all);
+		int queueLinkedMotion(PlannedMotion* motions, int numberOfMotions);
+		void finishMotion(int slotIndex);
+		void subdivideLine(const rexos_datatypes::Point3D<double>& from, const double (&fromAngles)[3], const rexos_datatypes::Point3D<double>& to, const double (&toAngles)[3], int depth, std::vector<rexos_datatypes::Point3D<double> >& points);
 		bool isValidAngle(int motorIndex, double angle);
 		int moveMotorUntilSensorIsOfValue(int motorIndex, rexos_datatypes::MotorRotation motorRotation, bool sensorValue);
-		double getSpeedForRotation(double relativeAngle, double moveTime, double acceleration);
-		double getAccelerationForRotation(double relativeAngle, double moveTime);
 	};
 }
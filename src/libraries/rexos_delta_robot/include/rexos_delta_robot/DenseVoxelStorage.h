@@ -0,0 +1,82 @@
+/**
+ * @file DenseVoxelStorage.h
+ * @brief Bit-packed storage of all voxels in the effector boundaries bitmap.
+ *
+ * @section LICENSE
+ * License: newBSD
+ *  
+ * Copyright © 2012, HU University of Applied Sciences Utrecht.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **/
+
+#pragma once
+
+#include <stdint.h>
+#include <rexos_delta_robot/VoxelStorage.h>
+
+namespace rexos_delta_robot{
+	/**
+	 * Stores every voxel as a single bit, 64 voxels per word. A voxel at index i is bit i % 64 of word i / 64.
+	 **/
+	class DenseVoxelStorage : public VoxelStorage{
+	public:
+		DenseVoxelStorage(int numberOfVoxels);
+		DenseVoxelStorage(uint64_t* words, int numberOfVoxels);
+		~DenseVoxelStorage();
+
+		bool get(int index) const;
+		void set(int index, bool value);
+		size_t getMemoryUsage() const;
+
+		/**
+		 * Gets the words holding the voxels.
+		 * 
+		 * @return Pointer to the first of getNumberOfWords(numberOfVoxels) words.
+		 **/
+		inline const uint64_t* getWords() const{ return words; }
+
+		/**
+		 * Calculates the amount of words needed to store the voxels.
+		 * 
+		 * @param numberOfVoxels The amount of voxels.
+		 * 
+		 * @return The amount of words.
+		 **/
+		static inline int getNumberOfWords(int numberOfVoxels){ return (numberOfVoxels + 63) / 64; }
+
+	private:
+		/**
+		 * @var uint64_t* words
+		 * The words holding the voxels.
+		 **/
+		uint64_t* words;
+
+		/**
+		 * @var int numberOfVoxels
+		 * The amount of voxels in the storage.
+		 **/
+		int numberOfVoxels;
+
+		/**
+		 * @var bool ownsWords
+		 * True if the words were allocated by this object, false if they are owned by someone else (for example a memory mapped file).
+		 **/
+		bool ownsWords;
+	};
+}
@@ -33,25 +33,65 @@
 #pragma once
 
 #include <iostream>
+#include <string>
+#include <stdint.h>
+#include <boost/interprocess/mapped_region.hpp>
 #include <rexos_datatypes/Point3D.h>
 #include <rexos_motor/StepperMotor.h>
 #include <rexos_delta_robot/Measures.h>
 #include <rexos_delta_robot/InverseKinematicsModel.h>
+#include <rexos_delta_robot/VoxelStorage.h>
 #include <vector>
 
 namespace rexos_delta_robot{
 	/**
 	 * This class represents a delta robot's effector work field.
-	 * This work field is stored as a 3D bitmap (bool array).
+	 * This work field is stored as a 3D bitmap (see VoxelStorage).
 	 * Every "pixel" in this map is called a voxel.
 	 **/
 	class EffectorBoundaries{
 	public:
+		/**
+		 * The ways the boundaries bitmap can be stored in memory.
+		 **/
+		enum StorageType{
+			/**
+			 * One bit per voxel (DenseVoxelStorage). Fastest to query.
+			 **/
+			DENSE,
+			/**
+			 * Only the bricks on the edge of the valid area are stored as bits (BrickVoxelStorage). Uses the least memory for small voxel sizes.
+			 * This only lowers the memory used once the boundaries exist: generating them still allocates the dense bitmap and a validity cache of 2 bits per voxel, which are converted to bricks afterwards.
+			 * Loading an effector boundaries file converts from the memory mapped file, so boards with little memory should load the boundaries from a cache file generated beforehand.
+			 **/
+			BRICKS
+		};
+
 		~EffectorBoundaries();
 		
-		static EffectorBoundaries* generateEffectorBoundaries(const InverseKinematicsModel& model, double motorMinAngles[3], double motorMaxAngles[3], double voxelSize);
+		static EffectorBoundaries* generateEffectorBoundaries(const InverseKinematicsModel& model, double motorMinAngles[3], double motorMaxAngles[3], double voxelSize, StorageType storageType = DENSE);
+		static EffectorBoundaries* generateEffectorBoundaries(const InverseKinematicsModel& model, double motorMinAngles[3], double motorMaxAngles[3], double voxelSize, const std::string& cacheDirectory, StorageType storageType = DENSE);
+		static EffectorBoundaries* loadEffectorBoundaries(const InverseKinematicsModel& model, double motorMinAngles[3], double motorMaxAngles[3], double voxelSize, const std::string& fileName, StorageType storageType = DENSE);
+		static EffectorBoundaries* getSharedEffectorBoundaries(const InverseKinematicsModel& model, double motorMinAngles[3], double motorMaxAngles[3], double voxelSize, const std::string& cacheDirectory, StorageType storageType = DENSE);
+		static void removeSharedEffectorBoundaries(const InverseKinematicsModel& model, double motorMinAngles[3], double motorMaxAngles[3], double voxelSize);
+		static uint64_t getGeometryHash(const InverseKinematicsModel& model, double motorMinAngles[3], double motorMaxAngles[3], double voxelSize);
+
+		void saveEffectorBoundaries(const std::string& fileName) const;
+		size_t getMemoryUsage() const;
+		void setMotorLimits(double motorMinAngles[3], double motorMaxAngles[3]);
+
+		void generateDistanceField();
+
+		/**
+		 * Checks whether the distance field has been generated.
+		 * @return True if the distance field has been generated.
+		 **/
+		inline bool hasDistanceField() const{ return !distanceField.empty(); }
+
+		double getClearance(const rexos_datatypes::Point3D<double>& point) const;
 
-		bool checkPath(const rexos_datatypes::Point3D<double>& from, const rexos_datatypes::Point3D<double>& to) const;
+		bool checkPath(const rexos_datatypes::Point3D<double>& from, const rexos_datatypes::Point3D<double>& to, double effectorRadius = 0) const;
+		int checkPolyline(const rexos_datatypes::Point3D<double>* points, int numberOfPoints, double effectorRadius = 0) const;
 
 	private:
 		EffectorBoundaries(const InverseKinematicsModel& model, double motorMinAngles[3], double motormaxAngles[3], double voxelSize);
@@ -88,9 +128,57 @@ namespace rexos_delta_robot{
 			BitmapCoordinate(int x, int y, int z) : x(x), y(y), z(z){}
 		} BitmapCoordinate;
 
-		bool hasInvalidNeighbours(const BitmapCoordinate& coordinate, char* pointValidityCache) const;
-		bool isValid(const BitmapCoordinate& coordinate, char* pointValidityCache) const;
+		void checkSegmentRange(const rexos_datatypes::Point3D<double>* points, int begin, int end, double effectorRadius, const std::vector<BitmapCoordinate>& sweptOffsets, const std::vector<BitmapCoordinate> (&leadingOffsets)[6], int& firstInvalidSegment) const;
+		bool checkSegment(const rexos_datatypes::Point3D<double>& from, const rexos_datatypes::Point3D<double>& to, double effectorRadius, const std::vector<BitmapCoordinate>& sweptOffsets, const std::vector<BitmapCoordinate> (&leadingOffsets)[6]) const;
+		bool isWithinClearance(const rexos_datatypes::Point3D<double>& from, const rexos_datatypes::Point3D<double>& to, double effectorRadius) const;
+		int getVoxelDistance(const rexos_datatypes::Point3D<double>& point) const;
+		void transformDistanceLines(std::vector<uint16_t>& squaredDistances, int axis, int begin, int end) const;
+		bool isSweptVoxelValid(const BitmapCoordinate& voxel, const std::vector<BitmapCoordinate>& sweptOffsets) const;
+		void getSweptOffsets(double radius, std::vector<BitmapCoordinate>& sweptOffsets, std::vector<BitmapCoordinate> (&leadingOffsets)[6]) const;
+		bool hasInvalidNeighbours(const BitmapCoordinate& coordinate, uint8_t* pointValidityCache) const;
+		bool isValid(const BitmapCoordinate& coordinate, uint8_t* pointValidityCache) const;
+		bool isReachable(const BitmapCoordinate& coordinate) const;
+		void evaluateVoxelRange(const std::vector<int>& voxels, int begin, int end, std::vector<char>& results) const;
+		void evaluateVoxels(const std::vector<int>& voxels, uint8_t* pointValidityCache) const;
+		void addNeighbours(int index, std::vector<int>& neighbours) const;
+		void addUnknownVoxel(int index, std::vector<int>& unknownVoxels, uint8_t* pointValidityCache) const;
 		void generateBoundariesBitmap();
+		bool useMappedBitmap(StorageType storageType);
+		void publishSharedEffectorBoundaries(const std::string& sharedMemoryName) const;
+		static std::string getCacheFileName(const InverseKinematicsModel& model, double motorMinAngles[3], double motorMaxAngles[3], double voxelSize, const std::string& cacheDirectory);
+		static std::string getSharedMemoryName(const InverseKinematicsModel& model, double motorMinAngles[3], double motorMaxAngles[3], double voxelSize);
+		void updateBoundariesBitmap(bool mayShrink, bool mayGrow);
+		void findOuterBorder();
+		void convertStorage(StorageType storageType);
+
+		/**
+		 * Checks if a voxel lies within the bitmap and is set to true.
+		 * 
+		 * @param voxel The bitmap coordinate of the voxel.
+		 * 
+		 * @return true if the voxel can be reached by the effector.
+		 **/
+		inline bool isInBitmap(const BitmapCoordinate& voxel) const{
+			return voxel.x >= 0 && voxel.x < width
+				&& voxel.y >= 0 && voxel.y < depth
+				&& voxel.z >= 0 && voxel.z < height
+				&& boundariesBitmap->get(voxel.x + voxel.y * width + voxel.z * width * depth);
+		}
+
+		/**
+		 * Checks if the motor angles are within the minimum and maximum angles of the motors.
+		 * 
+		 * @param angle0 The angle of the first motor.
+		 * @param angle1 The angle of the second motor.
+		 * @param angle2 The angle of the third motor.
+		 * 
+		 * @return true if all angles are within the limits.
+		 **/
+		inline bool isWithinMotorLimits(double angle0, double angle1, double angle2) const{
+			return angle0 > motorMinAngles[0] && angle0 < motorMaxAngles[0]
+				&& angle1 > motorMinAngles[1] && angle1 < motorMaxAngles[1]
+				&& angle2 > motorMinAngles[2] && angle2 < motorMaxAngles[2];
+		}
 
 		/**
 		 * Converts a bitmap coordinate to a real life coordinate.
@@ -117,14 +205,129 @@ namespace rexos_delta_robot{
 		}
 
 		/**
-		 * An enum holding the values an entry in the pointValidityCache can have. They indicate whether a point fits within the boundaries or not, or if this has not yet been determined.
+		 * An enum holding the values an entry in the pointValidityCache can have. They indicate whether a point fits within the boundaries or not, or if this has not yet been determined. PENDING marks a voxel that is waiting to be evaluated.
 		 **/
 		enum cacheEntry{
 			UNKNOWN,
 			VALID,
-			INVALID
+			INVALID,
+			PENDING
 		};
 
+		/**
+		 * @var int CACHE_ENTRIES_PER_BYTE
+		 * The pointValidityCache stores a cacheEntry in 2 bits, so 4 entries fit in a byte.
+		 **/
+		static const int CACHE_ENTRIES_PER_BYTE = 4;
+
+		/**
+		 * Gets an entry from the pointValidityCache.
+		 * 
+		 * @param pointValidityCache Pointer to the cache.
+		 * @param index The index of the voxel.
+		 * 
+		 * @return The entry of the voxel.
+		 **/
+		static inline cacheEntry getCacheEntry(const uint8_t* pointValidityCache, int index){
+			return (cacheEntry) ((pointValidityCache[index / CACHE_ENTRIES_PER_BYTE] >> ((index % CACHE_ENTRIES_PER_BYTE) * 2)) & 3);
+		}
+
+		/**
+		 * Sets an entry in the pointValidityCache.
+		 * 
+		 * @param pointValidityCache Pointer to the cache.
+		 * @param index The index of the voxel.
+		 * @param entry The new entry of the voxel.
+		 **/
+		static inline void setCacheEntry(uint8_t* pointValidityCache, int index, cacheEntry entry){
+			int shift = (index % CACHE_ENTRIES_PER_BYTE) * 2;
+			pointValidityCache[index / CACHE_ENTRIES_PER_BYTE] = (pointValidityCache[index / CACHE_ENTRIES_PER_BYTE] & ~(3 << shift)) | (entry << shift);
+		}
+
+		/**
+		 * Header of an effector boundaries file or shared memory segment. The bitmap follows directly after the header, in the layout of a DenseVoxelStorage and the byte order of the machine that wrote it.
+		 **/
+		typedef struct FileHeader{
+			/**
+			 * @var char magic[8]
+			 * Identifies the file as an effector boundaries file. Always FILE_MAGIC.
+			 **/
+			char magic[8];
+
+			/**
+			 * @var uint32_t version
+			 * The version of the file format. Files of another version are regenerated.
+			 **/
+			uint32_t version;
+
+			/**
+			 * @var uint32_t headerSize
+			 * The size of the header in bytes, which is the offset of the bitmap in the file.
+			 **/
+			uint32_t headerSize;
+
+			/**
+			 * @var uint64_t geometryHash
+			 * Hash of the robot geometry the bitmap was generated for.
+			 * @see getGeometryHash
+			 **/
+			uint64_t geometryHash;
+
+			/**
+			 * @var int32_t width
+			 * The width of the boundary bitmap.
+			 **/
+			int32_t width;
+
+			/**
+			 * @var int32_t height
+			 * The height of the boundary bitmap.
+			 **/
+			int32_t height;
+
+			/**
+			 * @var int32_t depth
+			 * The depth of the boundary bitmap.
+			 **/
+			int32_t depth;
+
+			/**
+			 * @var uint32_t reserved
+			 * Padding, always 0.
+			 **/
+			uint32_t reserved;
+		} FileHeader;
+
+		/**
+		 * @var char FILE_MAGIC[8]
+		 * The magic value at the start of every effector boundaries file.
+		 **/
+		static const char FILE_MAGIC[8];
+
+		/**
+		 * @var uint32_t FILE_FORMAT_VERSION
+		 * The current version of the effector boundaries file format.
+		 **/
+		static const uint32_t FILE_FORMAT_VERSION = 2;
+
+		/**
+		 * @var int MIN_VOXELS_PER_THREAD
+		 * The minimum amount of voxels a thread evaluates during the boundary generation. Smaller batches are evaluated on the calling thread, because starting a thread would cost more than it saves.
+		 **/
+		static const int MIN_VOXELS_PER_THREAD = 256;
+
+		/**
+		 * @var int MIN_SEGMENTS_PER_THREAD
+		 * The minimum amount of path segments a thread checks in checkPolyline. Shorter paths are checked on the calling thread.
+		 **/
+		static const int MIN_SEGMENTS_PER_THREAD = 128;
+
+		/**
+		 * @var uint16_t MAX_SQUARED_DISTANCE
+		 * The highest squared distance in voxels the distance transform keeps track of. Larger distances are stored as this distance, which is the most a byte of the distance field can hold.
+		 **/
+		static const uint16_t MAX_SQUARED_DISTANCE = 255 * 255;
+
 		/**
 		 * @var int width
 		 * The width of the boundary bitmap.
@@ -144,10 +347,28 @@ namespace rexos_delta_robot{
 		int depth;
 
 		/**
-		 * @var bool* boundariesBitmap
-		 * A pointer to the boundaries bitmap. This bitmap is a one dimensional array of booleans, defaulted to false, where voxels are checked and set to true if they are reachable.
+		 * @var VoxelStorage* boundariesBitmap
+		 * A pointer to the boundaries bitmap. Voxels in this bitmap are defaulted to false, and are checked and set to true if they are reachable.
 		 **/
-		bool* boundariesBitmap;
+		VoxelStorage* boundariesBitmap;
+
+		/**
+		 * @var std::vector<int> outerBorder
+		 * The indices of the valid voxels on the border of the valid area, as found by the generation of the boundaries bitmap. Changes of the motor limits are applied starting from these voxels. Empty when the boundaries were loaded from a file or shared memory segment, until the motor limits change.
+		 **/
+		std::vector<int> outerBorder;
+
+		/**
+		 * @var std::vector<uint8_t> distanceField
+		 * For every voxel the distance in voxels from the voxel to the nearest voxel outside the boundaries, rounded down and at most 255. Voxels outside the boundaries have distance 0. Empty until generateDistanceField is called.
+		 **/
+		std::vector<uint8_t> distanceField;
+
+		/**
+		 * @var boost::interprocess::mapped_region* mappedBitmap
+		 * The memory mapped effector boundaries file or shared memory segment holding the boundaries bitmap, or NULL if the bitmap was generated.
+		 **/
+		boost::interprocess::mapped_region* mappedBitmap;
 
 		/**
 		 * @var InverseKinematicsModel& kinematics
@@ -172,5 +393,11 @@ namespace rexos_delta_robot{
 		 * The size of the voxels in the boundary bitmap.
 		 **/
 		double voxelSize;
+
+		/**
+		 * @var std::string cacheDirectory
+		 * The directory holding the effector boundaries files, or an empty string if the boundaries are not cached.
+		 **/
+		std::string cacheDirectory;
 	};
 }
@@ -52,8 +52,8 @@ namespace rexos_delta_robot{
 	 **/
 	class InverseKinematics : public InverseKinematicsModel{
 	private:
-		double motorAngle(const rexos_datatypes::Point3D<double>& destinationPoint,
-				double motorLocation) const;
+		SolveStatus motorAngle(const rexos_datatypes::Point3D<double>& destinationPoint,
+				double motorLocation, double& angle) const throw();
 
 	public:
 		InverseKinematics(const double base, const double hip,
@@ -64,6 +64,8 @@ namespace rexos_delta_robot{
 
 		virtual ~InverseKinematics(void);
 		
+		SolveStatus solveMotorAngles(const rexos_datatypes::Point3D<double>& destinationPoint, double (&angles)[3]) const throw();
+
 		void destinationPointToMotorRotations(const rexos_datatypes::Point3D<double>& destinationPoint,
 				rexos_datatypes::MotorRotation* (&rotations)[3]) const;
 	};
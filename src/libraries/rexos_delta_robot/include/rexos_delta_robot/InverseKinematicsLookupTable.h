@@ -0,0 +1,136 @@
+/**
+ * @file InverseKinematicsLookupTable.h
+ * @brief Inverse kinematics from a precalculated grid of motor angles, with trilinear interpolation.
+ *
+ * @section LICENSE
+ * License: newBSD
+ *  
+ * Copyright © 2012, HU University of Applied Sciences Utrecht.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **/
+
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <rexos_datatypes/Point3D.h>
+#include <rexos_datatypes/MotorRotation.h>
+#include <rexos_delta_robot/InverseKinematicsModel.h>
+
+namespace rexos_delta_robot{
+	/**
+	 * Inverse kinematics model that interpolates the motor angles from a grid, precalculated with another model over the effector boundary box. The grid points are the voxels of EffectorBoundaries with the same voxel size.
+	 * Only the grid cells in which the interpolation stays within the maximum error are used, points in other cells (near the edge of the reachable area and near singular regions) are solved by the other model.
+	 * The error of a cell is estimated from a few samples in the cell, not bounded. DeltaRobot::planMotion verifies every motion with the forward kinematics, that check is what guards the kinematics tolerance.
+	 **/
+	class InverseKinematicsLookupTable : public InverseKinematicsModel{
+	public:
+		InverseKinematicsLookupTable(const InverseKinematicsModel& exactModel, double voxelSize, double maxError);
+		virtual ~InverseKinematicsLookupTable(void);
+
+		SolveStatus solveMotorAngles(const rexos_datatypes::Point3D<double>& destinationPoint, double (&angles)[3]) const throw();
+
+		void destinationPointToMotorRotations(const rexos_datatypes::Point3D<double>& destinationPoint,
+				rexos_datatypes::MotorRotation* (&rotations)[3]) const;
+
+		size_t getMemoryUsage() const;
+
+	private:
+		/**
+		 * @var int BRICK_SIZE
+		 * The amount of grid cells on a side of a brick. A brick stores the angles of its BRICK_SIZE + 1 grid points on a side, so the corners of all its cells are in the brick.
+		 **/
+		static const int BRICK_SIZE = 8;
+
+		/**
+		 * @var int BRICK_POINTS
+		 * The amount of grid points on a side of a brick.
+		 **/
+		static const int BRICK_POINTS = BRICK_SIZE + 1;
+
+		/**
+		 * Value in the bricks list for a brick without any cells that can be interpolated. Other values are the number of the brick in brickAngles and brickCells.
+		 **/
+		enum brickEntry{
+			NO_BRICK = -1
+		};
+
+		/**
+		 * @var InverseKinematicsModel& exactModel
+		 * The model the grid is calculated with, and that solves the points the grid can't interpolate.
+		 **/
+		const InverseKinematicsModel& exactModel;
+
+		/**
+		 * @var double voxelSize
+		 * The distance in millimeters between two grid points.
+		 **/
+		double voxelSize;
+
+		/**
+		 * @var int width
+		 * The amount of grid cells along the x axis.
+		 **/
+		int width;
+
+		/**
+		 * @var int depth
+		 * The amount of grid cells along the y axis.
+		 **/
+		int depth;
+
+		/**
+		 * @var int height
+		 * The amount of grid cells along the z axis.
+		 **/
+		int height;
+
+		/**
+		 * @var int bricksWide
+		 * The amount of bricks along the x axis.
+		 **/
+		int bricksWide;
+
+		/**
+		 * @var int bricksDeep
+		 * The amount of bricks along the y axis.
+		 **/
+		int bricksDeep;
+
+		/**
+		 * @var std::vector<int32_t> bricks
+		 * For every brick either NO_BRICK or the number of the brick in brickAngles and brickCells.
+		 **/
+		std::vector<int32_t> bricks;
+
+		/**
+		 * @var std::vector<float> brickAngles
+		 * The three motor angles in radians of every grid point of the stored bricks.
+		 **/
+		std::vector<float> brickAngles;
+
+		/**
+		 * @var std::vector<uint64_t> brickCells
+		 * A bit for every cell of the stored bricks, set when the cell can be interpolated. BRICK_SIZE words per brick, one for every z layer.
+		 **/
+		std::vector<uint64_t> brickCells;
+
+		void generateBrick(int brickX, int brickY, int brickZ, double maxError);
+	};
+}
@@ -36,6 +36,7 @@
 
 #pragma once
 
+#include <cstddef>
 #include <rexos_datatypes/Point3D.h>
 #include <rexos_datatypes/MotorRotation.h>
 
@@ -89,6 +90,24 @@ namespace rexos_delta_robot{
 				base(base), hip(hip), effector(effector), ankle(ankle), maxAngleHipAnkle(maxAngleHipAnkle){}
 
 	public:
+		/**
+		 * Result of calculating the motor angles for a point.
+		 **/
+		enum SolveStatus{
+			/**
+			 * The point can be reached, the angles are calculated.
+			 **/
+			SOLVED,
+			/**
+			 * The point is out of reach of the arms.
+			 **/
+			POINT_OUT_OF_RANGE,
+			/**
+			 * The point would need an angle between a hip and an ankle larger than maxAngleHipAnkle.
+			 **/
+			HIP_ANKLE_ANGLE_OUT_OF_RANGE
+		};
+
 		virtual ~InverseKinematicsModel(void){}
 
 		/**
@@ -97,11 +116,51 @@ namespace rexos_delta_robot{
 		 **/
 		const double maxAngleHipAnkle;
 
+		/**
+		 * Gets the radius of the base.
+		 *
+		 * @return The radius of the base in millimeters.
+		 **/
+		inline double getBase(void) const{ return base; }
+
+		/**
+		 * Gets the length of the hip.
+		 *
+		 * @return The length of the hip in millimeters.
+		 **/
+		inline double getHip(void) const{ return hip; }
+
+		/**
+		 * Gets the radius of the effector.
+		 *
+		 * @return The radius of the effector in millimeters.
+		 **/
+		inline double getEffector(void) const{ return effector; }
+
+		/**
+		 * Gets the length of the ankle.
+		 *
+		 * @return The length of the ankle in millimeters.
+		 **/
+		inline double getAnkle(void) const{ return ankle; }
+
+		/**
+		 * Translates a point to the motor angles without throwing exceptions or allocating memory. Meant for code that checks many points, of which a lot can't be reached.
+		 *
+		 * @param destinationPoint The destination point.
+		 * @param angles Array the angles of the motors are written to, in radians. Only meaningful when SOLVED is returned.
+		 *
+		 * @return SOLVED if the point can be reached, otherwise the reason it can't be reached.
+		 **/
+		virtual SolveStatus solveMotorAngles(const rexos_datatypes::Point3D<double>& destinationPoint, double (&angles)[3]) const throw() = 0;
+
 		/**
 		 * Translates a point to the motor rotations.
 		 *
 		 * @param destinationPoint The destination point.
 		 * @param rotations Array of MotorRotation objects, will be adjusted by the function to the correct rotations per motor.
+		 *
+		 * @throw InverseKinematicsException if the point can't be reached.
 		 **/
 		virtual void destinationPointToMotorRotations(const rexos_datatypes::Point3D<double>& destinationPoint,
 				rexos_datatypes::MotorRotation* (&rotations)[3]) const = 0;
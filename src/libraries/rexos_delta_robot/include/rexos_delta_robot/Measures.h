@@ -131,5 +131,23 @@ namespace rexos_delta_robot{
 		 * The size of the big calibration steps in radians. Currently equal to 20 small calibration steps.
 		 **/
 		 const double CALIBRATION_STEP_BIG = CALIBRATION_STEP_SMALL * 20;
+
+		/**
+		 * @var double KINEMATICS_TOLERANCE
+		 * The maximum distance in millimeters between a destination point and the location calculated back from its motor angles with the forward kinematics.
+		 **/
+		const double KINEMATICS_TOLERANCE = 0.01;
+
+		/**
+		 * @var double LINEAR_MAX_CHORDAL_ERROR
+		 * The maximum distance in millimeters the effector may deviate from a straight line when moving in linear interpolation mode.
+		 **/
+		const double LINEAR_MAX_CHORDAL_ERROR = 0.1;
+
+		/**
+		 * @var int LINEAR_MAX_SUBDIVISION_DEPTH
+		 * The maximum amount of times a straight line is split in half in linear interpolation mode. A line is split in at most 2^LINEAR_MAX_SUBDIVISION_DEPTH motions.
+		 **/
+		const int LINEAR_MAX_SUBDIVISION_DEPTH = 8;
 	}
 }
@@ -0,0 +1,86 @@
+/**
+ * @file MotionPlanner.h
+ * @brief Hardware-free planning of a single motion of the deltarobot, from the kinematics to the motion profile.
+ *
+ * @section LICENSE
+ * License: newBSD
+ *  
+ * Copyright © 2012, HU University of Applied Sciences Utrecht.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **/
+
+#pragma once
+
+#include <rexos_datatypes/MotorRotation.h>
+#include <rexos_datatypes/Point3D.h>
+#include <rexos_delta_robot/EffectorBoundaries.h>
+#include <rexos_delta_robot/ForwardKinematics.h>
+#include <rexos_delta_robot/InverseKinematicsModel.h>
+
+namespace rexos_delta_robot{
+	/**
+	 * Plans motions without any hardware: calculates the motor angles for a point, verifies them with the forward kinematics, checks them against the motor limits and the path against the boundaries, and synchronizes the motors.
+	 * DeltaRobot plans all its motions with this class, so the benchmarks measure the same planning the robot does.
+	 **/
+	class MotionPlanner{
+	public:
+		MotionPlanner(const InverseKinematicsModel& kinematics, const ForwardKinematics& forwardKinematics, const EffectorBoundaries& boundaries, double kinematicsTolerance,
+				const double (&motorMinAngles)[3], const double (&motorMaxAngles)[3]);
+
+		double planMotion(const rexos_datatypes::Point3D<double>& from, const double (&fromAngles)[3], const rexos_datatypes::Point3D<double>& point, double maxAcceleration,
+				rexos_datatypes::MotorRotation (&rotations)[3]) const;
+
+	private:
+		/**
+		 * @var InverseKinematicsModel& kinematics
+		 * The kinematics model the motor angles are calculated with.
+		 **/
+		const InverseKinematicsModel& kinematics;
+
+		/**
+		 * @var ForwardKinematics& forwardKinematics
+		 * The forward kinematics the motor angles are verified with.
+		 **/
+		const ForwardKinematics& forwardKinematics;
+
+		/**
+		 * @var EffectorBoundaries& boundaries
+		 * The boundaries the paths have to stay within.
+		 **/
+		const EffectorBoundaries& boundaries;
+
+		/**
+		 * @var double kinematicsTolerance
+		 * The maximum distance in millimeters between a destination point and the location its motor angles lead to.
+		 **/
+		double kinematicsTolerance;
+
+		/**
+		 * @var double motorMinAngles[3]
+		 * The minimum angle in radians of every motor, the motor angles have to be above it.
+		 **/
+		double motorMinAngles[3];
+
+		/**
+		 * @var double motorMaxAngles[3]
+		 * The maximum angle in radians of every motor, the motor angles have to be below it.
+		 **/
+		double motorMaxAngles[3];
+	};
+}
@@ -0,0 +1,75 @@
+/**
+ * @file MotionProfile.h
+ * @brief Time-optimal trapezoidal motion profiles, synchronized over the three motors of the deltarobot.
+ *
+ * @section LICENSE
+ * License: newBSD
+ *  
+ * Copyright © 2012, HU University of Applied Sciences Utrecht.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **/
+
+#pragma once
+
+#include <vector>
+#include <rexos_datatypes/MotorRotation.h>
+
+namespace rexos_delta_robot{
+	/**
+	 * Generates trapezoidal motion profiles for the three motors that all take the same, shortest possible, time within the speed and acceleration limits of every motor.
+	 **/
+	class MotionProfile{
+	public:
+		MotionProfile(const double (&maxSpeeds)[3], const double (&maxAccelerations)[3], double minAcceleration, double minAngle);
+
+		static double getMoveTime(double relativeAngle, double maxSpeed, double maxAcceleration);
+		double synchronize(const double (&startAngles)[3], rexos_datatypes::MotorRotation* (&rotations)[3]) const;
+		int link(const double (&startAngles)[3], rexos_datatypes::MotorRotation* (*rotations)[3], const double* durations, int numberOfMotions, double& duration) const;
+
+	private:
+		/**
+		 * @var double maxSpeeds[3]
+		 * The maximum speed in radians/s for every motor.
+		 **/
+		double maxSpeeds[3];
+
+		/**
+		 * @var double maxAccelerations[3]
+		 * The maximum acceleration and deceleration in radians/s² for every motor.
+		 **/
+		double maxAccelerations[3];
+
+		/**
+		 * @var double minAcceleration
+		 * The lowest acceleration and deceleration in radians/s² the motors support.
+		 **/
+		double minAcceleration;
+
+		/**
+		 * @var double minAngle
+		 * The smallest relative angle in radians a motor can move. Motors with a smaller motion stay where they are.
+		 **/
+		double minAngle;
+
+		double getLinkedDuration(const std::vector<double>& relativeAngles, std::vector<double>& motionTimes,
+				double (&accelerations)[3], double (&decelerations)[3], double& delay) const;
+		void getLinkedRamps(const std::vector<double>& relativeAngles, const std::vector<double>& motionTimes,
+				double (&accelerations)[3], double (&decelerations)[3], double& delay) const;
+	};
+}
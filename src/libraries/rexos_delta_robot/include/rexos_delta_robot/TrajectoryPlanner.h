@@ -0,0 +1,101 @@
+/**
+ * @file TrajectoryPlanner.h
+ * @brief Queue of cartesian waypoints that skips the waypoints of a path lying within a tolerance of a straight motion.
+ *
+ * @section LICENSE
+ * License: newBSD
+ *  
+ * Copyright © 2012, HU University of Applied Sciences Utrecht.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **/
+
+#pragma once
+
+#include <deque>
+#include <rexos_datatypes/Point3D.h>
+#include <rexos_delta_robot/EffectorBoundaries.h>
+
+namespace rexos_delta_robot{
+	/**
+	 * Plans the motions along a path of waypoints. Waypoints that lie within the skip tolerance of a straight motion past them are skipped, so fewer motions are made.
+	 * Waypoints are only skipped for straight motions, in joint interpolation the effector follows a curve the tolerance does not hold for. The corners at the remaining waypoints are blended by DeltaRobot::moveAlongTrajectory, which links the motions.
+	 **/
+	class TrajectoryPlanner{
+	public:
+		/**
+		 * A waypoint on the path, with the acceleration for the motion towards it.
+		 **/
+		struct Waypoint{
+			/**
+			 * @var Point3D<double> point
+			 * The point to move to.
+			 **/
+			rexos_datatypes::Point3D<double> point;
+
+			/**
+			 * @var double maxAcceleration
+			 * The acceleration in radians/s² for the motor with the biggest motion towards the point.
+			 **/
+			double maxAcceleration;
+
+			Waypoint(const rexos_datatypes::Point3D<double>& point, double maxAcceleration) : point(point), maxAcceleration(maxAcceleration){}
+		};
+
+		/**
+		 * @var int MAX_SKIP_LOOKAHEAD
+		 * The maximum amount of waypoints that can be combined into a single motion.
+		 **/
+		static const int MAX_SKIP_LOOKAHEAD = 16;
+
+		TrajectoryPlanner(double skipTolerance = 0);
+
+		/**
+		 * Gets the skip tolerance.
+		 * @return The maximum distance in millimeters the effector may pass a skipped waypoint by.
+		 **/
+		inline double getSkipTolerance() const{ return skipTolerance; }
+		void setSkipTolerance(double skipTolerance);
+
+		void addWaypoint(const rexos_datatypes::Point3D<double>& point, double maxAcceleration);
+		void clear();
+
+		/**
+		 * Checks whether there are waypoints left in the queue.
+		 * @return True if there are waypoints left.
+		 **/
+		inline bool hasWaypoints() const{ return !waypoints.empty(); }
+
+		Waypoint nextWaypoint(const rexos_datatypes::Point3D<double>& currentLocation, const EffectorBoundaries* boundaries = NULL, bool straightMotions = true);
+
+	private:
+		/**
+		 * @var std::deque<Waypoint> waypoints
+		 * The queue of waypoints that are not moved to yet.
+		 **/
+		std::deque<Waypoint> waypoints;
+
+		/**
+		 * @var double skipTolerance
+		 * The maximum distance in millimeters the effector may pass a skipped waypoint by.
+		 **/
+		double skipTolerance;
+
+		static double distanceToSegment(const rexos_datatypes::Point3D<double>& point, const rexos_datatypes::Point3D<double>& from, const rexos_datatypes::Point3D<double>& to);
+	};
+}
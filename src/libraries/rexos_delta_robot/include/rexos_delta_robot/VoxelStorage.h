@@ -0,0 +1,64 @@
+/**
+ * @file VoxelStorage.h
+ * @brief Storage of the voxels in the effector boundaries bitmap.
+ *
+ * @section LICENSE
+ * License: newBSD
+ *  
+ * Copyright © 2012, HU University of Applied Sciences Utrecht.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **/
+
+#pragma once
+
+#include <cstddef>
+
+namespace rexos_delta_robot{
+	/**
+	 * Abstract storage for the voxels of a 3D bitmap. Every voxel holds one bit, which is true when the voxel can be reached by the effector. Voxels are addressed by their index, x + y * width + z * width * depth, like everywhere else in the EffectorBoundaries.
+	 **/
+	class VoxelStorage{
+	public:
+		virtual ~VoxelStorage(){}
+
+		/**
+		 * Gets the value of a voxel.
+		 * 
+		 * @param index The index of the voxel.
+		 * 
+		 * @return The value of the voxel.
+		 **/
+		virtual bool get(int index) const = 0;
+
+		/**
+		 * Sets the value of a voxel.
+		 * 
+		 * @param index The index of the voxel.
+		 * @param value The new value of the voxel.
+		 **/
+		virtual void set(int index, bool value) = 0;
+
+		/**
+		 * Gets the amount of memory used to store the voxels.
+		 * 
+		 * @return The amount of memory in bytes.
+		 **/
+		virtual size_t getMemoryUsage() const = 0;
+	};
+}
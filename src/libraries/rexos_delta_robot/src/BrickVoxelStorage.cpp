@@ -0,0 +1,138 @@
+/**
+ * @file BrickVoxelStorage.cpp
+ * @brief Sparse storage of the voxels in the effector boundaries bitmap.
+ *
+ * @section LICENSE
+ * License: newBSD
+ *  
+ * Copyright © 2012, HU University of Applied Sciences Utrecht.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **/
+
+#include <algorithm>
+#include <rexos_delta_robot/BrickVoxelStorage.h>
+
+namespace rexos_delta_robot{
+	/**
+	 * Constructor of a BrickVoxelStorage holding the same voxels as another storage.
+	 * 
+	 * @param source The storage holding the voxels.
+	 * @param width The width of the bitmap in voxels.
+	 * @param depth The depth of the bitmap in voxels.
+	 * @param height The height of the bitmap in voxels.
+	 **/
+	BrickVoxelStorage::BrickVoxelStorage(const VoxelStorage& source, int width, int depth, int height) : 
+		width(width), 
+		depth(depth), 
+		height(height), 
+		bricksWide((width + BRICK_SIZE - 1) / BRICK_SIZE), 
+		bricksDeep((depth + BRICK_SIZE - 1) / BRICK_SIZE), 
+		bricks(), 
+		brickWords(){
+		int bricksHigh = (height + BRICK_SIZE - 1) / BRICK_SIZE;
+		bricks.resize(bricksWide * bricksDeep * bricksHigh);
+
+		uint64_t words[BRICK_SIZE];
+		uint64_t masks[BRICK_SIZE];
+		for(int brickZ = 0; brickZ < bricksHigh; brickZ++){
+			for(int brickY = 0; brickY < bricksDeep; brickY++){
+				for(int brickX = 0; brickX < bricksWide; brickX++){
+					// Collect the voxels of the brick. The masks hold the bits of the voxels that lie within the bitmap, bricks on the edge are only partially used.
+					bool allValid = true;
+					bool allInvalid = true;
+					for(int z = 0; z < BRICK_SIZE; z++){
+						words[z] = 0;
+						masks[z] = 0;
+						for(int y = 0; y < BRICK_SIZE; y++){
+							for(int x = 0; x < BRICK_SIZE; x++){
+								int voxelX = brickX * BRICK_SIZE + x;
+								int voxelY = brickY * BRICK_SIZE + y;
+								int voxelZ = brickZ * BRICK_SIZE + z;
+								if(voxelX < width && voxelY < depth && voxelZ < height){
+									uint64_t bit = (uint64_t) 1 << (x + y * BRICK_SIZE);
+									masks[z] |= bit;
+									if(source.get(voxelX + voxelY * width + voxelZ * width * depth)){
+										words[z] |= bit;
+									}
+								}
+							}
+						}
+						allValid = allValid && words[z] == masks[z];
+						allInvalid = allInvalid && words[z] == 0;
+					}
+
+					int brick = brickX + brickY * bricksWide + brickZ * bricksWide * bricksDeep;
+					if(allInvalid){
+						bricks[brick] = ALL_INVALID;
+					} else if(allValid){
+						bricks[brick] = ALL_VALID;
+					} else{
+						bricks[brick] = brickWords.size();
+						brickWords.insert(brickWords.end(), words, words + BRICK_SIZE);
+					}
+				}
+			}
+		}
+	}
+
+	bool BrickVoxelStorage::get(int index) const{
+		int x = index % width;
+		int y = (index / width) % depth;
+		int z = index / (width * depth);
+		int32_t entry = bricks[x / BRICK_SIZE + (y / BRICK_SIZE) * bricksWide + (z / BRICK_SIZE) * bricksWide * bricksDeep];
+		if(entry == ALL_INVALID){
+			return false;
+		} else if(entry == ALL_VALID){
+			return true;
+		}
+		return (brickWords[entry + z % BRICK_SIZE] >> (x % BRICK_SIZE + (y % BRICK_SIZE) * BRICK_SIZE)) & 1;
+	}
+
+	/**
+	 * Sets the value of a voxel. When the voxel is in a brick in which all voxels have the same value, the brick is stored as bits from then on.
+	 * 
+	 * @param index The index of the voxel.
+	 * @param value The new value of the voxel.
+	 **/
+	void BrickVoxelStorage::set(int index, bool value){
+		int x = index % width;
+		int y = (index / width) % depth;
+		int z = index / (width * depth);
+		int32_t& entry = bricks[x / BRICK_SIZE + (y / BRICK_SIZE) * bricksWide + (z / BRICK_SIZE) * bricksWide * bricksDeep];
+		if((entry == ALL_INVALID && !value) || (entry == ALL_VALID && value)){
+			return;
+		}
+		if(entry < 0){
+			uint64_t fill = entry == ALL_VALID ? ~(uint64_t) 0 : 0;
+			entry = brickWords.size();
+			brickWords.insert(brickWords.end(), BRICK_SIZE, fill);
+		}
+
+		uint64_t bit = (uint64_t) 1 << (x % BRICK_SIZE + (y % BRICK_SIZE) * BRICK_SIZE);
+		if(value){
+			brickWords[entry + z % BRICK_SIZE] |= bit;
+		} else{
+			brickWords[entry + z % BRICK_SIZE] &= ~bit;
+		}
+	}
+
+	size_t BrickVoxelStorage::getMemoryUsage() const{
+		return bricks.size() * sizeof(int32_t) + brickWords.size() * sizeof(uint64_t);
+	}
+}
@@ -35,11 +35,14 @@
 #include <cstdio>
 #include <stdexcept>
 #include <cmath>
+#include <algorithm>
 
 #include <rexos_datatypes/Point3D.h>
 #include <rexos_delta_robot/EffectorBoundaries.h>
 #include <rexos_delta_robot/InverseKinematics.h>
 #include <rexos_delta_robot/InverseKinematicsException.h>
+#include <rexos_delta_robot/MotionPlanner.h>
+#include <rexos_delta_robot/MotionProfile.h>
 #include <rexos_delta_robot/DeltaRobot.h>
 #include <rexos_motor/MotorException.h>
 #include <rexos_motor/MotorInterface.h>
@@ -56,18 +59,27 @@ namespace rexos_delta_robot{
      **/
     DeltaRobot::DeltaRobot(rexos_datatypes::DeltaRobotMeasures& deltaRobotMeasures, rexos_motor::MotorManager* motorManager, rexos_motor::StepperMotor* (&motors)[3], modbus_t* modbusIO) :
         kinematics(NULL),
+        kinematicsLookupTable(NULL),
+        motionKinematics(NULL),
+        kinematicsTolerance(Measures::KINEMATICS_TOLERANCE),
+        forwardKinematics(NULL),
         motors(motors),
         motorManager(NULL),
         boundaries(NULL),
         effectorLocation(rexos_datatypes::Point3D<double>(0, 0, 0)), 
+        plannedEffectorLocation(rexos_datatypes::Point3D<double>(0, 0, 0)),
         boundariesGenerated(false),
         modbusIO(modbusIO),
-        currentMotionSlot(1){
+        currentMotionSlot(1),
+        interpolationMode(JOINT),
+        maxChordalError(Measures::LINEAR_MAX_CHORDAL_ERROR){
 
         if(modbusIO == NULL){
             throw std::runtime_error("Unable to open modbusIO");
         }
         kinematics = new InverseKinematics(deltaRobotMeasures);
+        motionKinematics = kinematics;
+        forwardKinematics = new ForwardKinematics(deltaRobotMeasures);
 
         if(motorManager == NULL){
             throw std::runtime_error("No motorManager given");
@@ -82,7 +94,10 @@ namespace rexos_delta_robot{
         if(motorManager->isPoweredOn()){
             motorManager->powerOff();
         }
+        delete boundaries;
+        delete kinematicsLookupTable;
         delete kinematics;
+        delete forwardKinematics;
     }
     
     /**
@@ -91,12 +106,72 @@ namespace rexos_delta_robot{
      * @param voxelSize The size in millimeters of a side of a voxel in the boundaries.
      **/
     void DeltaRobot::generateBoundaries(double voxelSize){
-        double motorMinAngles[3] = {Measures::MOTOR_ROT_MIN, Measures::MOTOR_ROT_MIN, Measures::MOTOR_ROT_MIN};
-        double motorMaxAngles[3] = {Measures::MOTOR_ROT_MAX, Measures::MOTOR_ROT_MAX, Measures::MOTOR_ROT_MAX};
-        boundaries = EffectorBoundaries::generateEffectorBoundaries((*kinematics), motorMinAngles, motorMaxAngles, voxelSize);
+        generateBoundaries(voxelSize, "");
+    }
+
+    /**
+     * Generates the effectorBoundaries for the given voxelSize, or loads them from shared memory or the cache directory when they have been generated for this deltarobot before.
+     *
+     * @param voxelSize The size in millimeters of a side of a voxel in the boundaries.
+     * @param cacheDirectory The directory holding the effector boundaries files. An empty string disables the cache.
+     * @param storageType The way the boundaries bitmap is stored in memory.
+     * @param sharedMemory Whether to share the boundaries with the other deltarobots with the same measures on this machine.
+     **/
+    void DeltaRobot::generateBoundaries(double voxelSize, const std::string& cacheDirectory, EffectorBoundaries::StorageType storageType, bool sharedMemory){
+        double motorMinAngles[3] = {motors[0]->getMinAngle(), motors[1]->getMinAngle(), motors[2]->getMinAngle()};
+        double motorMaxAngles[3] = {motors[0]->getMaxAngle(), motors[1]->getMaxAngle(), motors[2]->getMaxAngle()};
+        EffectorBoundaries* newBoundaries;
+        if(sharedMemory){
+            newBoundaries = EffectorBoundaries::getSharedEffectorBoundaries((*kinematics), motorMinAngles, motorMaxAngles, voxelSize, cacheDirectory, storageType);
+        } else if(cacheDirectory.empty()){
+            newBoundaries = EffectorBoundaries::generateEffectorBoundaries((*kinematics), motorMinAngles, motorMaxAngles, voxelSize, storageType);
+        } else{
+            newBoundaries = EffectorBoundaries::generateEffectorBoundaries((*kinematics), motorMinAngles, motorMaxAngles, voxelSize, cacheDirectory, storageType);
+        }
+        delete boundaries;
+        boundaries = newBoundaries;
         boundariesGenerated = true;
     }
 
+    /**
+     * Generates a lookup table for the kinematics model, which is used for all motions from then on. The effector boundaries keep using the kinematics model itself.
+     *
+     * @param voxelSize The distance in millimeters between two points in the lookup table.
+     * @param maxError The maximum distance in millimeters between a destination point and the location the interpolated motor angles lead to.
+     **/
+    void DeltaRobot::generateKinematicsLookupTable(double voxelSize, double maxError){
+        InverseKinematicsLookupTable* newKinematicsLookupTable = new InverseKinematicsLookupTable(*kinematics, voxelSize, maxError);
+        delete kinematicsLookupTable;
+        kinematicsLookupTable = newKinematicsLookupTable;
+        motionKinematics = kinematicsLookupTable;
+        kinematicsTolerance = Measures::KINEMATICS_TOLERANCE + maxError;
+    }
+
+    /**
+     * Changes the minimum and maximum angles of the motors. The new limits are written to the motor controllers, and the effector boundaries are updated for them, which only re-evaluates the voxels near the border of the valid area.
+     *
+     * @param motorMinAngles An array holding the minimum angle in radians of each of the three motors.
+     * @param motorMaxAngles An array holding the maximum angle in radians of each of the three motors.
+     **/
+    void DeltaRobot::setMotorLimits(double motorMinAngles[3], double motorMaxAngles[3]){
+        for(int i = 0; i < 3; i++){
+            if(motorMinAngles[i] >= motorMaxAngles[i]){
+                throw std::out_of_range("motor minimum angle has to be smaller than its maximum angle");
+            }
+        }
+
+        // The motor limits are not changed underneath a running motion.
+        waitForMotions();
+
+        // The boundaries are updated first, they refuse limits that leave the centre of the boundary box unreachable.
+        if(boundariesGenerated){
+            boundaries->setMotorLimits(motorMinAngles, motorMaxAngles);
+        }
+        for(int i = 0; i < 3; i++){
+            motors[i]->setAngleLimitsAndWriteMotorLimits(motorMinAngles[i], motorMaxAngles[i]);
+        }
+    }
+
     /**
      * Checks the validity of an angle for a motor.
      *
@@ -115,40 +190,45 @@ namespace rexos_delta_robot{
      * 
      * @param begin The starting point.
      * @param end The end point.
+     * @param effectorRadius Radius in millimeters around the path that has to be within the boundaries as well.
      * 
      * @return if the path between two points is valid.
      **/
-    bool DeltaRobot::checkPath(const rexos_datatypes::Point3D<double>& begin, const rexos_datatypes::Point3D<double>& end){
-        return boundaries->checkPath(begin, end);
+    bool DeltaRobot::checkPath(const rexos_datatypes::Point3D<double>& begin, const rexos_datatypes::Point3D<double>& end, double effectorRadius){
+        return boundaries->checkPath(begin, end, effectorRadius);
     }
 
     /**
-     * Gets the acceleration in radians/s² for a motor rotation with a certain relative angle and time, which is half acceleration and half deceleration (there is no period of constant speed).
+     * Checks a path along a number of points.
      * 
-     * @param relativeAngle The relative angle
-     * @param moveTime the move time.
-     *
-     * @return the acceleration in radians/s²
+     * @param points Array of the points on the path.
+     * @param numberOfPoints The amount of points in the array.
+     * @param effectorRadius Radius in millimeters around the path that has to be within the boundaries as well.
+     * 
+     * @return The index of the first invalid segment (from points[index] to points[index + 1]), or -1 if the whole path is valid.
      **/
-    double DeltaRobot::getAccelerationForRotation(double relativeAngle, double moveTime){
-        return (4 * fabs(relativeAngle)) / (moveTime * moveTime);
+    int DeltaRobot::checkPolyline(const rexos_datatypes::Point3D<double>* points, int numberOfPoints, double effectorRadius){
+        return boundaries->checkPolyline(points, numberOfPoints, effectorRadius);
     }
 
     /**
-     * Gets the top speed in radians/s for a motor rotation with a certain relative angle, time and acceleration.
+     * Sets the way the effector moves between two points.
      * 
-     * @param relativeAngle The relative angle
-     * @param moveTime the move time.
-     * @param acceleration the acceleration
-     *
-     * @return the speed in radians/s
+     * @param interpolationMode The interpolation mode used by moveTo.
+     * @param maxChordalError The maximum distance in millimeters the effector may deviate from a straight line in linear interpolation mode.
      **/
-    double DeltaRobot::getSpeedForRotation(double relativeAngle, double moveTime, double acceleration){
-        return (acceleration/2) * (moveTime - sqrt((moveTime * moveTime) - (4 * fabs(relativeAngle) / acceleration)));
+    void DeltaRobot::setInterpolationMode(InterpolationMode interpolationMode, double maxChordalError){
+        if(maxChordalError <= 0){
+            throw std::out_of_range("maxChordalError must be positive");
+        }
+        this->interpolationMode = interpolationMode;
+        this->maxChordalError = maxChordalError;
     }
 
     /**
-     * Makes the deltarobot move to a point.
+     * Makes the deltarobot move to a point, using the current interpolation mode.
+     * In linear interpolation mode the line is split into motions that each stay within the maximum chordal error of the line. These motions are linked like the waypoints of moveAlongTrajectory, so the effector only stops where a motor changes direction.
+     * All motions are planned before the first one is queued, a line that can not be followed is refused without moving.
      * 
      * @param point 3-dimensional point to move to.
      * @param maxAcceleration the acceleration in radians/s² that the motor with the biggest motion will accelerate at.
@@ -159,142 +239,259 @@ namespace rexos_delta_robot{
             throw rexos_motor::MotorException("motor drivers are not powered on");
         }
 
-        if(effectorLocation == point){
-            // The effector is already at the requested location, the method can be cut short.
+        std::vector<PlannedMotion> motions;
+        planMotions(point, maxAcceleration, motions);
+        queueMotions(motions, true);
+    }
+
+    /**
+     * Plans the motions to a point, using the current interpolation mode, and adds them to a list of planned motions without moving.
+     * 
+     * @param point 3-dimensional point to move to.
+     * @param maxAcceleration the acceleration in radians/s² that the motor with the biggest motion will accelerate at.
+     * @param motions The list the motions are added to. The motions start at the end of the last motion in the list, or at the end of the last queued motion if the list is empty. Motions in which none of the motors move are left out.
+     * 
+     * @throw InverseKinematicsException If the point can't be reached, the path leaves the boundaries, or a straight line can not be followed within the maximum chordal error.
+     **/
+    void DeltaRobot::planMotions(const rexos_datatypes::Point3D<double>& point, double maxAcceleration, std::vector<PlannedMotion>& motions){
+        rexos_datatypes::Point3D<double> from = plannedEffectorLocation;
+        double fromAngles[3] = {motors[0]->getCurrentAngle(), motors[1]->getCurrentAngle(), motors[2]->getCurrentAngle()};
+        if(!motions.empty()){
+            from = motions.back().point;
+            for(int i = 0; i < 3; i++){
+                fromAngles[i] = motions.back().rotations[i].angle;
+            }
+        }
+        if(from == point){
+            // The effector is already at the requested location.
             return;
         }
 
-        if(maxAcceleration > rexos_motor::CRD514KD::MOTOR_MAX_ACCELERATION){
-            // The acceleration is too high, putting it down to the maximum CRD514KD acceleration.
-            maxAcceleration = rexos_motor::CRD514KD::MOTOR_MAX_ACCELERATION;
-        } else if(maxAcceleration < rexos_motor::CRD514KD::MOTOR_MIN_ACCELERATION){
-            // The acceleration is too low, throwing an exception.
-            throw std::out_of_range("maxAcceleration too low");            
+        // Unreachable points are reported by planMotion.
+        std::vector<rexos_datatypes::Point3D<double> > points;
+        double toAngles[3];
+        if(interpolationMode == LINEAR && motionKinematics->solveMotorAngles(point, toAngles) == InverseKinematicsModel::SOLVED){
+            subdivideLine(from, fromAngles, point, toAngles, 0, points);
         }
-
-        // Create MotorRotation objects.
-        rexos_datatypes::MotorRotation* rotations[3];
-        rotations[0] = new rexos_datatypes::MotorRotation();
-        rotations[1] = new rexos_datatypes::MotorRotation();
-        rotations[2] = new rexos_datatypes::MotorRotation();
-
-        // Get the motor angles from the kinematics model
-        try{
-            kinematics->destinationPointToMotorRotations(point, rotations);
-        } catch(InverseKinematicsException& ex){
-            delete rotations[0];
-            delete rotations[1];
-            delete rotations[2];
-            throw ex;
+        points.push_back(point);
+
+        // Every motion starts at the angles the motion before it ends at.
+        for(unsigned int i = 0; i < points.size(); i++){
+            PlannedMotion motion;
+            motion.point = points[i];
+            motion.maxAcceleration = maxAcceleration;
+            motion.duration = planMotion(from, fromAngles, points[i], maxAcceleration, motion.rotations);
+            if(motion.duration > 0){
+                motions.push_back(motion);
+            }
+            from = points[i];
+            for(int j = 0; j < 3; j++){
+                fromAngles[j] = motion.rotations[j].angle;
+            }
         }
+    }
 
-        // Check if the angles fit within the boundaries
-        if(!isValidAngle(0, rotations[0]->angle) || !isValidAngle(1, rotations[1]->angle) || !isValidAngle(2, rotations[2]->angle)){
-            delete rotations[0];
-            delete rotations[1];
-            delete rotations[2];
-            throw InverseKinematicsException("motion angles outside of valid range", point);
+    /**
+     * Splits a line in half for as long as moving the motors straight from the start to the end angles would make the effector deviate too far from the line.
+     * 
+     * @param from The start of the line.
+     * @param fromAngles The motor angles at the start of the line.
+     * @param to The end of the line.
+     * @param toAngles The motor angles at the end of the line.
+     * @param depth The amount of times the line has been split already.
+     * @param points The vector the points between the motions are added to, in order. The end of the line itself is not added.
+     * 
+     * @throw InverseKinematicsException If the line can not be followed within the maximum chordal error after splitting it LINEAR_MAX_SUBDIVISION_DEPTH times.
+     **/
+    void DeltaRobot::subdivideLine(const rexos_datatypes::Point3D<double>& from, const double (&fromAngles)[3], const rexos_datatypes::Point3D<double>& to, const double (&toAngles)[3], int depth, std::vector<rexos_datatypes::Point3D<double> >& points){
+        // Compare the effector location halfway the motion with the middle of the line.
+        rexos_datatypes::Point3D<double> middle((from.x + to.x) / 2, (from.y + to.y) / 2, (from.z + to.z) / 2);
+        double halfwayAngles[3] = {(fromAngles[0] + toAngles[0]) / 2, (fromAngles[1] + toAngles[1]) / 2, (fromAngles[2] + toAngles[2]) / 2};
+        rexos_datatypes::Point3D<double> halfway;
+        if(forwardKinematics->motorAnglesToDestinationPoint(halfwayAngles, halfway) && halfway.distance(middle) <= maxChordalError){
+            return;
         }
 
-        // Check if the path fits within the boundaries
-        if(!boundaries->checkPath(effectorLocation, point)){
-            delete rotations[0];
-            delete rotations[1];
-            delete rotations[2];
-            throw InverseKinematicsException("invalid path", point);
+        if(depth >= Measures::LINEAR_MAX_SUBDIVISION_DEPTH){
+            throw InverseKinematicsException("line can not be followed within the maximum chordal error", middle);
         }
 
-        try{
-            // An array to hold the relative angles for the motors
-            double relativeAngles[3] = {0.0,0.0,0.0};
+        double middleAngles[3];
+        if(motionKinematics->solveMotorAngles(middle, middleAngles) != InverseKinematicsModel::SOLVED){
+            throw InverseKinematicsException("point on the line is unreachable", middle);
+        }
+        subdivideLine(from, fromAngles, middle, middleAngles, depth + 1, points);
+        points.push_back(middle);
+        subdivideLine(middle, middleAngles, to, toAngles, depth + 1, points);
+    }
 
-            // An array that indicates for each motor whether it moves in this motion or not.
-            bool motorIsMoved[3] = {true, true, true};
+    /**
+     * Calculates the rotations of the motors for a motion from the end of the last queued motion to a point, without moving. The motion is checked against the motor angles, the kinematics and the boundaries.
+     * 
+     * @param point 3-dimensional point to move to.
+     * @param maxAcceleration the acceleration in radians/s² that the motor with the biggest motion will accelerate at.
+     * @param rotations The rotations for the motors are written to this array.
+     * 
+     * @return The time in seconds the motion takes, or 0 if none of the motors have to move.
+     **/
+    double DeltaRobot::planMotion(const rexos_datatypes::Point3D<double>& point, double maxAcceleration, rexos_datatypes::MotorRotation (&rotations)[3]){
+        double startAngles[3] = {motors[0]->getCurrentAngle(), motors[1]->getCurrentAngle(), motors[2]->getCurrentAngle()};
+        return planMotion(plannedEffectorLocation, startAngles, point, maxAcceleration, rotations);
+    }
 
-            // Index for the motor with the biggest motion
-            int motorWithBiggestMotion = 0;
+    /**
+     * Calculates the rotations of the motors for a motion between two points, without moving. The planning itself is done by MotionPlanner, which needs no hardware.
+     * 
+     * @param from The point the motion starts from.
+     * @param fromAngles The motor angles in radians the motion starts from.
+     * @param point 3-dimensional point to move to.
+     * @param maxAcceleration the acceleration in radians/s² that the motor with the biggest motion will accelerate at.
+     * @param rotations The rotations for the motors are written to this array.
+     * 
+     * @return The time in seconds the motion takes, or 0 if none of the motors have to move.
+     **/
+    double DeltaRobot::planMotion(const rexos_datatypes::Point3D<double>& from, const double (&fromAngles)[3], const rexos_datatypes::Point3D<double>& point, double maxAcceleration, rexos_datatypes::MotorRotation (&rotations)[3]){
+        double motorMinAngles[3] = {motors[0]->getMinAngle(), motors[1]->getMinAngle(), motors[2]->getMinAngle()};
+        double motorMaxAngles[3] = {motors[0]->getMaxAngle(), motors[1]->getMaxAngle(), motors[2]->getMaxAngle()};
+        MotionPlanner motionPlanner(*motionKinematics, *forwardKinematics, *boundaries, kinematicsTolerance, motorMinAngles, motorMaxAngles);
+        return motionPlanner.planMotion(from, fromAngles, point, maxAcceleration, rotations);
+    }
 
-            for(int i = 0; i < 3; i++){
-                relativeAngles[i] = fabs(rotations[i]->angle - motors[i]->getCurrentAngle());
-                if (relativeAngles[i] > relativeAngles[motorWithBiggestMotion]){
-                    motorWithBiggestMotion = i;
-                }
+    /**
+     * Queues planned motions, linking as many of them as possible into single motions through which the effector moves without stopping.
+     * 
+     * @param motions The planned motions, the queued motions are removed from it.
+     * @param all Whether all motions are queued. If false, the last motions are kept until the motions after them are planned, as they may be linked to those.
+     **/
+    void DeltaRobot::queueMotions(std::vector<PlannedMotion>& motions, bool all){
+        unsigned int queued = 0;
+        while(queued < motions.size() && (all || motions.size() - queued >= (unsigned int)rexos_motor::CRD514KD::LINKED_MOTIONS_MAX)){
+            queued += queueLinkedMotion(&motions[queued], std::min((int)(motions.size() - queued), rexos_motor::CRD514KD::LINKED_MOTIONS_MAX));
+        }
+        motions.erase(motions.begin(), motions.begin() + queued);
+    }
 
-                if(relativeAngles[i] < rexos_motor::CRD514KD::MOTOR_STEP_ANGLE){
-                    // motor does not have to move at all
-                    motorIsMoved[i] = false;
-                }
+    /**
+     * Links as many planned motions as possible into a single motion, writes it into the next group of motion slots and starts it as soon as the previous motion has finished.
+     * The motions are linked by the motor controllers, which run the motion slots of the group one after another without stopping. The effector cuts the corners between the linked motions.
+     * 
+     * @param motions The motions to link, planned from the end of the motion before them. The rotations of the linked motions are changed to run into each other.
+     * @param numberOfMotions The amount of motions, at most CRD514KD::LINKED_MOTIONS_MAX.
+     * 
+     * @return The amount of motions that were linked and queued, at least 1.
+     **/
+    int DeltaRobot::queueLinkedMotion(PlannedMotion* motions, int numberOfMotions){
+        // The motors accelerate at the lowest acceleration of the linked motions.
+        double maxAcceleration = rexos_motor::CRD514KD::MOTOR_MAX_ACCELERATION;
+        rexos_datatypes::MotorRotation* rotations[rexos_motor::CRD514KD::LINKED_MOTIONS_MAX][3];
+        double durations[rexos_motor::CRD514KD::LINKED_MOTIONS_MAX];
+        for(int i = 0; i < numberOfMotions; i++){
+            for(int j = 0; j < 3; j++){
+                rotations[i][j] = &motions[i].rotations[j];
             }
+            durations[i] = motions[i].duration;
+            maxAcceleration = std::min(maxAcceleration, motions[i].maxAcceleration);
+        }
 
-            if(!(motorIsMoved[0] || motorIsMoved[1] || motorIsMoved[2])){
-                // none of the motors have to move, method can be cut short
-                delete rotations[0];
-                delete rotations[1];
-                delete rotations[2];
-                return;
-            }
+        double startAngles[3] = {motors[0]->getCurrentAngle(), motors[1]->getCurrentAngle(), motors[2]->getCurrentAngle()};
+        double maxSpeeds[3] = {rexos_motor::CRD514KD::MOTOR_MAX_SPEED, rexos_motor::CRD514KD::MOTOR_MAX_SPEED, rexos_motor::CRD514KD::MOTOR_MAX_SPEED};
+        double maxAccelerations[3] = {maxAcceleration, maxAcceleration, maxAcceleration};
+        MotionProfile motionProfile(maxSpeeds, maxAccelerations, rexos_motor::CRD514KD::MOTOR_MIN_ACCELERATION, rexos_motor::CRD514KD::MOTOR_STEP_ANGLE);
+        double duration = motions[0].duration;
+        int linked = motionProfile.link(startAngles, rotations, durations, numberOfMotions, duration);
+
+        // switch to the next group of motion slots
+        currentMotionSlot += rexos_motor::CRD514KD::LINKED_MOTIONS_MAX;
+        if(currentMotionSlot > rexos_motor::CRD514KD::MOTION_SLOTS_USED){
+            currentMotionSlot = 1;
+        }
 
-             // switch currentMotionSlot
-            currentMotionSlot++;
-            if(currentMotionSlot > rexos_motor::CRD514KD::MOTION_SLOTS_USED){
-                currentMotionSlot = 1;
+        // The slots may still hold the motion before the running one.
+        finishMotion(currentMotionSlot - 1);
+
+        // The rotation data of motors on different buses is written in parallel.
+        for(int i = 0; i < linked; i++){
+            for(int j = 0; j < 3; j++){
+                motors[j]->writeRotationData(motions[i].rotations[j], currentMotionSlot + i, true, false);
+                motors[j]->setLinkedMotion(currentMotionSlot + i, i < linked - 1, false);
             }
+        }
+        motorManager->flush();
 
-            // Set the acceleration of the motor with the biggest motion to the given maximum.
-            rotations[motorWithBiggestMotion]->acceleration = maxAcceleration;
-            rotations[motorWithBiggestMotion]->deceleration = maxAcceleration;
-
-            // Calculate the time the motion will take, based on the assumption that the motion is two-phase (half acceleration and half deceleration).
-            // TODO: Take the motor's maximum speed into account.
-            double moveTime;
-
-            if(sqrt(relativeAngles[motorWithBiggestMotion] * rotations[motorWithBiggestMotion]->acceleration) > rexos_motor::CRD514KD::MOTOR_MAX_SPEED){
-                // In case of a two-phase motion, the top speed would come out above the motor's maximum, so a three-phase motion must be made.
-                rotations[motorWithBiggestMotion]->speed = rexos_motor::CRD514KD::MOTOR_MAX_SPEED;
-                moveTime = (relativeAngles[motorWithBiggestMotion] / rotations[motorWithBiggestMotion]->speed) + (rotations[motorWithBiggestMotion]->speed / rotations[motorWithBiggestMotion]->acceleration);  
-            } else {
-                // The motion is fine as a two-phase motion.
-                moveTime = 2 * sqrt(relativeAngles[motorWithBiggestMotion] / rotations[motorWithBiggestMotion]->acceleration);
+        // Returns as soon as the motion is queued, the next motion is planned while this one executes.
+        motionCompletions[currentMotionSlot - 1] = motorManager->startMovementAsync(currentMotionSlot, duration);
+        motionPoints[currentMotionSlot - 1] = motions[linked - 1].point;
+        plannedEffectorLocation = motions[linked - 1].point;
+        return linked;
+    }
+
+    /**
+     * Waits for the motion last started from a motion slot and moves the effector location to its end point.
+     * 
+     * @param slotIndex The index of the motion slot, from 0 to MOTION_SLOTS_USED - 1.
+     * 
+     * @throw The exception the motion failed with. The motions are then planned from the effector location of the last finished motion again.
+     **/
+    void DeltaRobot::finishMotion(int slotIndex){
+        boost::shared_future<void> motion = motionCompletions[slotIndex];
+        motionCompletions[slotIndex] = boost::shared_future<void>();
+        if(!motion.valid()){
+            return;
+        }
+        try{
+            motion.get();
+        } catch(...){
+            plannedEffectorLocation = effectorLocation;
+            throw;
+        }
+        effectorLocation = motionPoints[slotIndex];
+    }
+
+    /**
+     * Makes the deltarobot move along the waypoints of a trajectory planner. With linear interpolation, waypoints within the planner's skip tolerance of a straight motion are skipped.
+     * Consecutive motions in which every motor keeps turning in the same direction are linked, the effector blends the corners between them without stopping. It stops where a motor reverses.
+     * The motions are planned a few waypoints ahead of the queued motions, while the motions before them run.
+     * 
+     * @param trajectoryPlanner The planner holding the waypoints. When a motion can not be planned, the waypoints after it remain in the planner and the motions before it are made.
+     **/
+    void DeltaRobot::moveAlongTrajectory(TrajectoryPlanner& trajectoryPlanner){
+        // check whether the motors are powered on.
+        if(!motorManager->isPoweredOn()){
+            throw rexos_motor::MotorException("motor drivers are not powered on");
+        }
+
+        std::vector<PlannedMotion> motions;
+        while(trajectoryPlanner.hasWaypoints()){
+            rexos_datatypes::Point3D<double> from = motions.empty() ? plannedEffectorLocation : motions.back().point;
+            TrajectoryPlanner::Waypoint waypoint = trajectoryPlanner.nextWaypoint(from, boundaries, interpolationMode == LINEAR);
+            try{
+                planMotions(waypoint.point, waypoint.maxAcceleration, motions);
+            } catch(...){
+                queueMotions(motions, true);
+                throw;
             }
-            
-            // Set speed, and also the acceleration for the smaller motion motors
-            for(int i = 0; i < 3; i++){
-                rotations[i]->speed = rexos_motor::CRD514KD::MOTOR_MAX_SPEED;
-
-                if(i != motorWithBiggestMotion){
-                    if(motorIsMoved[i]){
-                        rotations[i]->acceleration = getAccelerationForRotation(relativeAngles[i], moveTime);
-                        rotations[i]->deceleration = rotations[i]->acceleration;  
-                        if(rotations[i]->acceleration < rexos_motor::CRD514KD::MOTOR_MIN_ACCELERATION){
-                            // The acceleration comes out too low, this means the motion cannot be half acceleration and half deceleration (without a consant speed phase).
-                            // To make it comply with the move time, as well as the minimum acceleration requirements, we have to add a top speed.
-                            rotations[i]->acceleration = rexos_motor::CRD514KD::MOTOR_MIN_ACCELERATION;
-                            rotations[i]->deceleration = rexos_motor::CRD514KD::MOTOR_MIN_ACCELERATION;
-                            rotations[i]->speed = getSpeedForRotation(relativeAngles[i], moveTime, rotations[i]->acceleration);
-                        } else if(rotations[i]->acceleration > rexos_motor::CRD514KD::MOTOR_MAX_ACCELERATION){
-                            throw std::out_of_range("acceleration too high");
-                        }
-                    } else {
-                        rotations[i]->acceleration = rexos_motor::CRD514KD::MOTOR_MIN_ACCELERATION;
-                        rotations[i]->deceleration = rexos_motor::CRD514KD::MOTOR_MIN_ACCELERATION;
-                        rotations[i]->angle = motors[i]->getCurrentAngle();
-                    }
+            queueMotions(motions, false);
+        }
+        queueMotions(motions, true);
+    }
+
+    /**
+     * Blocks until the motors have finished all motions started by moveTo, after which the effector location is the end point of the last motion.
+     * If a motion failed, the exception it failed with is thrown and the motions after it are no longer waited for.
+     **/
+    void DeltaRobot::waitForMotions(void){
+        // The slot after the current one holds the oldest motion.
+        for(int i = 1; i <= rexos_motor::CRD514KD::MOTION_SLOTS_USED; i++){
+            int slotIndex = (currentMotionSlot - 1 + i) % rexos_motor::CRD514KD::MOTION_SLOTS_USED;
+            try{
+                finishMotion(slotIndex);
+            } catch(...){
+                for(int j = 0; j < rexos_motor::CRD514KD::MOTION_SLOTS_USED; j++){
+                    motionCompletions[j] = boost::shared_future<void>();
                 }
-                motors[i]->writeRotationData(*rotations[i], currentMotionSlot);
+                throw;
             }
-
-            motorManager->startMovement(currentMotionSlot);
-        } catch(std::out_of_range& ex){
-            delete rotations[0];
-            delete rotations[1];
-            delete rotations[2];
-            throw ex;
         }
-
-        delete rotations[0];
-        delete rotations[1];
-        delete rotations[2];
-        effectorLocation = point;
     }
 
     /**
@@ -350,6 +547,7 @@ namespace rexos_delta_robot{
     **/
     void DeltaRobot::calibrateMotor(int motorIndex){
         std::cout << "[DEBUG] Calibrating motor number " << motorIndex << std::endl;
+        waitForMotions();
 
         // Setup for incremental motion in big steps, to get to the sensor quickly.
         motors[motorIndex]->setIncrementalMode(1);
@@ -388,6 +586,8 @@ namespace rexos_delta_robot{
     * @return true if the calibration was succesful. False otherwise (e.g. failure on sensors.)
     **/
     bool DeltaRobot::calibrateMotors(){       
+        waitForMotions();
+
         // Check the availability of the sensors
         bool sensorFailure = false;
         if(checkSensor(0)){
@@ -414,13 +614,15 @@ namespace rexos_delta_robot{
         motorRotation.speed = 0.1;
         motorRotation.angle = 0;
 
-        motors[0]->setDeviationAndWriteMotorLimits(0);
-        motors[1]->setDeviationAndWriteMotorLimits(0);
-        motors[2]->setDeviationAndWriteMotorLimits(0);
+        motors[0]->setDeviationAndWriteMotorLimits(0, false);
+        motors[1]->setDeviationAndWriteMotorLimits(0, false);
+        motors[2]->setDeviationAndWriteMotorLimits(0, false);
+        motorManager->flush();
 
-        motors[0]->writeRotationData(motorRotation, 1);
-        motors[1]->writeRotationData(motorRotation, 1);
-        motors[2]->writeRotationData(motorRotation, 1);
+        motors[0]->writeRotationData(motorRotation, 1, true, false);
+        motors[1]->writeRotationData(motorRotation, 1, true, false);
+        motors[2]->writeRotationData(motorRotation, 1, true, false);
+        motorManager->flush();
         motorManager->startMovement(1);
 
         motors[0]->waitTillReady();
@@ -428,9 +630,10 @@ namespace rexos_delta_robot{
         motors[2]->waitTillReady();
 
         // Disable limitations
-        motors[0]->disableAngleLimitations();
-        motors[1]->disableAngleLimitations();
-        motors[2]->disableAngleLimitations();
+        motors[0]->disableAngleLimitations(false);
+        motors[1]->disableAngleLimitations(false);
+        motors[2]->disableAngleLimitations(false);
+        motorManager->flush();
         
         // Calibrate motors
         calibrateMotor(0);
@@ -438,16 +641,17 @@ namespace rexos_delta_robot{
         calibrateMotor(2);
 
         // Enable angle limitations
-        motors[0]->enableAngleLimitations();
-        motors[1]->enableAngleLimitations();
-        motors[2]->enableAngleLimitations();
-
-        effectorLocation.x = 0;
-        effectorLocation.y = 0;
-        effectorLocation.z = -sqrt((Measures::ANKLE * Measures::ANKLE) - ((
-                Measures::BASE + Measures::HIP - Measures::EFFECTOR) * (
-                Measures::BASE + Measures::HIP - Measures::EFFECTOR))
-        );
+        motors[0]->enableAngleLimitations(false);
+        motors[1]->enableAngleLimitations(false);
+        motors[2]->enableAngleLimitations(false);
+        motorManager->flush();
+
+        // The effector location follows from the calibrated motor angles
+        double angles[3] = {motors[0]->getCurrentAngle(), motors[1]->getCurrentAngle(), motors[2]->getCurrentAngle()};
+        if(!forwardKinematics->motorAnglesToDestinationPoint(angles, effectorLocation)){
+            throw InverseKinematicsException("calibrated motor angles do not lead to an effector location", effectorLocation);
+        }
+        plannedEffectorLocation = effectorLocation;
         std::cout << "[DEBUG] effector location z: " << effectorLocation.z << std::endl; 
 
         return true;
@@ -460,6 +664,11 @@ namespace rexos_delta_robot{
         if(motorManager->isPoweredOn()){
             motorManager->powerOff();
         }
+        // Powering off aborts the motions, their outcome no longer matters.
+        for(int i = 0; i < rexos_motor::CRD514KD::MOTION_SLOTS_USED; i++){
+            motionCompletions[i] = boost::shared_future<void>();
+        }
+        plannedEffectorLocation = effectorLocation;
     }
 
     /**
@@ -472,7 +681,7 @@ namespace rexos_delta_robot{
     }
 
     /**
-     * Get the location of the midpoint of the effector.
+     * Get the location of the midpoint of the effector, at the end of the last motion that has finished. Call waitForMotions first to include the motions that are still running.
      *
      * @return The coordinate for the midpoint of the effector.
      **/
@@ -0,0 +1,77 @@
+/**
+ * @file DenseVoxelStorage.cpp
+ * @brief Bit-packed storage of all voxels in the effector boundaries bitmap.
+ *
+ * @section LICENSE
+ * License: newBSD
+ *  
+ * Copyright © 2012, HU University of Applied Sciences Utrecht.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **/
+
+#include <algorithm>
+#include <rexos_delta_robot/DenseVoxelStorage.h>
+
+namespace rexos_delta_robot{
+	/**
+	 * Constructor of a DenseVoxelStorage which allocates its own words. All voxels are false.
+	 * 
+	 * @param numberOfVoxels The amount of voxels in the storage.
+	 **/
+	DenseVoxelStorage::DenseVoxelStorage(int numberOfVoxels) : 
+		words(new uint64_t[getNumberOfWords(numberOfVoxels)]), 
+		numberOfVoxels(numberOfVoxels), 
+		ownsWords(true){
+		std::fill(words, words + getNumberOfWords(numberOfVoxels), 0);
+	}
+
+	/**
+	 * Constructor of a DenseVoxelStorage which uses words owned by someone else, for example a memory mapped file. The words must stay valid for the lifetime of the object.
+	 * 
+	 * @param words Pointer to getNumberOfWords(numberOfVoxels) words holding the voxels.
+	 * @param numberOfVoxels The amount of voxels in the storage.
+	 **/
+	DenseVoxelStorage::DenseVoxelStorage(uint64_t* words, int numberOfVoxels) : 
+		words(words), 
+		numberOfVoxels(numberOfVoxels), 
+		ownsWords(false){
+	}
+
+	DenseVoxelStorage::~DenseVoxelStorage(){
+		if(ownsWords){
+			delete[] words;
+		}
+	}
+
+	bool DenseVoxelStorage::get(int index) const{
+		return (words[index >> 6] >> (index & 63)) & 1;
+	}
+
+	void DenseVoxelStorage::set(int index, bool value){
+		if(value){
+			words[index >> 6] |= (uint64_t) 1 << (index & 63);
+		} else{
+			words[index >> 6] &= ~((uint64_t) 1 << (index & 63));
+		}
+	}
+
+	size_t DenseVoxelStorage::getMemoryUsage() const{
+		return getNumberOfWords(numberOfVoxels) * sizeof(uint64_t);
+	}
+}
@@ -33,82 +33,816 @@
 #include <iostream>
 #include <rexos_delta_robot/Measures.h>
 #include <rexos_delta_robot/EffectorBoundaries.h>
-#include <rexos_delta_robot/InverseKinematicsException.h>
 #include <rexos_delta_robot/EffectorBoundariesException.h>
-#include <stack>
+#include <rexos_delta_robot/DenseVoxelStorage.h>
+#include <rexos_delta_robot/BrickVoxelStorage.h>
 #include <vector>
-#include <set>
+#include <algorithm>
 #include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <stdexcept>
+#include <limits>
+#include <cmath>
+#include <cstdlib>
+#include <unistd.h>
+#include <boost/bind.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/thread.hpp>
 
 namespace rexos_delta_robot{
+	const char EffectorBoundaries::FILE_MAGIC[8] = "REXOSEB";
+
 	/**
 	 * Function to generate the boundaries and returns a pointer to the object.
+	 * The boundaries are always generated in a dense bitmap, the peak memory use does not depend on the storage type.
 	 * 
 	 * @param model Used to calculate the boundaries.
 	 * @param motorMinAngles An array holding the minimum angle of each of the three motors.
 	 * @param motorMaxAngles An array holding the maximum angle of each of the three motors.
 	 * @param voxelSize The size of the voxels in millimeters.
+	 * @param storageType The way the boundaries bitmap is stored in memory.
 	 * 
 	 * @return Pointer to the object.
 	 **/
-	EffectorBoundaries* EffectorBoundaries::generateEffectorBoundaries(const InverseKinematicsModel& model, double motorMinAngles[3], double motorMaxAngles[3], double voxelSize){
+	EffectorBoundaries* EffectorBoundaries::generateEffectorBoundaries(const InverseKinematicsModel& model, double motorMinAngles[3], double motorMaxAngles[3], double voxelSize, StorageType storageType){
 		EffectorBoundaries* boundaries = new EffectorBoundaries(model, motorMinAngles, motorMaxAngles, voxelSize);
-		
-		// Create boundaries variables in voxel space by dividing real space variables with the voxel size
-		boundaries->width = (Measures::BOUNDARY_BOX_MAX_X  - Measures::BOUNDARY_BOX_MIN_X) / voxelSize;
-        boundaries->height = (Measures::BOUNDARY_BOX_MAX_Z - Measures::BOUNDARY_BOX_MIN_Z) / voxelSize;
-        boundaries->depth = (Measures::BOUNDARY_BOX_MAX_Y  - Measures::BOUNDARY_BOX_MIN_Y) / voxelSize;
         
         // Create bitmap with value false for all voxels
-        boundaries->boundariesBitmap = new bool[boundaries->width * boundaries->height * boundaries->depth];
-        for(int i = 0; i < boundaries->width * boundaries->height * boundaries->depth; i++){
-        	boundaries->boundariesBitmap[i] = false;
+        boundaries->boundariesBitmap = new DenseVoxelStorage(boundaries->width * boundaries->height * boundaries->depth);
+        try{
+        	boundaries->generateBoundariesBitmap();
+        } catch(EffectorBoundariesException& exception){
+        	delete boundaries;
+        	throw;
         }
-        boundaries->generateBoundariesBitmap();
+        boundaries->convertStorage(storageType);
         return boundaries;
     }
 
+	/**
+	 * Function to get the boundaries from the effector boundaries file in the cache directory, and returns a pointer to the object. The file is named after the geometry hash, so it only matches the geometry it was generated for. If there is no matching file the boundaries are generated and written to the cache directory, so the next call can use it.
+	 * 
+	 * @param model Used to calculate the boundaries.
+	 * @param motorMinAngles An array holding the minimum angle of each of the three motors.
+	 * @param motorMaxAngles An array holding the maximum angle of each of the three motors.
+	 * @param voxelSize The size of the voxels in millimeters.
+	 * @param cacheDirectory The directory holding the effector boundaries files.
+	 * @param storageType The way the boundaries bitmap is stored in memory.
+	 * 
+	 * @return Pointer to the object.
+	 **/
+	EffectorBoundaries* EffectorBoundaries::generateEffectorBoundaries(const InverseKinematicsModel& model, double motorMinAngles[3], double motorMaxAngles[3], double voxelSize, const std::string& cacheDirectory, StorageType storageType){
+		std::string fileName = getCacheFileName(model, motorMinAngles, motorMaxAngles, voxelSize, cacheDirectory);
+
+		EffectorBoundaries* boundaries = loadEffectorBoundaries(model, motorMinAngles, motorMaxAngles, voxelSize, fileName, storageType);
+		if(boundaries != NULL){
+			boundaries->cacheDirectory = cacheDirectory;
+			return boundaries;
+		}
+
+		// The file holds the dense bitmap, so the storage is converted after saving.
+		boundaries = generateEffectorBoundaries(model, motorMinAngles, motorMaxAngles, voxelSize, DENSE);
+		boundaries->cacheDirectory = cacheDirectory;
+		try{
+			boundaries->saveEffectorBoundaries(fileName);
+		} catch(std::runtime_error& exception){
+			// The boundaries are still usable, they just have to be generated again next time.
+			std::cerr << "Unable to write effector boundaries file " << fileName << ": " << exception.what() << std::endl;
+		}
+		boundaries->convertStorage(storageType);
+		return boundaries;
+	}
+
+	/**
+	 * Loads the boundaries from an effector boundaries file. The file is memory mapped, so with DENSE storage the bitmap is only read from disk when it is used.
+	 * 
+	 * @param model Used to calculate the boundaries.
+	 * @param motorMinAngles An array holding the minimum angle of each of the three motors.
+	 * @param motorMaxAngles An array holding the maximum angle of each of the three motors.
+	 * @param voxelSize The size of the voxels in millimeters.
+	 * @param fileName The effector boundaries file.
+	 * @param storageType The way the boundaries bitmap is stored in memory.
+	 * 
+	 * @return Pointer to the object, or NULL if the file does not exist, is of another version or was generated for another geometry.
+	 **/
+	EffectorBoundaries* EffectorBoundaries::loadEffectorBoundaries(const InverseKinematicsModel& model, double motorMinAngles[3], double motorMaxAngles[3], double voxelSize, const std::string& fileName, StorageType storageType){
+		EffectorBoundaries* boundaries = new EffectorBoundaries(model, motorMinAngles, motorMaxAngles, voxelSize);
+		try{
+			// A private mapping, so the bitmap stays writable without changing the file.
+			boost::interprocess::file_mapping file(fileName.c_str(), boost::interprocess::read_only);
+			boundaries->mappedBitmap = new boost::interprocess::mapped_region(file, boost::interprocess::copy_on_write);
+		} catch(boost::interprocess::interprocess_exception& exception){
+			delete boundaries;
+			return NULL;
+		}
+
+		if(!boundaries->useMappedBitmap(storageType)){
+			delete boundaries;
+			return NULL;
+		}
+		return boundaries;
+	}
+
+	/**
+	 * Gets the boundaries from the shared memory segment for this geometry, so robots with the same measures on one machine share a single bitmap. The segment is named after the geometry hash and mapped copy-on-write, so its pages are shared between the processes as long as they only read them. If there is no complete segment yet the boundaries are generated (or loaded from the cache directory) and published in a new segment for the next process, replacing an incomplete segment left by a process that stopped while publishing. When two processes start at the same time, only one of them publishes; the other uses its own bitmap.
+	 *
+	 * The segment stays in /dev/shm after the processes end, so robots started later skip the generation. removeSharedEffectorBoundaries removes it.
+	 *
+	 * @param model Used to calculate the boundaries.
+	 * @param motorMinAngles An array holding the minimum angle of each of the three motors.
+	 * @param motorMaxAngles An array holding the maximum angle of each of the three motors.
+	 * @param voxelSize The size of the voxels in millimeters.
+	 * @param cacheDirectory The directory holding the effector boundaries files. An empty string disables the cache.
+	 * @param storageType The way the boundaries bitmap is stored in memory. BRICKS makes a private copy, so it does not share memory.
+	 *
+	 * @return Pointer to the object.
+	 **/
+	EffectorBoundaries* EffectorBoundaries::getSharedEffectorBoundaries(const InverseKinematicsModel& model, double motorMinAngles[3], double motorMaxAngles[3], double voxelSize, const std::string& cacheDirectory, StorageType storageType){
+		std::string sharedMemoryName = getSharedMemoryName(model, motorMinAngles, motorMaxAngles, voxelSize);
+
+		EffectorBoundaries* boundaries = new EffectorBoundaries(model, motorMinAngles, motorMaxAngles, voxelSize);
+		bool segmentExists = false;
+		try{
+			boost::interprocess::shared_memory_object sharedMemory(boost::interprocess::open_only, sharedMemoryName.c_str(), boost::interprocess::read_only);
+			segmentExists = true;
+			boundaries->mappedBitmap = new boost::interprocess::mapped_region(sharedMemory, boost::interprocess::copy_on_write);
+		} catch(boost::interprocess::interprocess_exception& exception){
+			// There is no segment yet, or it is still empty.
+		}
+		if(boundaries->mappedBitmap != NULL && boundaries->useMappedBitmap(storageType)){
+			boundaries->cacheDirectory = cacheDirectory;
+			return boundaries;
+		}
+		delete boundaries;
+
+		// The segment holds the dense bitmap, so the storage is converted after publishing.
+		if(cacheDirectory.empty()){
+			boundaries = generateEffectorBoundaries(model, motorMinAngles, motorMaxAngles, voxelSize, DENSE);
+		} else{
+			boundaries = generateEffectorBoundaries(model, motorMinAngles, motorMaxAngles, voxelSize, cacheDirectory, DENSE);
+		}
+		try{
+			// A segment that is not valid was left by a process that stopped while publishing it, or is still being published. Either way it is replaced:
+			// a process that is still writing it keeps writing into the removed segment, and processes started later use this one.
+			if(segmentExists){
+				boost::interprocess::shared_memory_object::remove(sharedMemoryName.c_str());
+			}
+			boundaries->publishSharedEffectorBoundaries(sharedMemoryName);
+		} catch(boost::interprocess::interprocess_exception& exception){
+			// Another process is publishing the same boundaries, or shared memory is unavailable. Either way these boundaries are still usable.
+		}
+		boundaries->convertStorage(storageType);
+		return boundaries;
+	}
+
+	/**
+	 * Removes the shared memory segment for a geometry. Processes that have it mapped keep using it, processes started later generate and publish the boundaries again.
+	 *
+	 * @param model Used to calculate the boundaries.
+	 * @param motorMinAngles An array holding the minimum angle of each of the three motors.
+	 * @param motorMaxAngles An array holding the maximum angle of each of the three motors.
+	 * @param voxelSize The size of the voxels in millimeters.
+	 **/
+	void EffectorBoundaries::removeSharedEffectorBoundaries(const InverseKinematicsModel& model, double motorMinAngles[3], double motorMaxAngles[3], double voxelSize){
+		boost::interprocess::shared_memory_object::remove(getSharedMemoryName(model, motorMinAngles, motorMaxAngles, voxelSize).c_str());
+	}
+
+	/**
+	 * Gets the name of the effector boundaries file for a geometry in the cache directory.
+	 *
+	 * @param model Used to calculate the boundaries.
+	 * @param motorMinAngles An array holding the minimum angle of each of the three motors.
+	 * @param motorMaxAngles An array holding the maximum angle of each of the three motors.
+	 * @param voxelSize The size of the voxels in millimeters.
+	 * @param cacheDirectory The directory holding the effector boundaries files.
+	 *
+	 * @return The name of the file.
+	 **/
+	std::string EffectorBoundaries::getCacheFileName(const InverseKinematicsModel& model, double motorMinAngles[3], double motorMaxAngles[3], double voxelSize, const std::string& cacheDirectory){
+		std::stringstream fileName;
+		fileName << cacheDirectory << "/effector_boundaries_" << std::hex << std::setw(16) << std::setfill('0') << getGeometryHash(model, motorMinAngles, motorMaxAngles, voxelSize) << ".bin";
+		return fileName.str();
+	}
+
+	/**
+	 * Gets the name of the shared memory segment for a geometry.
+	 *
+	 * @param model Used to calculate the boundaries.
+	 * @param motorMinAngles An array holding the minimum angle of each of the three motors.
+	 * @param motorMaxAngles An array holding the maximum angle of each of the three motors.
+	 * @param voxelSize The size of the voxels in millimeters.
+	 *
+	 * @return The name of the segment.
+	 **/
+	std::string EffectorBoundaries::getSharedMemoryName(const InverseKinematicsModel& model, double motorMinAngles[3], double motorMaxAngles[3], double voxelSize){
+		std::stringstream name;
+		name << "rexos_effector_boundaries_" << std::hex << std::setw(16) << std::setfill('0') << getGeometryHash(model, motorMinAngles, motorMaxAngles, voxelSize);
+		return name.str();
+	}
+
+	/**
+	 * Writes the boundaries to a new shared memory segment. The bitmap is written before the header, and the magic value last, so other processes never use a partially written segment.
+	 *
+	 * @param sharedMemoryName The name of the segment. If it already exists an interprocess_exception is thrown.
+	 *
+	 * @throw EffectorBoundariesException if the boundaries are not stored in a dense bitmap.
+	 **/
+	void EffectorBoundaries::publishSharedEffectorBoundaries(const std::string& sharedMemoryName) const{
+		int numberOfVoxels = width * height * depth;
+		const DenseVoxelStorage* denseBitmap = dynamic_cast<const DenseVoxelStorage*>(boundariesBitmap);
+		if(denseBitmap == NULL){
+			throw EffectorBoundariesException("only boundaries in a dense bitmap can be published");
+		}
+		size_t bitmapSize = DenseVoxelStorage::getNumberOfWords(numberOfVoxels) * sizeof(uint64_t);
+
+		boost::interprocess::shared_memory_object sharedMemory(boost::interprocess::create_only, sharedMemoryName.c_str(), boost::interprocess::read_write);
+		sharedMemory.truncate(sizeof(FileHeader) + bitmapSize);
+		boost::interprocess::mapped_region region(sharedMemory, boost::interprocess::read_write);
+		char* address = static_cast<char*>(region.get_address());
+		memcpy(address + sizeof(FileHeader), denseBitmap->getWords(), bitmapSize);
+
+		FileHeader* header = reinterpret_cast<FileHeader*>(address);
+		header->version = FILE_FORMAT_VERSION;
+		header->headerSize = sizeof(FileHeader);
+		header->geometryHash = getGeometryHash(kinematics, const_cast<double*>(motorMinAngles), const_cast<double*>(motorMaxAngles), voxelSize);
+		header->width = width;
+		header->height = height;
+		header->depth = depth;
+		header->reserved = 0;
+		__sync_synchronize();
+		memcpy(header->magic, FILE_MAGIC, sizeof(header->magic));
+	}
+
+	/**
+	 * Uses the mapped effector boundaries file or shared memory segment as boundaries bitmap, if its header matches these boundaries.
+	 *
+	 * @param storageType The way the boundaries bitmap is stored in memory.
+	 *
+	 * @return true if the mapped bitmap is used, false if it is of another version, was generated for another geometry or is incomplete.
+	 **/
+	bool EffectorBoundaries::useMappedBitmap(StorageType storageType){
+		const FileHeader* header = static_cast<const FileHeader*>(mappedBitmap->get_address());
+		int numberOfVoxels = width * height * depth;
+		if(mappedBitmap->get_size() < sizeof(FileHeader)
+				|| memcmp(header->magic, FILE_MAGIC, sizeof(header->magic)) != 0
+				|| header->version != FILE_FORMAT_VERSION
+				|| header->geometryHash != getGeometryHash(kinematics, motorMinAngles, motorMaxAngles, voxelSize)
+				|| header->width != width
+				|| header->height != height
+				|| header->depth != depth
+				|| header->headerSize % sizeof(uint64_t) != 0
+				|| mappedBitmap->get_size() < header->headerSize + DenseVoxelStorage::getNumberOfWords(numberOfVoxels) * sizeof(uint64_t)){
+			return false;
+		}
+
+		uint64_t* words = reinterpret_cast<uint64_t*>(static_cast<char*>(mappedBitmap->get_address()) + header->headerSize);
+		boundariesBitmap = new DenseVoxelStorage(words, numberOfVoxels);
+		convertStorage(storageType);
+		return true;
+	}
+
+	/**
+	 * Writes the boundaries to an effector boundaries file. The file is written under a temporary name first and renamed afterwards, so other processes never see a partially written file.
+	 * 
+	 * @param fileName The effector boundaries file.
+	 **/
+	void EffectorBoundaries::saveEffectorBoundaries(const std::string& fileName) const{
+		FileHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+		header.version = FILE_FORMAT_VERSION;
+		header.headerSize = sizeof(FileHeader);
+		header.geometryHash = getGeometryHash(kinematics, const_cast<double*>(motorMinAngles), const_cast<double*>(motorMaxAngles), voxelSize);
+		header.width = width;
+		header.height = height;
+		header.depth = depth;
+
+		// The temporary name is unique per process, nodes with the same geometry may write the same file at once.
+		std::stringstream temporaryFileNameStream;
+		temporaryFileNameStream << fileName << "." << getpid() << ".tmp";
+		std::string temporaryFileName = temporaryFileNameStream.str();
+		std::ofstream file(temporaryFileName.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		int numberOfVoxels = width * height * depth;
+		const DenseVoxelStorage* denseBitmap = dynamic_cast<const DenseVoxelStorage*>(boundariesBitmap);
+		if(denseBitmap != NULL){
+			file.write(reinterpret_cast<const char*>(denseBitmap->getWords()), DenseVoxelStorage::getNumberOfWords(numberOfVoxels) * sizeof(uint64_t));
+		} else{
+			// Other storage is written in the dense format one word at a time.
+			for(int index = 0; index < numberOfVoxels; index += 64){
+				uint64_t word = 0;
+				for(int bit = 0; bit < 64 && index + bit < numberOfVoxels; bit++){
+					if(boundariesBitmap->get(index + bit)){
+						word |= (uint64_t) 1 << bit;
+					}
+				}
+				file.write(reinterpret_cast<const char*>(&word), sizeof(word));
+			}
+		}
+		file.close();
+		if(!file){
+			remove(temporaryFileName.c_str());
+			throw std::runtime_error("writing the effector boundaries file failed");
+		}
+
+		if(rename(temporaryFileName.c_str(), fileName.c_str()) != 0){
+			remove(temporaryFileName.c_str());
+			throw std::runtime_error("renaming the effector boundaries file failed");
+		}
+	}
+
+	/**
+	 * Calculates a hash (64-bit FNV-1a) over everything that determines the boundaries: the measures of the kinematics model, the motor angle limits, the voxel size and the boundary box.
+	 * 
+	 * @param model Used to calculate the boundaries.
+	 * @param motorMinAngles An array holding the minimum angle of each of the three motors.
+	 * @param motorMaxAngles An array holding the maximum angle of each of the three motors.
+	 * @param voxelSize The size of the voxels in millimeters.
+	 * 
+	 * @return The geometry hash.
+	 **/
+	uint64_t EffectorBoundaries::getGeometryHash(const InverseKinematicsModel& model, double motorMinAngles[3], double motorMaxAngles[3], double voxelSize){
+		double values[] = {
+			model.getBase(), model.getHip(), model.getEffector(), model.getAnkle(), model.maxAngleHipAnkle,
+			motorMinAngles[0], motorMinAngles[1], motorMinAngles[2],
+			motorMaxAngles[0], motorMaxAngles[1], motorMaxAngles[2],
+			voxelSize,
+			Measures::BOUNDARY_BOX_MIN_X, Measures::BOUNDARY_BOX_MAX_X,
+			Measures::BOUNDARY_BOX_MIN_Y, Measures::BOUNDARY_BOX_MAX_Y,
+			Measures::BOUNDARY_BOX_MIN_Z, Measures::BOUNDARY_BOX_MAX_Z
+		};
+
+		uint64_t hash = 14695981039346656037ULL;
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(values);
+		for(unsigned int i = 0; i < sizeof(values); i++){
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	/**
+	 * Converts the boundaries bitmap to another kind of storage. The memory mapped effector boundaries file is released when it is no longer used.
+	 * 
+	 * @param storageType The way the boundaries bitmap is stored in memory.
+	 **/
+	void EffectorBoundaries::convertStorage(StorageType storageType){
+		if(storageType == BRICKS && dynamic_cast<BrickVoxelStorage*>(boundariesBitmap) == NULL){
+			VoxelStorage* bricks = new BrickVoxelStorage(*boundariesBitmap, width, depth, height);
+			delete boundariesBitmap;
+			boundariesBitmap = bricks;
+
+			delete mappedBitmap;
+			mappedBitmap = NULL;
+		}
+	}
+
+	/**
+	 * Gets the amount of memory used to store the boundaries bitmap.
+	 * 
+	 * @return The amount of memory in bytes.
+	 **/
+	size_t EffectorBoundaries::getMemoryUsage() const{
+		return boundariesBitmap->getMemoryUsage() + outerBorder.capacity() * sizeof(int) + distanceField.capacity();
+	}
+
+	/**
+	 * Changes the minimum and maximum angles of the motors and updates the boundaries for them. Only the voxels that can change are run through the kinematics: starting at the border of the valid area, voxels that are no longer reachable are removed layer by layer, after which voxels that became reachable are added layer by layer. Boundaries that were loaded from a file or shared memory segment have no known border, it is found from the bitmap first.
+	 * When the boundaries are cached, they are written to the effector boundaries file for the new limits.
+	 *
+	 * If the centre of the boundary box is not reachable within the new limits an EffectorBoundariesException is thrown, and the boundaries and limits are left unchanged.
+	 *
+	 * @param motorMinAngles An array holding the minimum angle of each of the three motors.
+	 * @param motorMaxAngles An array holding the maximum angle of each of the three motors.
+	 **/
+	void EffectorBoundaries::setMotorLimits(double motorMinAngles[3], double motorMaxAngles[3]){
+		double oldMotorMinAngles[3];
+		double oldMotorMaxAngles[3];
+		bool mayShrink = false;
+		bool mayGrow = false;
+		for(int i = 0; i < 3; i++){
+			mayShrink = mayShrink || motorMinAngles[i] > this->motorMinAngles[i] || motorMaxAngles[i] < this->motorMaxAngles[i];
+			mayGrow = mayGrow || motorMinAngles[i] < this->motorMinAngles[i] || motorMaxAngles[i] > this->motorMaxAngles[i];
+			oldMotorMinAngles[i] = this->motorMinAngles[i];
+			oldMotorMaxAngles[i] = this->motorMaxAngles[i];
+			this->motorMinAngles[i] = motorMinAngles[i];
+			this->motorMaxAngles[i] = motorMaxAngles[i];
+		}
+
+		// The generation starts at the centre, so it has to stay valid.
+		if(!isReachable(fromRealCoordinate(rexos_datatypes::Point3D<double>(0, 0, Measures::BOUNDARY_BOX_MIN_Z + (Measures::BOUNDARY_BOX_MAX_Z - Measures::BOUNDARY_BOX_MIN_Z) / 2)))){
+			for(int i = 0; i < 3; i++){
+				this->motorMinAngles[i] = oldMotorMinAngles[i];
+				this->motorMaxAngles[i] = oldMotorMaxAngles[i];
+			}
+			throw EffectorBoundariesException("starting point outside of valid area with the new motor limits");
+		}
+
+		if(outerBorder.empty()){
+			findOuterBorder();
+		}
+		updateBoundariesBitmap(mayShrink, mayGrow);
+
+		if(hasDistanceField()){
+			generateDistanceField();
+		}
+
+		if(!cacheDirectory.empty()){
+			std::string fileName = getCacheFileName(kinematics, motorMinAngles, motorMaxAngles, voxelSize, cacheDirectory);
+			try{
+				saveEffectorBoundaries(fileName);
+			} catch(std::runtime_error& exception){
+				// The boundaries are still usable, they just have to be updated again next time.
+				std::cerr << "Unable to write effector boundaries file " << fileName << ": " << exception.what() << std::endl;
+			}
+		}
+	}
+
+	/**
+	 * Generates the distance field, which holds for every voxel the euclidean distance to the nearest voxel outside the boundaries. The exact distance transform of Felzenszwalb and Huttenlocher is done one axis at a time, each axis divided over all available cores. The field takes 1 byte per voxel.
+	 *
+	 * Once generated, getClearance can be used, and checkPath and checkPolyline accept segments that lie within the clearance of their end points without checking their voxels.
+	 **/
+	void EffectorBoundaries::generateDistanceField(){
+		int numberOfVoxels = width * height * depth;
+		std::vector<uint16_t> squaredDistances(numberOfVoxels);
+		for(int index = 0; index < numberOfVoxels; index++){
+			squaredDistances[index] = boundariesBitmap->get(index) ? MAX_SQUARED_DISTANCE : 0;
+		}
+
+		for(int axis = 0; axis < 3; axis++){
+			int length = axis == 0 ? width : (axis == 1 ? depth : height);
+			int numberOfLines = numberOfVoxels / length;
+			int numberOfThreads = boost::thread::hardware_concurrency();
+			if(numberOfThreads > numberOfVoxels / MIN_VOXELS_PER_THREAD){
+				numberOfThreads = numberOfVoxels / MIN_VOXELS_PER_THREAD;
+			}
+
+			if(numberOfThreads <= 1){
+				transformDistanceLines(squaredDistances, axis, 0, numberOfLines);
+			} else{
+				// Every line along the axis is transformed on its own, so the threads never touch the same voxels.
+				boost::thread_group threads;
+				int linesPerThread = (numberOfLines + numberOfThreads - 1) / numberOfThreads;
+				for(int begin = 0; begin < numberOfLines; begin += linesPerThread){
+					int end = std::min(begin + linesPerThread, numberOfLines);
+					threads.create_thread(boost::bind(&EffectorBoundaries::transformDistanceLines, this, boost::ref(squaredDistances), axis, begin, end));
+				}
+				threads.join_all();
+			}
+		}
+
+		distanceField.resize(numberOfVoxels);
+		for(int index = 0; index < numberOfVoxels; index++){
+			distanceField[index] = (uint8_t) floor(sqrt((double) squaredDistances[index]));
+		}
+	}
+
+	/**
+	 * Gets how far a point is from the edge of the boundaries. This is a lower bound: every point within this distance of the point lies in a valid voxel.
+	 *
+	 * @param point The point.
+	 *
+	 * @return The clearance in millimeters, 0 for points outside the boundaries or too close to their edge to tell.
+	 **/
+	double EffectorBoundaries::getClearance(const rexos_datatypes::Point3D<double>& point) const{
+		if(!hasDistanceField()){
+			throw EffectorBoundariesException("distance field not generated");
+		}
+		// A point can lie anywhere in its voxel, and so can the points around it, which costs the length of a voxel diagonal.
+		return std::max(0.0, (getVoxelDistance(point) - sqrt(3.0)) * voxelSize);
+	}
+
 	/**
 	 * Checks if the path from the starting- to the destination point is not going out of the
 	 * robot's boundaries.
 	 * 
 	 * @param from The starting point.
 	 * @param to The destination point.
+	 * @param effectorRadius Radius in millimeters around the path that has to be within the boundaries as well, 0 to only check the path itself.
 	 *
 	 * @return true if a straight path from parameter 'from' to parameter 'to' is valid.
 	 **/
-    bool EffectorBoundaries::checkPath(const rexos_datatypes::Point3D<double>& from, const rexos_datatypes::Point3D<double>& to) const{
-    	double x_length = to.x - from.x;
-    	double y_length = to.y - from.y;
-    	double z_length = to.z - from.z;
-    	double largest_length = (double)(fabs(x_length) > fabs(y_length) ?
-    			(fabs(x_length) > fabs(z_length) ? fabs(x_length) : fabs(z_length)) :
-    			(fabs(y_length) > fabs(z_length) ? fabs(y_length) : fabs(z_length)));
-
-    	x_length = x_length / largest_length;
-    	y_length = y_length / largest_length;
-    	z_length = z_length / largest_length;
-    	
-		for(double i = 1; i <= largest_length; i++){
-			int x = (from.x + x_length * i);
-			int y = (from.y + y_length * i);
-			int z = (from.z + z_length * i);
-			BitmapCoordinate temp = fromRealCoordinate(rexos_datatypes::Point3D<double>(x, y, z));
-			int index = temp.x + temp.y * width + temp.z * width * depth;
-
-			if(temp.x < 0
-				|| temp.x > width
-				|| temp.y < 0
-				|| temp.y > depth
-				|| temp.z < 0
-				|| temp.z > height
-				|| !boundariesBitmap[index]){
-				return false;
+    bool EffectorBoundaries::checkPath(const rexos_datatypes::Point3D<double>& from, const rexos_datatypes::Point3D<double>& to, double effectorRadius) const{
+    	// Voxel offsets covered by the effector around a voxel on the path, and the offsets that become covered when stepping to the next voxel in each direction.
+    	std::vector<BitmapCoordinate> sweptOffsets;
+    	std::vector<BitmapCoordinate> leadingOffsets[6];
+    	if(effectorRadius > 0){
+    		getSweptOffsets(effectorRadius, sweptOffsets, leadingOffsets);
+    	}
+    	return checkSegment(from, to, effectorRadius, sweptOffsets, leadingOffsets);
+    }
+
+	/**
+	 * Checks a path along a number of points, which consists of a straight segment from every point to the next. All segments are checked in one pass; paths with many segments are divided over all available cores.
+	 * 
+	 * @param points Array of the points on the path.
+	 * @param numberOfPoints The amount of points in the array.
+	 * @param effectorRadius Radius in millimeters around the path that has to be within the boundaries as well, 0 to only check the path itself.
+	 * 
+	 * @return The index of the first invalid segment (the segment from points[index] to points[index + 1]), or -1 if the whole path is valid.
+	 **/
+	int EffectorBoundaries::checkPolyline(const rexos_datatypes::Point3D<double>* points, int numberOfPoints, double effectorRadius) const{
+		std::vector<BitmapCoordinate> sweptOffsets;
+		std::vector<BitmapCoordinate> leadingOffsets[6];
+		if(effectorRadius > 0){
+			getSweptOffsets(effectorRadius, sweptOffsets, leadingOffsets);
+		}
+
+		int numberOfSegments = numberOfPoints - 1;
+		int numberOfThreads = boost::thread::hardware_concurrency();
+		if(numberOfThreads > numberOfSegments / MIN_SEGMENTS_PER_THREAD){
+			numberOfThreads = numberOfSegments / MIN_SEGMENTS_PER_THREAD;
+		}
+
+		if(numberOfThreads <= 1){
+			int firstInvalidSegment = -1;
+			checkSegmentRange(points, 0, numberOfSegments, effectorRadius, sweptOffsets, leadingOffsets, firstInvalidSegment);
+			return firstInvalidSegment;
+		}
+
+		// Every thread reports the first invalid segment in its own range, the first of those is the first invalid segment of the path.
+		boost::thread_group threads;
+		int segmentsPerThread = (numberOfSegments + numberOfThreads - 1) / numberOfThreads;
+		std::vector<int> firstInvalidSegments(numberOfThreads, -1);
+		for(int thread = 0; thread < numberOfThreads; thread++){
+			int begin = thread * segmentsPerThread;
+			int end = std::min(begin + segmentsPerThread, numberOfSegments);
+			threads.create_thread(boost::bind(&EffectorBoundaries::checkSegmentRange, this, points, begin, end, effectorRadius, boost::cref(sweptOffsets), boost::cref(leadingOffsets), boost::ref(firstInvalidSegments[thread])));
+		}
+		threads.join_all();
+
+		for(int thread = 0; thread < numberOfThreads; thread++){
+			if(firstInvalidSegments[thread] != -1){
+				return firstInvalidSegments[thread];
 			}
 		}
+		return -1;
+	}
+
+	/**
+	 * Checks a range of segments of a path until the first invalid segment. Used by the worker threads of checkPolyline.
+	 * 
+	 * @param points Array of the points on the path.
+	 * @param begin Index of the first segment to check.
+	 * @param end Index after the last segment to check.
+	 * @param effectorRadius Radius in millimeters around the path that has to be within the boundaries as well.
+	 * @param sweptOffsets The offsets of the voxels covered by the effector, empty to only check the path itself.
+	 * @param leadingOffsets For each step direction the offsets that become covered by the effector.
+	 * @param firstInvalidSegment Set to the index of the first invalid segment in the range, left unchanged if all segments are valid.
+	 **/
+	void EffectorBoundaries::checkSegmentRange(const rexos_datatypes::Point3D<double>* points, int begin, int end, double effectorRadius, const std::vector<BitmapCoordinate>& sweptOffsets, const std::vector<BitmapCoordinate> (&leadingOffsets)[6], int& firstInvalidSegment) const{
+		for(int i = begin; i < end; i++){
+			if(!checkSegment(points[i], points[i + 1], effectorRadius, sweptOffsets, leadingOffsets)){
+				firstInvalidSegment = i;
+				return;
+			}
+		}
+	}
+
+	/**
+	 * Checks a straight segment with a 3D-DDA (Amanatides & Woo), which visits exactly the voxels the segment crosses and stops at the first invalid voxel. Segments that lie within the clearance of their end points are accepted without visiting their voxels.
+	 * 
+	 * @param from The starting point.
+	 * @param to The destination point.
+	 * @param effectorRadius Radius in millimeters around the segment that has to be within the boundaries as well.
+	 * @param sweptOffsets The offsets of the voxels covered by the effector, empty to only check the segment itself.
+	 * @param leadingOffsets For each step direction the offsets that become covered by the effector.
+	 * 
+	 * @return true if the segment is valid.
+	 **/
+	bool EffectorBoundaries::checkSegment(const rexos_datatypes::Point3D<double>& from, const rexos_datatypes::Point3D<double>& to, double effectorRadius, const std::vector<BitmapCoordinate>& sweptOffsets, const std::vector<BitmapCoordinate> (&leadingOffsets)[6]) const{
+		if(isWithinClearance(from, to, effectorRadius)){
+			return true;
+		}
+
+    	// The path in voxel space, where voxel i spans from i up to i + 1.
+    	double start[3] = {
+    		(from.x - Measures::BOUNDARY_BOX_MIN_X) / voxelSize,
+    		(from.y - Measures::BOUNDARY_BOX_MIN_Y) / voxelSize,
+    		(from.z - Measures::BOUNDARY_BOX_MIN_Z) / voxelSize
+    	};
+    	double direction[3] = {
+    		(to.x - from.x) / voxelSize,
+    		(to.y - from.y) / voxelSize,
+    		(to.z - from.z) / voxelSize
+    	};
+
+    	int voxel[3];
+    	int step[3];
+    	// Value of the path parameter t (0 at from, 1 at to) where the path crosses the next voxel border on each axis.
+    	double tMax[3];
+    	// Increase of t needed to cross a whole voxel on each axis.
+    	double tDelta[3];
+    	int numberOfSteps = 0;
+    	for(int axis = 0; axis < 3; axis++){
+    		voxel[axis] = (int) floor(start[axis]);
+    		int lastVoxel = (int) floor(start[axis] + direction[axis]);
+    		numberOfSteps += abs(lastVoxel - voxel[axis]);
+
+    		if(direction[axis] > 0){
+    			step[axis] = 1;
+    			tMax[axis] = (voxel[axis] + 1 - start[axis]) / direction[axis];
+    			tDelta[axis] = 1 / direction[axis];
+    		} else if(direction[axis] < 0){
+    			step[axis] = -1;
+    			tMax[axis] = (start[axis] - voxel[axis]) / -direction[axis];
+    			tDelta[axis] = 1 / -direction[axis];
+    		} else{
+    			step[axis] = 0;
+    			tMax[axis] = std::numeric_limits<double>::infinity();
+    			tDelta[axis] = std::numeric_limits<double>::infinity();
+    		}
+    	}
+
+    	if(!isSweptVoxelValid(BitmapCoordinate(voxel[0], voxel[1], voxel[2]), sweptOffsets)){
+    		return false;
+    	}
+
+    	// Every step crosses one voxel border, so the amount of steps is known beforehand. This avoids rounding errors at the end of the path.
+    	for(int i = 0; i < numberOfSteps; i++){
+    		int axis = tMax[0] < tMax[1] ? (tMax[0] < tMax[2] ? 0 : 2) : (tMax[1] < tMax[2] ? 1 : 2);
+    		voxel[axis] += step[axis];
+    		tMax[axis] += tDelta[axis];
+
+    		// The voxels covered at the previous voxel are already checked, only the leading side of the effector is new.
+    		if(!isSweptVoxelValid(BitmapCoordinate(voxel[0], voxel[1], voxel[2]), sweptOffsets.empty() ? sweptOffsets : leadingOffsets[axis * 2 + (step[axis] > 0 ? 1 : 0)])){
+    			return false;
+    		}
+    	}
         return true;
     }
 
+	/**
+	 * Checks with the distance field whether a segment is covered by the spheres around its end points that lie completely within the boundaries. The segment is covered when the radii of the spheres add up to at least its length.
+	 *
+	 * @param from The starting point.
+	 * @param to The destination point.
+	 * @param effectorRadius Radius in millimeters around the segment that has to be within the boundaries as well.
+	 *
+	 * @return true if the segment is certainly valid, false if it has to be checked voxel by voxel or there is no distance field.
+	 **/
+	bool EffectorBoundaries::isWithinClearance(const rexos_datatypes::Point3D<double>& from, const rexos_datatypes::Point3D<double>& to, double effectorRadius) const{
+		if(!hasDistanceField()){
+			return false;
+		}
+		// Every point on the segment can lie anywhere in its voxel, and so can the end point, which costs a voxel diagonal. The voxels covered by the effector around a voxel reach up to another voxel diagonal further than its radius.
+		double margin = sqrt(3.0);
+		if(effectorRadius > 0){
+			margin += effectorRadius / voxelSize + sqrt(3.0);
+		}
+		double fromRadius = getVoxelDistance(from) - margin;
+		if(fromRadius < 0){
+			return false;
+		}
+		double toRadius = getVoxelDistance(to) - margin;
+		return toRadius >= 0 && from.distance(to) / voxelSize <= fromRadius + toRadius;
+	}
+
+	/**
+	 * Gets the distance in voxels from the voxel of a point to the nearest voxel outside the boundaries.
+	 *
+	 * @param point The point.
+	 *
+	 * @return The distance from the distance field, 0 for points outside the boundary box.
+	 **/
+	int EffectorBoundaries::getVoxelDistance(const rexos_datatypes::Point3D<double>& point) const{
+		int x = (int) floor((point.x - Measures::BOUNDARY_BOX_MIN_X) / voxelSize);
+		int y = (int) floor((point.y - Measures::BOUNDARY_BOX_MIN_Y) / voxelSize);
+		int z = (int) floor((point.z - Measures::BOUNDARY_BOX_MIN_Z) / voxelSize);
+		if(x < 0 || x >= width || y < 0 || y >= depth || z < 0 || z >= height){
+			return 0;
+		}
+		return distanceField[x + y * width + z * width * depth];
+	}
+
+	/**
+	 * Does the one-dimensional distance transform on a range of lines along an axis. For every voxel the squared distance becomes the smallest squared distance of another voxel on the line plus the squared distance between the two, computed from the lower envelope of the parabolas rooted at every voxel. The voxels just outside the boundary box are outside the boundaries, so they are added to both ends of every line. Used by the worker threads of generateDistanceField.
+	 *
+	 * @param squaredDistances The squared distances in voxels of all voxels, updated in place.
+	 * @param axis The axis of the lines: 0 for x, 1 for y and 2 for z.
+	 * @param begin The first line to transform.
+	 * @param end The line after the last line to transform.
+	 **/
+	void EffectorBoundaries::transformDistanceLines(std::vector<uint16_t>& squaredDistances, int axis, int begin, int end) const{
+		int length = axis == 0 ? width : (axis == 1 ? depth : height);
+		int stride = axis == 0 ? 1 : (axis == 1 ? width : width * depth);
+
+		// Position 0 and length + 1 are the voxels just outside the boundary box.
+		std::vector<double> values(length + 2);
+		// The roots of the parabolas in the lower envelope, and from which position on each of them is the lowest.
+		std::vector<int> roots(length + 2);
+		std::vector<double> starts(length + 3);
+
+		for(int line = begin; line < end; line++){
+			int first = axis == 0 ? line * width : (axis == 1 ? line % width + (line / width) * width * depth : line);
+			values[0] = 0;
+			values[length + 1] = 0;
+			for(int i = 0; i < length; i++){
+				values[i + 1] = squaredDistances[first + i * stride];
+			}
+
+			int parabola = 0;
+			roots[0] = 0;
+			starts[0] = -std::numeric_limits<double>::infinity();
+			starts[1] = std::numeric_limits<double>::infinity();
+			for(int root = 1; root < length + 2; root++){
+				// Parabolas of voxels at the maximum distance can never be lower than the maximum distance, so they do not matter.
+				if(values[root] >= MAX_SQUARED_DISTANCE){
+					continue;
+				}
+				double start;
+				while(true){
+					int previousRoot = roots[parabola];
+					start = ((values[root] + root * root) - (values[previousRoot] + previousRoot * previousRoot)) / (2.0 * (root - previousRoot));
+					if(start > starts[parabola]){
+						break;
+					}
+					parabola--;
+				}
+				parabola++;
+				roots[parabola] = root;
+				starts[parabola] = start;
+				starts[parabola + 1] = std::numeric_limits<double>::infinity();
+			}
+
+			parabola = 0;
+			for(int position = 1; position <= length; position++){
+				while(starts[parabola + 1] < position){
+					parabola++;
+				}
+				double squaredDistance = (position - roots[parabola]) * (position - roots[parabola]) + values[roots[parabola]];
+				squaredDistances[first + (position - 1) * stride] = (uint16_t) std::min(squaredDistance, (double) MAX_SQUARED_DISTANCE);
+			}
+		}
+	}
+
+	/**
+	 * Checks if a voxel and the voxels around it covered by the effector are all within the boundaries.
+	 * 
+	 * @param voxel The voxel on the path.
+	 * @param sweptOffsets The offsets of the voxels covered by the effector, empty to only check the voxel itself.
+	 * 
+	 * @return true if all voxels are valid.
+	 **/
+	bool EffectorBoundaries::isSweptVoxelValid(const BitmapCoordinate& voxel, const std::vector<BitmapCoordinate>& sweptOffsets) const{
+		if(sweptOffsets.empty()){
+			return isInBitmap(voxel);
+		}
+		for(std::vector<BitmapCoordinate>::const_iterator it = sweptOffsets.begin(); it != sweptOffsets.end(); ++it){
+			if(!isInBitmap(BitmapCoordinate(voxel.x + it->x, voxel.y + it->y, voxel.z + it->z))){
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Determines the offsets of the voxels that can be covered by a sphere with its centre somewhere in the voxel at offset (0, 0, 0). This is conservative: a voxel is included when any of its points can be within the radius.
+	 * 
+	 * @param radius The radius of the sphere in millimeters.
+	 * @param sweptOffsets The list the offsets are added to.
+	 * @param leadingOffsets For each step direction (-x, +x, -y, +y, -z, +z) the list of offsets that are covered after the step but were not covered before it.
+	 **/
+	void EffectorBoundaries::getSweptOffsets(double radius, std::vector<BitmapCoordinate>& sweptOffsets, std::vector<BitmapCoordinate> (&leadingOffsets)[6]) const{
+		int range = (int) ceil(radius / voxelSize) + 1;
+		int size = 2 * range + 1;
+		double radiusInVoxels = radius / voxelSize;
+		std::vector<bool> isCovered(size * size * size, false);
+		for(int z = -range; z <= range; z++){
+			for(int y = -range; y <= range; y++){
+				for(int x = -range; x <= range; x++){
+					// Smallest distance between a point in voxel (0, 0, 0) and a point in voxel (x, y, z), per axis.
+					double distanceX = std::max(abs(x) - 1, 0);
+					double distanceY = std::max(abs(y) - 1, 0);
+					double distanceZ = std::max(abs(z) - 1, 0);
+					if(distanceX * distanceX + distanceY * distanceY + distanceZ * distanceZ <= radiusInVoxels * radiusInVoxels){
+						sweptOffsets.push_back(BitmapCoordinate(x, y, z));
+						isCovered[(x + range) + (y + range) * size + (z + range) * size * size] = true;
+					}
+				}
+			}
+		}
+
+		// An offset is leading in a direction when the same voxel was not covered from the previous voxel on the path, where it had an offset one step further.
+		for(std::vector<BitmapCoordinate>::iterator it = sweptOffsets.begin(); it != sweptOffsets.end(); ++it){
+			for(int direction = 0; direction < 6; direction++){
+				int step = direction % 2 == 0 ? -1 : 1;
+				int previousX = it->x + (direction / 2 == 0 ? step : 0) + range;
+				int previousY = it->y + (direction / 2 == 1 ? step : 0) + range;
+				int previousZ = it->z + (direction / 2 == 2 ? step : 0) + range;
+				if(previousX < 0 || previousX >= size || previousY < 0 || previousY >= size || previousZ < 0 || previousZ >= size
+						|| !isCovered[previousX + previousY * size + previousZ * size * size]){
+					leadingOffsets[direction].push_back(*it);
+				}
+			}
+		}
+	}
+
 	/**
 	 * Private constructor, it also initializes the voxel array.
 	 * 
@@ -122,16 +856,23 @@ namespace rexos_delta_robot{
     	height(0), 
     	depth(0), 
     	boundariesBitmap(NULL), 
+    	mappedBitmap(NULL), 
     	kinematics(model),  
     	voxelSize(voxelSize) {
     		for(int i = 0; i < 3; i++){
     			this->motorMinAngles[i] = motorMinAngles[i];
     			this->motorMaxAngles[i] = motorMaxAngles[i];
     		}
+
+			// Create boundaries variables in voxel space by dividing real space variables with the voxel size
+			width = (Measures::BOUNDARY_BOX_MAX_X  - Measures::BOUNDARY_BOX_MIN_X) / voxelSize;
+			height = (Measures::BOUNDARY_BOX_MAX_Z - Measures::BOUNDARY_BOX_MIN_Z) / voxelSize;
+			depth = (Measures::BOUNDARY_BOX_MAX_Y  - Measures::BOUNDARY_BOX_MIN_Y) / voxelSize;
     	}
 
     EffectorBoundaries::~EffectorBoundaries(){
-    	delete[] boundariesBitmap;
+    	delete boundariesBitmap;
+    	delete mappedBitmap;
     }
 
 	/**
@@ -142,7 +883,7 @@ namespace rexos_delta_robot{
 	 *
 	 * @return True if coordinate has unreachable neighbouring voxels.
 	 **/
-	bool EffectorBoundaries::hasInvalidNeighbours(const BitmapCoordinate& coordinate, char* pointValidityCache) const{
+	bool EffectorBoundaries::hasInvalidNeighbours(const BitmapCoordinate& coordinate, uint8_t* pointValidityCache) const{
 		//TODO: Change from has_invalid_neighbours to isOnTheEdgeOfValidArea due to functionality change.
 
     	// Check if the voxel is valid and on the edge of the box.
@@ -169,66 +910,124 @@ namespace rexos_delta_robot{
     }
 
 	/**
-	 * Checks if the point can be reached by the effector. Whether the point can be reached is determined by the kinematics, minimum and maximum angles of the motors and the MIN/BOUNDARY_BOX_MAX_X/Y/Z box determined in measures.
+	 * Checks if the point can be reached by the effector, using the pointValidityCache. Points that are not in the cache yet are checked with isReachable and stored in the cache.
 	 * @param coordinate The point that is checked if it can be reached by the effector.
 	 * @param pointValidityCache Pointer to the cache where already checked values are stored, and unchecked points are unknown. This as opposed to the bitmap, which is defaulted to false instead of unknown.
 	 * 
 	 * @return true if coordinate is reachable by the effector.
 	 **/
-    bool EffectorBoundaries::isValid(const BitmapCoordinate& coordinate, char* pointValidityCache) const{
-    	char* fromCache;
-    	char dummy = UNKNOWN;
-    	if(pointValidityCache == NULL){
-    		fromCache = &dummy;
-    	} else{
-    		fromCache = &pointValidityCache[coordinate.x + coordinate.y * width + coordinate.z * width * depth];
+    bool EffectorBoundaries::isValid(const BitmapCoordinate& coordinate, uint8_t* pointValidityCache) const{
+    	int index = coordinate.x + coordinate.y * width + coordinate.z * width * depth;
+    	cacheEntry fromCache = getCacheEntry(pointValidityCache, index);
+    	if(fromCache == UNKNOWN){
+    		fromCache = isReachable(coordinate) ? VALID : INVALID;
+    		setCacheEntry(pointValidityCache, index, fromCache);
     	}
+    	return fromCache == VALID;
+    }
 
-    	if(*fromCache == UNKNOWN){
-    		rexos_datatypes::MotorRotation* rotations[3];
-    		rotations[0] = new rexos_datatypes::MotorRotation();
-    		rotations[1] = new rexos_datatypes::MotorRotation();
-    		rotations[2] = new rexos_datatypes::MotorRotation();
+	/**
+	 * Checks if the point can be reached by the effector. Whether the point can be reached is determined by the kinematics, minimum and maximum angles of the motors and the MIN/BOUNDARY_BOX_MAX_X/Y/Z box determined in measures. This function does not use the pointValidityCache, so it can be called from multiple threads.
+	 * @param coordinate The point that is checked if it can be reached by the effector.
+	 * 
+	 * @return true if coordinate is reachable by the effector.
+	 **/
+    bool EffectorBoundaries::isReachable(const BitmapCoordinate& coordinate) const{
+    	double angles[3];
+    	return kinematics.solveMotorAngles(fromBitmapCoordinate(coordinate), angles) == InverseKinematicsModel::SOLVED
+    		&& isWithinMotorLimits(angles[0], angles[1], angles[2]);
+    }
 
-			try{
-				kinematics.destinationPointToMotorRotations(fromBitmapCoordinate(coordinate), rotations);
-			} catch(rexos_delta_robot::InverseKinematicsException & exception){
-				*fromCache = INVALID;
-				delete rotations[0];
-				delete rotations[1];
-				delete rotations[2];
-				return false;
-			}
+	/**
+	 * Evaluates whether a range of voxels can be reached by the effector. Used by the worker threads of evaluateVoxels.
+	 *
+	 * @param voxels The indices of the voxels that have to be evaluated.
+	 * @param begin Position in voxels of the first voxel to evaluate.
+	 * @param end Position in voxels after the last voxel to evaluate.
+	 * @param results The list the results are stored in, at the same position as the voxel in voxels.
+	 **/
+	void EffectorBoundaries::evaluateVoxelRange(const std::vector<int>& voxels, int begin, int end, std::vector<char>& results) const{
+		for(int i = begin; i < end; i++){
+			int index = voxels[i];
+			results[i] = isReachable(BitmapCoordinate(index % width, (index % (width * depth)) / width, index / (width * depth))) ? VALID : INVALID;
+		}
+	}
+
+	/**
+	 * Evaluates the validity of all given voxels and stores the result in the pointValidityCache. The voxels are divided over all available cores. The threads store their results in a separate list, because entries in the pointValidityCache share bytes with other entries.
+	 *
+	 * @param voxels The indices of the voxels that have to be evaluated.
+	 * @param pointValidityCache Pointer to the cache where the results are stored.
+	 **/
+	void EffectorBoundaries::evaluateVoxels(const std::vector<int>& voxels, uint8_t* pointValidityCache) const{
+		int numberOfVoxels = voxels.size();
+		int numberOfThreads = boost::thread::hardware_concurrency();
+		if(numberOfThreads > numberOfVoxels / MIN_VOXELS_PER_THREAD){
+			numberOfThreads = numberOfVoxels / MIN_VOXELS_PER_THREAD;
+		}
 
-			// Check motor angles.
-			if(rotations[0]->angle <= motorMinAngles[0] || rotations[0]->angle >= motorMaxAngles[0] 
-			|| rotations[1]->angle <= motorMinAngles[1] || rotations[1]->angle >= motorMaxAngles[1] 
-			|| rotations[2]->angle <= motorMinAngles[2] || rotations[2]->angle >= motorMaxAngles[2]){
-			  	*fromCache = INVALID;
-				delete rotations[0];
-				delete rotations[1];
-				delete rotations[2];
-			  	return false;
+		std::vector<char> results(numberOfVoxels);
+		if(numberOfThreads <= 1){
+			evaluateVoxelRange(voxels, 0, numberOfVoxels, results);
+		} else{
+			boost::thread_group threads;
+			int voxelsPerThread = (numberOfVoxels + numberOfThreads - 1) / numberOfThreads;
+			for(int begin = 0; begin < numberOfVoxels; begin += voxelsPerThread){
+				int end = std::min(begin + voxelsPerThread, numberOfVoxels);
+				threads.create_thread(boost::bind(&EffectorBoundaries::evaluateVoxelRange, this, boost::cref(voxels), begin, end, boost::ref(results)));
 			}
+			threads.join_all();
+		}
 
-			*fromCache = VALID;
+		for(int i = 0; i < numberOfVoxels; i++){
+			setCacheEntry(pointValidityCache, voxels[i], (cacheEntry) results[i]);
+		}
+	}
 
-			delete rotations[0];
-			delete rotations[1];
-			delete rotations[2];
-			return true;
-    	} else{
-    		return *fromCache == VALID;
-    	}
-    }
+	/**
+	 * Adds the indices of the voxels in the 3x3x3 box around a voxel, that lie within the MIN/BOUNDARY_BOX_MAX_X/Y/Z box, to a list.
+	 *
+	 * @param index The index of the voxel in the middle of the box.
+	 * @param neighbours The list the indices are added to.
+	 **/
+	void EffectorBoundaries::addNeighbours(int index, std::vector<int>& neighbours) const{
+		int x = index % width;
+		int y = (index % (width * depth)) / width;
+		int z = index / (width * depth);
+		for(int neighbourY = y - 1; neighbourY <= y + 1; neighbourY++){
+			for(int neighbourX = x - 1; neighbourX <= x + 1; neighbourX++){
+				for(int neighbourZ = z - 1; neighbourZ <= z + 1; neighbourZ++){
+					if(neighbourZ < height && neighbourZ >= 0 && neighbourX < width && neighbourX >= 0 && neighbourY < depth && neighbourY >= 0){
+						neighbours.push_back(neighbourX + neighbourY * width + neighbourZ * width * depth);
+					}
+				}
+			}
+		}
+	}
+
+	/**
+	 * Adds a voxel to a list of voxels that have to be evaluated, if its validity is not known yet and it is not in a list already. The voxel is marked as PENDING in the pointValidityCache.
+	 *
+	 * @param index The index of the voxel.
+	 * @param unknownVoxels The list of voxels that have to be evaluated.
+	 * @param pointValidityCache Pointer to the cache where already checked values are stored.
+	 **/
+	inline void EffectorBoundaries::addUnknownVoxel(int index, std::vector<int>& unknownVoxels, uint8_t* pointValidityCache) const{
+		if(getCacheEntry(pointValidityCache, index) == UNKNOWN){
+			setCacheEntry(pointValidityCache, index, PENDING);
+			unknownVoxels.push_back(index);
+		}
+	}
 
 	/**
 	 * Generates boundaries bitmap for the robot. From the centre of the BOUNDARY_BOX voxels are checked and set to true in the bitmap if they are reachable. All members should be initialized before calling this function.
+	 *
+	 * The border of the valid area is traced one layer of voxels at a time. For every layer the voxels that have not been evaluated yet are collected first and then evaluated in parallel, so each voxel is run through the kinematics exactly once and all cores are used.
 	 **/
     void EffectorBoundaries::generateBoundariesBitmap(void){
-    	char* pointValidityCache = new char[width * depth * height];
-    	memset(pointValidityCache, 0, width * depth * height * sizeof(char));
-    	std::stack<BitmapCoordinate> cstack;
+    	int cacheSize = (width * depth * height + CACHE_ENTRIES_PER_BYTE - 1) / CACHE_ENTRIES_PER_BYTE;
+    	std::vector<uint8_t> cache(cacheSize, 0);
+    	uint8_t* pointValidityCache = &cache[0];
 
     	// Determine the center of the box.
     	rexos_datatypes::Point3D<double> point (0, 0, Measures::BOUNDARY_BOX_MIN_Z + (Measures::BOUNDARY_BOX_MAX_Z - Measures::BOUNDARY_BOX_MIN_Z) / 2);
@@ -237,72 +1036,99 @@ namespace rexos_delta_robot{
     	if(!isValid(fromRealCoordinate(point), pointValidityCache)){
     		throw EffectorBoundariesException("starting point outside of valid area, please adjust BOUNDARY_BOX_MAX/BOUNDARY_BOX_MIN_X/Y/Z values to have a valid center");
     	}
+
+    	// The border voxels found in the previous layer. Their neighbours are the candidates for the next layer.
+    	std::vector<int> borderVoxels;
+    	outerBorder.clear();
     	
     	// Scan towards the right.
 		for(; point.x < Measures::BOUNDARY_BOX_MAX_X; point.x += voxelSize){
 			// If an invalid voxel is found:
 			// - step back to the last valid voxel
-			// - push the voxel on the empty stack
+			// - add the voxel to the border voxels
 			// - set the voxel as true in the bitmap
 			// - end the loop
 			if(!isValid(fromRealCoordinate(point), pointValidityCache)){
 				point.x -= voxelSize;
 				BitmapCoordinate startingVoxel = fromRealCoordinate(point);
-				cstack.push(startingVoxel);
-				boundariesBitmap[startingVoxel.x + startingVoxel.y * width + startingVoxel.z * width * depth] = true;
+				borderVoxels.push_back(startingVoxel.x + startingVoxel.y * width + startingVoxel.z * width * depth);
+				boundariesBitmap->set(borderVoxels.back(), true);
 				break;
 			}
 		}
-		// If the right-most voxel is in reach and an invalid voxel is never found, the position of point.x will be outside of the box limits. Step back inside the box and add that voxel to the stack and set it as true in the bitmap.
+		// If the right-most voxel is in reach and an invalid voxel is never found, the position of point.x will be outside of the box limits. Step back inside the box and add that voxel to the border voxels and set it as true in the bitmap.
 		if(point.x >= Measures::BOUNDARY_BOX_MAX_X){
 			point.x -= voxelSize;
 			BitmapCoordinate startingVoxel = fromRealCoordinate(point);
-			cstack.push(startingVoxel);
-			boundariesBitmap[startingVoxel.x + startingVoxel.y * width + startingVoxel.z * width * depth] = true;
-		}
-
-		// Start with the last added voxel on the stack and add new voxels to the stack. Do this until the valid borders (all valid voxels bordering unvalid voxels or the BOUNDARY_BOX_MAX/BOUNDARY_BOX_MIN_X/Y/Z box) of the valid voxel area are known (stack = empty).
-		while(!cstack.empty()){
-			// Get last added voxel from the stack and remove it from the stack.
-			BitmapCoordinate borderVoxel = cstack.top();
-			cstack.pop();
-
-			// Check all neighbours of the voxel.
-			for(int y = borderVoxel.y - 1; y <= borderVoxel.y + 1; y++){
-				for(int x = borderVoxel.x - 1; x <= borderVoxel.x + 1; x++){
-					for(int z = borderVoxel.z - 1; z <= borderVoxel.z + 1; z++){
-						// Don't do anything with voxels outside of the BOUNDARY_BOX_MAX/BOUNDARY_BOX_MIN_X/Y/Z box.
-						if(z >= height || z < 0 || x >= width || x < 0 || y >= depth || y < 0){
-							continue;
-						} else{
-							// New valid voxels on the valid border are added to the stack and set in the bitmap.
-							int index = x + y * width + z * width * depth;
-							if(isValid(BitmapCoordinate(x, y, z), pointValidityCache)
-									&& !boundariesBitmap[index]
-								    && hasInvalidNeighbours(BitmapCoordinate(x, y, z), pointValidityCache)){
-								BitmapCoordinate bitmapCoordinate = BitmapCoordinate(x, y, z);
-								cstack.push(bitmapCoordinate);
-								boundariesBitmap[index] = true;
-							}
-						}
+			borderVoxels.push_back(startingVoxel.x + startingVoxel.y * width + startingVoxel.z * width * depth);
+			boundariesBitmap->set(borderVoxels.back(), true);
+		}
+
+		// Grow the border one layer at a time. Do this until the valid borders (all valid voxels bordering unvalid voxels or the BOUNDARY_BOX_MAX/BOUNDARY_BOX_MIN_X/Y/Z box) of the valid voxel area are known (no new border voxels are found).
+		std::vector<int> candidates;
+		std::vector<int> neighbours;
+		std::vector<int> unknownVoxels;
+		while(!borderVoxels.empty()){
+			// All neighbours of the border voxels that are not yet part of the border are candidates.
+			candidates.clear();
+			for(std::vector<int>::iterator it = borderVoxels.begin(); it != borderVoxels.end(); ++it){
+				addNeighbours(*it, candidates);
+			}
+
+			// Evaluate the candidates.
+			unknownVoxels.clear();
+			for(std::vector<int>::iterator it = candidates.begin(); it != candidates.end(); ++it){
+				if(!boundariesBitmap->get(*it)){
+					addUnknownVoxel(*it, unknownVoxels, pointValidityCache);
+				}
+			}
+			evaluateVoxels(unknownVoxels, pointValidityCache);
+
+			// Evaluate the neighbours of the valid candidates, these are needed to determine whether a candidate is on the border.
+			unknownVoxels.clear();
+			for(std::vector<int>::iterator it = candidates.begin(); it != candidates.end(); ++it){
+				if(!boundariesBitmap->get(*it) && getCacheEntry(pointValidityCache, *it) == VALID){
+					neighbours.clear();
+					addNeighbours(*it, neighbours);
+					for(std::vector<int>::iterator neighbour = neighbours.begin(); neighbour != neighbours.end(); ++neighbour){
+						addUnknownVoxel(*neighbour, unknownVoxels, pointValidityCache);
 					}
 				}
 			}
+			evaluateVoxels(unknownVoxels, pointValidityCache);
+
+			// New valid voxels on the valid border are set in the bitmap and form the next layer.
+			outerBorder.insert(outerBorder.end(), borderVoxels.begin(), borderVoxels.end());
+			borderVoxels.clear();
+			for(std::vector<int>::iterator it = candidates.begin(); it != candidates.end(); ++it){
+				int index = *it;
+				BitmapCoordinate coordinate(index % width, (index % (width * depth)) / width, index / (width * depth));
+				if(!boundariesBitmap->get(index) && hasInvalidNeighbours(coordinate, pointValidityCache)){
+					borderVoxels.push_back(index);
+					boundariesBitmap->set(index, true);
+				}
+			}
 		}
+		std::vector<int>(outerBorder).swap(outerBorder);
 
-		delete[] pointValidityCache;
+		// The cache is no longer needed.
+		std::vector<uint8_t>().swap(cache);
 		pointValidityCache = NULL;
 		
 		// Adds all the points within the boundaries.
-		cstack.push(fromRealCoordinate(rexos_datatypes::Point3D<double>(0, 0, Measures::BOUNDARY_BOX_MIN_Z + (Measures::BOUNDARY_BOX_MAX_Z - Measures::BOUNDARY_BOX_MIN_Z) / 2)));
-		while(!cstack.empty()){
-			BitmapCoordinate validVoxel = cstack.top();
-			cstack.pop();
-			
-			if(validVoxel.x <= 0 || validVoxel.x >= width || validVoxel.y <= 0 || validVoxel.y >= depth || validVoxel.z <= 0 || validVoxel.z >= height){
+		BitmapCoordinate center = fromRealCoordinate(rexos_datatypes::Point3D<double>(0, 0, Measures::BOUNDARY_BOX_MIN_Z + (Measures::BOUNDARY_BOX_MAX_Z - Measures::BOUNDARY_BOX_MIN_Z) / 2));
+		std::vector<int> validVoxels;
+		validVoxels.push_back(center.x + center.y * width + center.z * width * depth);
+		while(!validVoxels.empty()){
+			int index = validVoxels.back();
+			validVoxels.pop_back();
+
+			int x = index % width;
+			int y = (index % (width * depth)) / width;
+			int z = index / (width * depth);
+			if(x <= 0 || x >= width || y <= 0 || y >= depth || z <= 0 || z >= height){
 				continue;
 			}
-			int index = validVoxel.x + validVoxel.y * width + validVoxel.z * width * depth;
 
 			int indices[6] = {
 				index - 1, 
@@ -315,12 +1141,185 @@ namespace rexos_delta_robot{
 
 			for(unsigned int i = 0; i < ( sizeof(indices) / sizeof(indices[0]) ); i++){
 				if(indices[i] < ((width*height*depth))){
-					if(boundariesBitmap[indices[i]] == false){
-						boundariesBitmap[indices[i]] = true;
-						cstack.push(BitmapCoordinate(indices[i] % width, (indices[i] % (width * depth)) / width, indices[i] / (width * depth)));
+					if(!boundariesBitmap->get(indices[i])){
+						boundariesBitmap->set(indices[i], true);
+						validVoxels.push_back(indices[i]);
 					}
 				}
 			}	
 		}
 	}
+
+	/**
+	 * Updates the boundaries bitmap after the motor limits changed, without going over the whole bitmap. The border of the valid area is moved inwards as long as voxels on it are no longer reachable, and outwards as long as voxels next to it became reachable. Each layer is evaluated in parallel, like in generateBoundariesBitmap. Afterwards the outerBorder is determined again from the old border and the voxels around the changed voxels.
+	 *
+	 * @param mayShrink Whether one of the limits became narrower, so voxels can become unreachable.
+	 * @param mayGrow Whether one of the limits became wider, so voxels can become reachable.
+	 **/
+	void EffectorBoundaries::updateBoundariesBitmap(bool mayShrink, bool mayGrow){
+		std::vector<uint8_t> cache((width * depth * height + CACHE_ENTRIES_PER_BYTE - 1) / CACHE_ENTRIES_PER_BYTE, 0);
+		uint8_t* pointValidityCache = &cache[0];
+
+		std::vector<int> changedVoxels;
+		std::vector<int> layer;
+		std::vector<int> nextLayer;
+		std::vector<int> neighbours;
+
+		// Remove the voxels that are no longer reachable, starting at the border and continuing with the neighbours of every removed voxel.
+		if(mayShrink){
+			for(std::vector<int>::iterator it = outerBorder.begin(); it != outerBorder.end(); ++it){
+				addUnknownVoxel(*it, layer, pointValidityCache);
+			}
+			while(!layer.empty()){
+				evaluateVoxels(layer, pointValidityCache);
+				nextLayer.clear();
+				for(std::vector<int>::iterator it = layer.begin(); it != layer.end(); ++it){
+					if(getCacheEntry(pointValidityCache, *it) == INVALID && boundariesBitmap->get(*it)){
+						boundariesBitmap->set(*it, false);
+						changedVoxels.push_back(*it);
+						neighbours.clear();
+						addNeighbours(*it, neighbours);
+						for(std::vector<int>::iterator neighbour = neighbours.begin(); neighbour != neighbours.end(); ++neighbour){
+							if(boundariesBitmap->get(*neighbour)){
+								addUnknownVoxel(*neighbour, nextLayer, pointValidityCache);
+							}
+						}
+					}
+				}
+				layer.swap(nextLayer);
+			}
+		}
+
+		// The remaining border voxels, and the voxels that were next to removed voxels, now form the edge of the valid area.
+		std::vector<int> candidates;
+		for(std::vector<int>::iterator it = outerBorder.begin(); it != outerBorder.end(); ++it){
+			if(boundariesBitmap->get(*it)){
+				candidates.push_back(*it);
+			}
+		}
+		for(std::vector<int>::iterator it = changedVoxels.begin(); it != changedVoxels.end(); ++it){
+			neighbours.clear();
+			addNeighbours(*it, neighbours);
+			for(std::vector<int>::iterator neighbour = neighbours.begin(); neighbour != neighbours.end(); ++neighbour){
+				if(boundariesBitmap->get(*neighbour)){
+					candidates.push_back(*neighbour);
+				}
+			}
+		}
+
+		// Add the voxels that became reachable, starting next to the edge and continuing with the neighbours of every added voxel.
+		if(mayGrow){
+			layer.clear();
+			for(std::vector<int>::iterator it = candidates.begin(); it != candidates.end(); ++it){
+				neighbours.clear();
+				addNeighbours(*it, neighbours);
+				for(std::vector<int>::iterator neighbour = neighbours.begin(); neighbour != neighbours.end(); ++neighbour){
+					if(!boundariesBitmap->get(*neighbour)){
+						addUnknownVoxel(*neighbour, layer, pointValidityCache);
+					}
+				}
+			}
+			while(!layer.empty()){
+				evaluateVoxels(layer, pointValidityCache);
+				nextLayer.clear();
+				for(std::vector<int>::iterator it = layer.begin(); it != layer.end(); ++it){
+					if(getCacheEntry(pointValidityCache, *it) == VALID){
+						boundariesBitmap->set(*it, true);
+						changedVoxels.push_back(*it);
+						candidates.push_back(*it);
+						neighbours.clear();
+						addNeighbours(*it, neighbours);
+						for(std::vector<int>::iterator neighbour = neighbours.begin(); neighbour != neighbours.end(); ++neighbour){
+							if(!boundariesBitmap->get(*neighbour)){
+								addUnknownVoxel(*neighbour, nextLayer, pointValidityCache);
+							}
+						}
+					}
+				}
+				layer.swap(nextLayer);
+			}
+		}
+
+		// Determine the new border. The neighbours of the candidates are evaluated in parallel first, as hasInvalidNeighbours needs them.
+		std::sort(candidates.begin(), candidates.end());
+		candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+		layer.clear();
+		for(std::vector<int>::iterator it = candidates.begin(); it != candidates.end(); ++it){
+			neighbours.clear();
+			addNeighbours(*it, neighbours);
+			for(std::vector<int>::iterator neighbour = neighbours.begin(); neighbour != neighbours.end(); ++neighbour){
+				addUnknownVoxel(*neighbour, layer, pointValidityCache);
+			}
+		}
+		evaluateVoxels(layer, pointValidityCache);
+
+		outerBorder.clear();
+		for(std::vector<int>::iterator it = candidates.begin(); it != candidates.end(); ++it){
+			int index = *it;
+			if(boundariesBitmap->get(index) && hasInvalidNeighbours(BitmapCoordinate(index % width, (index % (width * depth)) / width, index / (width * depth)), pointValidityCache)){
+				outerBorder.push_back(index);
+			}
+		}
+		std::vector<int>(outerBorder).swap(outerBorder);
+	}
+
+	/**
+	 * Finds the outerBorder from the boundaries bitmap, for boundaries that were loaded instead of generated. A voxel is on the border when it is valid and lies on the edge of the box or has a neighbour in the 3x3x3 box around it that is not valid.
+	 * The voxels whose whole 3x3x3 box is valid are found by eroding the bitmap along x and y one layer at a time, and along z over the last three layers. Every voxel is read from the bitmap once and none are run through the kinematics.
+	 **/
+	void EffectorBoundaries::findOuterBorder(){
+		int layerSize = width * depth;
+		const DenseVoxelStorage* denseBitmap = dynamic_cast<const DenseVoxelStorage*>(boundariesBitmap);
+		std::vector<char> valid(3 * layerSize);
+		std::vector<char> eroded(3 * layerSize);
+		std::vector<char> erodedX(layerSize);
+
+		outerBorder.clear();
+		for(int z = 0; z <= height; z++){
+			if(z < height){
+				char* layerValid = &valid[(z % 3) * layerSize];
+				char* layerEroded = &eroded[(z % 3) * layerSize];
+				if(denseBitmap != NULL){
+					// Read the bits of the dense bitmap directly instead of through the storage interface.
+					const uint64_t* words = denseBitmap->getWords();
+					for(int index = 0, voxel = z * layerSize; index < layerSize; index++, voxel++){
+						layerValid[index] = (words[voxel / 64] >> (voxel % 64)) & 1;
+					}
+				} else{
+					for(int index = 0; index < layerSize; index++){
+						layerValid[index] = boundariesBitmap->get(index + z * layerSize);
+					}
+				}
+				// The voxels on the edge of the layer have no neighbours on one side, so they stay out of the eroded layer.
+				for(int index = 1; index < layerSize - 1; index++){
+					erodedX[index] = layerValid[index - 1] & layerValid[index] & layerValid[index + 1];
+				}
+				for(int y = 0; y < depth; y++){
+					erodedX[y * width] = 0;
+					erodedX[y * width + width - 1] = 0;
+				}
+				memset(layerEroded, 0, width);
+				for(int index = width; index < layerSize - width; index++){
+					layerEroded[index] = erodedX[index - width] & erodedX[index] & erodedX[index + width];
+				}
+				memset(layerEroded + layerSize - width, 0, width);
+			}
+
+			// The layer below this one is complete, its voxels on the edge of the box are always on the border.
+			if(z > 0){
+				int borderZ = z - 1;
+				bool onEdge = borderZ == 0 || borderZ == height - 1;
+				const char* layerValid = &valid[(borderZ % 3) * layerSize];
+				const char* erodedBelow = &eroded[((borderZ + 2) % 3) * layerSize];
+				const char* erodedMiddle = &eroded[(borderZ % 3) * layerSize];
+				const char* erodedAbove = &eroded[(z % 3) * layerSize];
+				for(int index = 0; index < layerSize; index++){
+					if(layerValid[index] & (onEdge | !(erodedBelow[index] & erodedMiddle[index] & erodedAbove[index]))){
+						outerBorder.push_back(index + borderZ * layerSize);
+					}
+				}
+			}
+		}
+		std::vector<int>(outerBorder).swap(outerBorder);
+	}
 }
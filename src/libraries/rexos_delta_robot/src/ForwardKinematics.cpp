@@ -0,0 +1,146 @@
+/**
+ * @file ForwardKinematics.cpp
+ * @brief Forward kinematics implementation.\n
+ * conventions sitting in front of delta robot:\n
+ * x-axis goes from left to right\n
+ * y-axis goes from front to back\n
+ * z-axis goes from bottom to top\n
+ * point (0,0,0) lies in the middle of all the motors at the motor's height
+ *
+ * @section LICENSE
+ * License: newBSD
+ *  
+ * Copyright © 2012, HU University of Applied Sciences Utrecht.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **/
+
+#include <cmath>
+#include <rexos_delta_robot/ForwardKinematics.h>
+#include <rexos_utilities/Utilities.h>
+
+namespace rexos_delta_robot{
+	/**
+	 * Constructor for forward kinematics.
+	 *
+	 * @param base Radius of the base in millimeters.
+	 * @param hip Length of the hip in millimeters.
+	 * @param effector Radius of the effector in millimeters.
+	 * @param ankle Length of the ankle in millimeters.
+	 **/
+	ForwardKinematics::ForwardKinematics(const double base, const double hip, const double effector, const double ankle) :
+			base(base), hip(hip), effector(effector), ankle(ankle){
+	}
+
+	/**
+	 * Constructor for forward kinematics.
+	 * 
+	 * @param deltaRobotMeasures The measures of the deltarobot configuration.
+	 **/
+	ForwardKinematics::ForwardKinematics(rexos_datatypes::DeltaRobotMeasures& deltaRobotMeasures) :
+			base(deltaRobotMeasures.base), hip(deltaRobotMeasures.hip), effector(deltaRobotMeasures.effector), ankle(deltaRobotMeasures.ankle){
+	}
+
+	/**
+	 * Calculates the location of the midpoint of the effector from the motor angles.
+	 *
+	 * Every ankle connects the knee of its hip to the effector, so the midpoint of the effector lies on a sphere with the length of the ankle as radius around the knee, shifted by the radius of the effector towards the middle. The effector is located where the three spheres intersect. Of the two intersections the lower one is used, since the effector hangs below the motors.
+	 *
+	 * @param angles The angles of the motors in radians, in the order of InverseKinematics::destinationPointToMotorRotations.
+	 * @param destinationPoint Set to the location of the midpoint of the effector.
+	 *
+	 * @return true if the angles result in a location, false if the spheres don't intersect.
+	 **/
+	bool ForwardKinematics::motorAnglesToDestinationPoint(const double (&angles)[3], rexos_datatypes::Point3D<double>& destinationPoint) const throw(){
+		// Same order as InverseKinematics::destinationPointToMotorRotations.
+		double motorLocations[3] = {
+			rexos_utilities::degreesToRadians(1 * 120),
+			rexos_utilities::degreesToRadians(0 * 120),
+			rexos_utilities::degreesToRadians(2 * 120)
+		};
+
+		// The centres of the spheres. For a motor in front (0 degrees) the knee is at (0, -base + hip * cos(rho), hip * sin(rho)), where rho is the motor angle minus 180 degrees.
+		double centres[3][3];
+		for(int i = 0; i < 3; i++){
+			double rho = angles[i] - rexos_utilities::degreesToRadians(180);
+			rexos_datatypes::Point3D<double> centre = rexos_datatypes::Point3D<double>(
+					0, -base + effector + hip * cos(rho), hip * sin(rho)).rotateAroundZAxis(motorLocations[i]);
+			centres[i][0] = centre.x;
+			centres[i][1] = centre.y;
+			centres[i][2] = centre.z;
+		}
+
+		// Trilateration with all radii equal to the ankle. Build an orthonormal base (ex, ey, ez) with the first centre as origin.
+		double ex[3], ey[3], ez[3];
+		double toThird[3];
+		double d = 0;
+		for(int axis = 0; axis < 3; axis++){
+			ex[axis] = centres[1][axis] - centres[0][axis];
+			toThird[axis] = centres[2][axis] - centres[0][axis];
+			d += ex[axis] * ex[axis];
+		}
+		d = sqrt(d);
+		if(d == 0){
+			return false;
+		}
+
+		double i = 0;
+		for(int axis = 0; axis < 3; axis++){
+			ex[axis] /= d;
+			i += ex[axis] * toThird[axis];
+		}
+
+		double eyLength = 0;
+		for(int axis = 0; axis < 3; axis++){
+			ey[axis] = toThird[axis] - i * ex[axis];
+			eyLength += ey[axis] * ey[axis];
+		}
+		eyLength = sqrt(eyLength);
+		if(eyLength == 0){
+			return false;
+		}
+
+		double j = 0;
+		for(int axis = 0; axis < 3; axis++){
+			ey[axis] /= eyLength;
+			j += ey[axis] * toThird[axis];
+		}
+
+		ez[0] = ex[1] * ey[2] - ex[2] * ey[1];
+		ez[1] = ex[2] * ey[0] - ex[0] * ey[2];
+		ez[2] = ex[0] * ey[1] - ex[1] * ey[0];
+
+		double x = d / 2;
+		double y = (i * i + j * j) / (2 * j) - (i / j) * x;
+		double zSquared = ankle * ankle - x * x - y * y;
+		if(zSquared < 0){
+			return false;
+		}
+		double z = sqrt(zSquared);
+
+		// Pick the lower of the two intersections.
+		double lower[3], upper[3];
+		for(int axis = 0; axis < 3; axis++){
+			lower[axis] = centres[0][axis] + x * ex[axis] + y * ey[axis] - z * ez[axis];
+			upper[axis] = centres[0][axis] + x * ex[axis] + y * ey[axis] + z * ez[axis];
+		}
+		double* result = lower[2] < upper[2] ? lower : upper;
+		destinationPoint = rexos_datatypes::Point3D<double>(result[0], result[1], result[2]);
+		return true;
+	}
+}
@@ -67,7 +67,7 @@ namespace rexos_delta_robot {
 	 **/
 	InverseKinematics::InverseKinematics(rexos_datatypes::DeltaRobotMeasures & deltaRobotMeasures) :
 			InverseKinematicsModel(deltaRobotMeasures.base, deltaRobotMeasures.hip, deltaRobotMeasures.effector, deltaRobotMeasures.ankle, deltaRobotMeasures.maxAngleHipAnkle){
-	}	
+	}
 
 	InverseKinematics::~InverseKinematics(void){
 	}
@@ -77,10 +77,11 @@ namespace rexos_delta_robot {
 	 * 
 	 * @param destinationPoint Point where the midpoint of the effector is wanted.
 	 * @param motorLocation Angle of the motor on the z axis where 0 radians is directly in front of the deltarobot.
+	 * @param angle Set to the angle, in radians, the motor should move to.
 	 * 
-	 * @return The angle, in radians, the motor should move to.
+	 * @return SOLVED if the point can be reached, otherwise the reason it can't be reached.
 	 **/
-	double InverseKinematics::motorAngle(const rexos_datatypes::Point3D<double>& destinationPoint, double motorLocation) const{
+	InverseKinematics::SolveStatus InverseKinematics::motorAngle(const rexos_datatypes::Point3D<double>& destinationPoint, double motorLocation, double& angle) const throw(){
 		// Rotate the destination point so calculations can be made as if the motor is always in front
 		// (rotating the point places it in the same position relative to the front motor
 		// as it would be relative to the motor indicated by motor_angle).
@@ -98,7 +99,7 @@ namespace rexos_delta_robot {
 
 		// Checks if the "ankle to effector connection" is directly to the left of, to the right of, or in the motor.
 		if(distanceMotorToEffectorOnYAndZAxis == 0){
-			throw InverseKinematicsException("point out of range", destinationPoint);
+			return POINT_OUT_OF_RANGE;
 		}
 
 		// To calculate alpha, the angle between actuator arm and goal vector.
@@ -112,7 +113,7 @@ namespace rexos_delta_robot {
 				* distanceMotorToEffectorOnYAndZAxis);
 
 		if(alphaAcosInput < -1 || alphaAcosInput > 1){
-			throw InverseKinematicsException("point out of range", destinationPoint);
+			return POINT_OUT_OF_RANGE;
 		}
 
 		// The required angle between actuator arm and goal vector.
@@ -124,28 +125,66 @@ namespace rexos_delta_robot {
 		// The required angle between actuator arm and base (0 degrees).
 		double rho = beta - alpha;
 
-		double hipAnkleAngle = asin(abs(destinationPointRotatedAroundZAxis.x) / ankle);
+		double hipAnkleAngle = asin(fabs(destinationPointRotatedAroundZAxis.x) / ankle);
 		if (hipAnkleAngle > maxAngleHipAnkle) {
-			throw InverseKinematicsException("angle between hip and ankle is out of range", destinationPoint);
+			return HIP_ANKLE_ANGLE_OUT_OF_RANGE;
 		}
 
-		return rho;
+		angle = rho;
+		return SOLVED;
 	}
 
 	/**
-	 * Translates a point to the motor rotations.
+	 * Translates a point to the motor angles without throwing exceptions.
 	 *
 	 * @param destinationPoint The destination point.
-	 * @param rotations Array of MotorRotation objects, will be adjusted by the function to the correct rotations per motor.
+	 * @param angles Array the angles of the motors are written to, in radians.
+	 *
+	 * @return SOLVED if the point can be reached, otherwise the reason it can't be reached.
 	 **/
-	void InverseKinematics::destinationPointToMotorRotations(const rexos_datatypes::Point3D<double>& destinationPoint, rexos_datatypes::MotorRotation* (&rotations)[3]) const{
+	InverseKinematics::SolveStatus InverseKinematics::solveMotorAngles(const rexos_datatypes::Point3D<double>& destinationPoint, double (&angles)[3]) const throw(){
 		// Adding 180 degrees switches 0 degrees for the motor from the midpoint of the engines to directly opposite.
 		// When determining motorAngle the degrees determine the position of the engines:
 		// 	  0 degrees: the hip from this motor moves on the yz plane
 		//  120 degrees: this motor is located 120 degrees counter clockwise of the 0 degrees motor when looking at the side the effector is not located
 		//  240 degrees: this motor is located 240 degrees counter clockwise of the 0 degrees motor when looking at the side the effector is not located
-		rotations[0]->angle = rexos_utilities::degreesToRadians(180) + motorAngle(destinationPoint, rexos_utilities::degreesToRadians(1 * 120));
-		rotations[1]->angle = rexos_utilities::degreesToRadians(180) + motorAngle(destinationPoint, rexos_utilities::degreesToRadians(0 * 120));
-		rotations[2]->angle = rexos_utilities::degreesToRadians(180) + motorAngle(destinationPoint, rexos_utilities::degreesToRadians(2 * 120));
+		double motorLocations[3] = {
+			rexos_utilities::degreesToRadians(1 * 120),
+			rexos_utilities::degreesToRadians(0 * 120),
+			rexos_utilities::degreesToRadians(2 * 120)
+		};
+		for(int i = 0; i < 3; i++){
+			double rho;
+			SolveStatus status = motorAngle(destinationPoint, motorLocations[i], rho);
+			if(status != SOLVED){
+				return status;
+			}
+			angles[i] = rexos_utilities::degreesToRadians(180) + rho;
+		}
+		return SOLVED;
+	}
+
+	/**
+	 * Translates a point to the motor rotations.
+	 *
+	 * @param destinationPoint The destination point.
+	 * @param rotations Array of MotorRotation objects, will be adjusted by the function to the correct rotations per motor.
+	 *
+	 * @throw InverseKinematicsException if the point can't be reached.
+	 **/
+	void InverseKinematics::destinationPointToMotorRotations(const rexos_datatypes::Point3D<double>& destinationPoint, rexos_datatypes::MotorRotation* (&rotations)[3]) const{
+		double angles[3];
+		switch(solveMotorAngles(destinationPoint, angles)){
+			case POINT_OUT_OF_RANGE:
+				throw InverseKinematicsException("point out of range", destinationPoint);
+			case HIP_ANKLE_ANGLE_OUT_OF_RANGE:
+				throw InverseKinematicsException("angle between hip and ankle is out of range", destinationPoint);
+			case SOLVED:
+				break;
+		}
+
+		rotations[0]->angle = angles[0];
+		rotations[1]->angle = angles[1];
+		rotations[2]->angle = angles[2];
 	}
 }
@@ -0,0 +1,261 @@
+/**
+ * @file InverseKinematicsLookupTable.cpp
+ * @brief Inverse kinematics from a precalculated grid of motor angles, with trilinear interpolation.
+ *
+ * @section LICENSE
+ * License: newBSD
+ *  
+ * Copyright © 2012, HU University of Applied Sciences Utrecht.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **/
+
+#include <cmath>
+#include <rexos_delta_robot/InverseKinematicsLookupTable.h>
+#include <rexos_delta_robot/ForwardKinematics.h>
+#include <rexos_delta_robot/InverseKinematicsException.h>
+#include <rexos_delta_robot/Measures.h>
+
+namespace rexos_delta_robot{
+	/**
+	 * Constructor of the lookup table. Calculates the motor angles of all grid points in the boundary box and the cells that can be interpolated.
+	 *
+	 * @param exactModel The model the grid is calculated with, and that solves the points the grid can't interpolate. Has to stay alive as long as the lookup table.
+	 * @param voxelSize The distance in millimeters between two grid points.
+	 * @param maxError The maximum distance in millimeters between a point and the location the interpolated motor angles lead to.
+	 **/
+	InverseKinematicsLookupTable::InverseKinematicsLookupTable(const InverseKinematicsModel& exactModel, double voxelSize, double maxError) :
+			InverseKinematicsModel(exactModel.getBase(), exactModel.getHip(), exactModel.getEffector(), exactModel.getAnkle(), exactModel.maxAngleHipAnkle),
+			exactModel(exactModel),
+			voxelSize(voxelSize),
+			width((Measures::BOUNDARY_BOX_MAX_X - Measures::BOUNDARY_BOX_MIN_X) / voxelSize),
+			depth((Measures::BOUNDARY_BOX_MAX_Y - Measures::BOUNDARY_BOX_MIN_Y) / voxelSize),
+			height((Measures::BOUNDARY_BOX_MAX_Z - Measures::BOUNDARY_BOX_MIN_Z) / voxelSize),
+			bricksWide((width + BRICK_SIZE - 1) / BRICK_SIZE),
+			bricksDeep((depth + BRICK_SIZE - 1) / BRICK_SIZE),
+			bricks(),
+			brickAngles(),
+			brickCells(){
+		int bricksHigh = (height + BRICK_SIZE - 1) / BRICK_SIZE;
+		bricks.resize(bricksWide * bricksDeep * bricksHigh, NO_BRICK);
+		for(int brickZ = 0; brickZ < bricksHigh; brickZ++){
+			for(int brickY = 0; brickY < bricksDeep; brickY++){
+				for(int brickX = 0; brickX < bricksWide; brickX++){
+					generateBrick(brickX, brickY, brickZ, maxError);
+				}
+			}
+		}
+	}
+
+	InverseKinematicsLookupTable::~InverseKinematicsLookupTable(void){
+	}
+
+	/**
+	 * Calculates the motor angles of the grid points of a brick, and stores the brick when any of its cells can be interpolated within the maximum error.
+	 * A cell can be interpolated when all its corners and its center can be reached, and the estimated interpolation error is within maxError.
+	 * The error is estimated from the edges through one corner, and measured at the center and the centers of the faces of the cell. This is a sample, not a bound: the interpolation error elsewhere in the cell can still be larger.
+	 *
+	 * @param brickX The x position of the brick in bricks.
+	 * @param brickY The y position of the brick in bricks.
+	 * @param brickZ The z position of the brick in bricks.
+	 * @param maxError The maximum distance in millimeters between a point and the location the interpolated motor angles lead to.
+	 **/
+	void InverseKinematicsLookupTable::generateBrick(int brickX, int brickY, int brickZ, double maxError){
+		const int numberOfPoints = BRICK_POINTS * BRICK_POINTS * BRICK_POINTS;
+		double x[numberOfPoints], y[numberOfPoints], z[numberOfPoints];
+		double angles[3][numberOfPoints];
+		bool valid[numberOfPoints];
+
+		// Solve all grid points of the brick before looking at its cells.
+		bool anyValid = false;
+		for(int i = 0; i < numberOfPoints; i++){
+			x[i] = Measures::BOUNDARY_BOX_MIN_X + (brickX * BRICK_SIZE + i % BRICK_POINTS) * voxelSize;
+			y[i] = Measures::BOUNDARY_BOX_MIN_Y + (brickY * BRICK_SIZE + (i / BRICK_POINTS) % BRICK_POINTS) * voxelSize;
+			z[i] = Measures::BOUNDARY_BOX_MIN_Z + (brickZ * BRICK_SIZE + i / (BRICK_POINTS * BRICK_POINTS)) * voxelSize;
+			double pointAngles[3];
+			valid[i] = exactModel.solveMotorAngles(rexos_datatypes::Point3D<double>(x[i], y[i], z[i]), pointAngles) == SOLVED;
+			angles[0][i] = pointAngles[0];
+			angles[1][i] = pointAngles[1];
+			angles[2][i] = pointAngles[2];
+			anyValid = anyValid || valid[i];
+		}
+		if(!anyValid){
+			return;
+		}
+
+		ForwardKinematics forwardKinematics(base, hip, effector, ankle);
+		uint64_t cells[BRICK_SIZE];
+		bool anyCell = false;
+		for(int cellZ = 0; cellZ < BRICK_SIZE; cellZ++){
+			cells[cellZ] = 0;
+			for(int cellY = 0; cellY < BRICK_SIZE; cellY++){
+				for(int cellX = 0; cellX < BRICK_SIZE; cellX++){
+					if(brickX * BRICK_SIZE + cellX >= width || brickY * BRICK_SIZE + cellY >= depth || brickZ * BRICK_SIZE + cellZ >= height){
+						continue;
+					}
+
+					int corner = cellX + cellY * BRICK_POINTS + cellZ * BRICK_POINTS * BRICK_POINTS;
+					int cornerOffsets[8] = {
+						0, 1, BRICK_POINTS, BRICK_POINTS + 1,
+						BRICK_POINTS * BRICK_POINTS, BRICK_POINTS * BRICK_POINTS + 1, BRICK_POINTS * BRICK_POINTS + BRICK_POINTS, BRICK_POINTS * BRICK_POINTS + BRICK_POINTS + 1
+					};
+					bool cornersValid = true;
+					for(int i = 0; i < 8; i++){
+						cornersValid = cornersValid && valid[corner + cornerOffsets[i]];
+					}
+					if(!cornersValid){
+						continue;
+					}
+
+					// The interpolation error along each axis is largest halfway the edges of the cell, the error anywhere in the cell is at most the sum of those.
+					double error = 0;
+					for(int axis = 0; axis < 3; axis++){
+						int end = corner + cornerOffsets[1 << axis];
+						double edgeAngles[3] = {(angles[0][corner] + angles[0][end]) / 2, (angles[1][corner] + angles[1][end]) / 2, (angles[2][corner] + angles[2][end]) / 2};
+						rexos_datatypes::Point3D<double> edgeMiddle((x[corner] + x[end]) / 2, (y[corner] + y[end]) / 2, (z[corner] + z[end]) / 2);
+						rexos_datatypes::Point3D<double> interpolatedEdgeMiddle;
+						if(!forwardKinematics.motorAnglesToDestinationPoint(edgeAngles, interpolatedEdgeMiddle)){
+							error = maxError + 1;
+							break;
+						}
+						error += interpolatedEdgeMiddle.distance(edgeMiddle);
+					}
+
+					// Measure the error of the interpolated angles, as they are stored, at the center and at the center of every face.
+					for(int sample = 0; sample < 7 && error <= maxError; sample++){
+						double fraction[3] = {0.5, 0.5, 0.5};
+						if(sample > 0){
+							fraction[(sample - 1) / 2] = (sample - 1) % 2;
+						}
+						double sampleAngles[3] = {0, 0, 0};
+						for(int i = 0; i < 8; i++){
+							double weight = 1;
+							for(int axis = 0; axis < 3; axis++){
+								weight *= ((i >> axis) & 1) ? fraction[axis] : 1 - fraction[axis];
+							}
+							for(int motor = 0; motor < 3; motor++){
+								sampleAngles[motor] += weight * (float) angles[motor][corner + cornerOffsets[i]];
+							}
+						}
+						rexos_datatypes::Point3D<double> samplePoint(x[corner] + fraction[0] * voxelSize, y[corner] + fraction[1] * voxelSize, z[corner] + fraction[2] * voxelSize);
+						rexos_datatypes::Point3D<double> interpolatedSamplePoint;
+						if(!forwardKinematics.motorAnglesToDestinationPoint(sampleAngles, interpolatedSamplePoint) || interpolatedSamplePoint.distance(samplePoint) > maxError){
+							error = maxError + 1;
+						}
+					}
+
+					// A cell with reachable corners can still have an unreachable center near the edge of the reachable area.
+					rexos_datatypes::Point3D<double> center(x[corner] + voxelSize / 2, y[corner] + voxelSize / 2, z[corner] + voxelSize / 2);
+					double exactAngles[3];
+					if(error <= maxError && exactModel.solveMotorAngles(center, exactAngles) == SOLVED){
+						cells[cellZ] |= (uint64_t) 1 << (cellX + cellY * BRICK_SIZE);
+						anyCell = true;
+					}
+				}
+			}
+		}
+		if(!anyCell){
+			return;
+		}
+
+		bricks[brickX + brickY * bricksWide + brickZ * bricksWide * bricksDeep] = brickCells.size() / BRICK_SIZE;
+		brickCells.insert(brickCells.end(), cells, cells + BRICK_SIZE);
+		for(int i = 0; i < numberOfPoints; i++){
+			for(int motor = 0; motor < 3; motor++){
+				brickAngles.push_back(angles[motor][i]);
+			}
+		}
+	}
+
+	/**
+	 * Translates a point to the motor angles without throwing exceptions or allocating memory. Interpolates the angles when the point lies in a cell that can be interpolated, otherwise the point is solved by the exact model.
+	 *
+	 * @param destinationPoint The destination point.
+	 * @param angles Array the angles of the motors are written to, in radians. Only meaningful when SOLVED is returned.
+	 *
+	 * @return SOLVED if the point can be reached, otherwise the reason it can't be reached.
+	 **/
+	InverseKinematicsLookupTable::SolveStatus InverseKinematicsLookupTable::solveMotorAngles(const rexos_datatypes::Point3D<double>& destinationPoint, double (&angles)[3]) const throw(){
+		double gridX = (destinationPoint.x - Measures::BOUNDARY_BOX_MIN_X) / voxelSize;
+		double gridY = (destinationPoint.y - Measures::BOUNDARY_BOX_MIN_Y) / voxelSize;
+		double gridZ = (destinationPoint.z - Measures::BOUNDARY_BOX_MIN_Z) / voxelSize;
+		if(!(gridX >= 0 && gridX < width && gridY >= 0 && gridY < depth && gridZ >= 0 && gridZ < height)){
+			return exactModel.solveMotorAngles(destinationPoint, angles);
+		}
+
+		int cellX = (int) gridX;
+		int cellY = (int) gridY;
+		int cellZ = (int) gridZ;
+		int32_t brick = bricks[cellX / BRICK_SIZE + (cellY / BRICK_SIZE) * bricksWide + (cellZ / BRICK_SIZE) * bricksWide * bricksDeep];
+		if(brick == NO_BRICK){
+			return exactModel.solveMotorAngles(destinationPoint, angles);
+		}
+
+		int localX = cellX % BRICK_SIZE;
+		int localY = cellY % BRICK_SIZE;
+		int localZ = cellZ % BRICK_SIZE;
+		if(!((brickCells[brick * BRICK_SIZE + localZ] >> (localX + localY * BRICK_SIZE)) & 1)){
+			return exactModel.solveMotorAngles(destinationPoint, angles);
+		}
+
+		// Trilinear interpolation between the corners of the cell.
+		double fractionX = gridX - cellX;
+		double fractionY = gridY - cellY;
+		double fractionZ = gridZ - cellZ;
+		const float* corner = &brickAngles[(brick * BRICK_POINTS * BRICK_POINTS * BRICK_POINTS + localX + localY * BRICK_POINTS + localZ * BRICK_POINTS * BRICK_POINTS) * 3];
+		const int stepY = BRICK_POINTS * 3;
+		const int stepZ = BRICK_POINTS * BRICK_POINTS * 3;
+		for(int motor = 0; motor < 3; motor++){
+			const float* c = corner + motor;
+			double bottom = (c[0] + (c[3] - c[0]) * fractionX) * (1 - fractionY) + (c[stepY] + (c[stepY + 3] - c[stepY]) * fractionX) * fractionY;
+			double top = (c[stepZ] + (c[stepZ + 3] - c[stepZ]) * fractionX) * (1 - fractionY) + (c[stepZ + stepY] + (c[stepZ + stepY + 3] - c[stepZ + stepY]) * fractionX) * fractionY;
+			angles[motor] = bottom + (top - bottom) * fractionZ;
+		}
+		return SOLVED;
+	}
+
+	/**
+	 * Translates a point to the motor rotations.
+	 *
+	 * @param destinationPoint The destination point.
+	 * @param rotations Array of MotorRotation objects, will be adjusted by the function to the correct rotations per motor.
+	 *
+	 * @throw InverseKinematicsException if the point can't be reached.
+	 **/
+	void InverseKinematicsLookupTable::destinationPointToMotorRotations(const rexos_datatypes::Point3D<double>& destinationPoint,
+			rexos_datatypes::MotorRotation* (&rotations)[3]) const{
+		double angles[3];
+		if(solveMotorAngles(destinationPoint, angles) != SOLVED){
+			// Let the exact model report why the point can't be reached.
+			exactModel.destinationPointToMotorRotations(destinationPoint, rotations);
+			return;
+		}
+		rotations[0]->angle = angles[0];
+		rotations[1]->angle = angles[1];
+		rotations[2]->angle = angles[2];
+	}
+
+	/**
+	 * Gets the amount of memory used by the grid.
+	 *
+	 * @return The amount of bytes used.
+	 **/
+	size_t InverseKinematicsLookupTable::getMemoryUsage() const{
+		return bricks.capacity() * sizeof(int32_t) + brickAngles.capacity() * sizeof(float) + brickCells.capacity() * sizeof(uint64_t);
+	}
+}
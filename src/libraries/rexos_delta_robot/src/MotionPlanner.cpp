@@ -0,0 +1,107 @@
+/**
+ * @file MotionPlanner.cpp
+ * @brief Hardware-free planning of a single motion of the deltarobot, from the kinematics to the motion profile.
+ *
+ * @section LICENSE
+ * License: newBSD
+ *  
+ * Copyright © 2012, HU University of Applied Sciences Utrecht.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **/
+
+#include <stdexcept>
+#include <rexos_delta_robot/InverseKinematicsException.h>
+#include <rexos_delta_robot/MotionPlanner.h>
+#include <rexos_delta_robot/MotionProfile.h>
+#include <rexos_motor/CRD514KD.h>
+
+namespace rexos_delta_robot{
+	/**
+	 * Constructor of the motion planner. The kinematics, forward kinematics and boundaries have to stay alive as long as the planner.
+	 *
+	 * @param kinematics The kinematics model the motor angles are calculated with.
+	 * @param forwardKinematics The forward kinematics the motor angles are verified with.
+	 * @param boundaries The boundaries the paths have to stay within.
+	 * @param kinematicsTolerance The maximum distance in millimeters between a destination point and the location its motor angles lead to.
+	 * @param motorMinAngles The minimum angle in radians of every motor.
+	 * @param motorMaxAngles The maximum angle in radians of every motor.
+	 **/
+	MotionPlanner::MotionPlanner(const InverseKinematicsModel& kinematics, const ForwardKinematics& forwardKinematics, const EffectorBoundaries& boundaries, double kinematicsTolerance,
+			const double (&motorMinAngles)[3], const double (&motorMaxAngles)[3]) :
+			kinematics(kinematics), forwardKinematics(forwardKinematics), boundaries(boundaries), kinematicsTolerance(kinematicsTolerance){
+		for(int i = 0; i < 3; i++){
+			this->motorMinAngles[i] = motorMinAngles[i];
+			this->motorMaxAngles[i] = motorMaxAngles[i];
+		}
+	}
+
+	/**
+	 * Calculates the rotations of the motors for a motion between two points. The motion is checked against the motor angles, the kinematics and the boundaries.
+	 *
+	 * @param from The point the motion starts from.
+	 * @param fromAngles The motor angles in radians the motion starts from.
+	 * @param point 3-dimensional point to move to.
+	 * @param maxAcceleration the acceleration in radians/s² that the motor with the biggest motion will accelerate at. Accelerations above the maximum CRD514KD acceleration are lowered to it.
+	 * @param rotations The rotations for the motors are written to this array.
+	 *
+	 * @return The time in seconds the motion takes, or 0 if none of the motors have to move.
+	 *
+	 * @throw InverseKinematicsException if the point can't be reached or the path leaves the boundaries.
+	 * @throw std::out_of_range if maxAcceleration is below the minimum CRD514KD acceleration.
+	 **/
+	double MotionPlanner::planMotion(const rexos_datatypes::Point3D<double>& from, const double (&fromAngles)[3], const rexos_datatypes::Point3D<double>& point, double maxAcceleration,
+			rexos_datatypes::MotorRotation (&rotations)[3]) const{
+		if(maxAcceleration > rexos_motor::CRD514KD::MOTOR_MAX_ACCELERATION){
+			// The acceleration is too high, putting it down to the maximum CRD514KD acceleration.
+			maxAcceleration = rexos_motor::CRD514KD::MOTOR_MAX_ACCELERATION;
+		} else if(maxAcceleration < rexos_motor::CRD514KD::MOTOR_MIN_ACCELERATION){
+			// The acceleration is too low, throwing an exception.
+			throw std::out_of_range("maxAcceleration too low");
+		}
+
+		// Get the motor angles from the kinematics model
+		rexos_datatypes::MotorRotation* rotationPointers[3] = {&rotations[0], &rotations[1], &rotations[2]};
+		kinematics.destinationPointToMotorRotations(point, rotationPointers);
+
+		// Verify the angles by calculating the location back from them
+		double angles[3] = {rotations[0].angle, rotations[1].angle, rotations[2].angle};
+		rexos_datatypes::Point3D<double> verifiedPoint;
+		if(!forwardKinematics.motorAnglesToDestinationPoint(angles, verifiedPoint) || verifiedPoint.distance(point) > kinematicsTolerance){
+			throw InverseKinematicsException("motion angles do not lead to the destination point", point);
+		}
+
+		// Check if the angles fit within the boundaries
+		for(int i = 0; i < 3; i++){
+			if(!(angles[i] > motorMinAngles[i] && angles[i] < motorMaxAngles[i])){
+				throw InverseKinematicsException("motion angles outside of valid range", point);
+			}
+		}
+
+		// Check if the path fits within the boundaries
+		if(!boundaries.checkPath(from, point)){
+			throw InverseKinematicsException("invalid path", point);
+		}
+
+		// Synchronize the motors, the slowest motor moves at its maximum acceleration and speed.
+		double maxSpeeds[3] = {rexos_motor::CRD514KD::MOTOR_MAX_SPEED, rexos_motor::CRD514KD::MOTOR_MAX_SPEED, rexos_motor::CRD514KD::MOTOR_MAX_SPEED};
+		double maxAccelerations[3] = {maxAcceleration, maxAcceleration, maxAcceleration};
+		MotionProfile motionProfile(maxSpeeds, maxAccelerations, rexos_motor::CRD514KD::MOTOR_MIN_ACCELERATION, rexos_motor::CRD514KD::MOTOR_STEP_ANGLE);
+		return motionProfile.synchronize(fromAngles, rotationPointers);
+	}
+}
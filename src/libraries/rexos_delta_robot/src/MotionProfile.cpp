@@ -0,0 +1,296 @@
+/**
+ * @file MotionProfile.cpp
+ * @brief Time-optimal trapezoidal motion profiles, synchronized over the three motors of the deltarobot.
+ *
+ * @section LICENSE
+ * License: newBSD
+ *  
+ * Copyright © 2012, HU University of Applied Sciences Utrecht.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **/
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <rexos_delta_robot/MotionProfile.h>
+
+namespace rexos_delta_robot{
+	/**
+	 * Constructor of the motion profile generator.
+	 *
+	 * @param maxSpeeds The maximum speed in radians/s for every motor.
+	 * @param maxAccelerations The maximum acceleration and deceleration in radians/s² for every motor.
+	 * @param minAcceleration The lowest acceleration and deceleration in radians/s² the motors support.
+	 * @param minAngle The smallest relative angle in radians a motor can move.
+	 **/
+	MotionProfile::MotionProfile(const double (&maxSpeeds)[3], const double (&maxAccelerations)[3], double minAcceleration, double minAngle) :
+			minAcceleration(minAcceleration), minAngle(minAngle){
+		for(int i = 0; i < 3; i++){
+			if(maxSpeeds[i] <= 0 || maxAccelerations[i] < minAcceleration){
+				throw std::out_of_range("speed or acceleration limit out of range");
+			}
+			this->maxSpeeds[i] = maxSpeeds[i];
+			this->maxAccelerations[i] = maxAccelerations[i];
+		}
+	}
+
+	/**
+	 * Gets the shortest time for a rotation. The rotation accelerates at the maximum acceleration until it reaches the maximum speed, and decelerates at the same rate.
+	 *
+	 * @param relativeAngle The relative angle in radians.
+	 * @param maxSpeed The maximum speed in radians/s.
+	 * @param maxAcceleration The maximum acceleration in radians/s².
+	 *
+	 * @return The time in seconds.
+	 **/
+	double MotionProfile::getMoveTime(double relativeAngle, double maxSpeed, double maxAcceleration){
+		relativeAngle = fabs(relativeAngle);
+		if(relativeAngle * maxAcceleration > maxSpeed * maxSpeed){
+			// The top speed is reached, the motion has a period of constant speed.
+			return (relativeAngle / maxSpeed) + (maxSpeed / maxAcceleration);
+		}
+		// The motion is half acceleration and half deceleration.
+		return 2 * sqrt(relativeAngle / maxAcceleration);
+	}
+
+	/**
+	 * Fills in the speed, acceleration and deceleration of the rotations so that all motors start and arrive at the same time, as soon as the slowest motor allows.
+	 * Every motor uses the lowest acceleration that still makes it arrive in time, which keeps the motions as smooth as possible.
+	 *
+	 * @param startAngles The angles in radians the motors start from.
+	 * @param rotations The rotations with the angles the motors move to. The angle of a motor that does not have to move is set to its start angle.
+	 *
+	 * @return The time in seconds the motion takes, or 0 if none of the motors have to move.
+	 **/
+	double MotionProfile::synchronize(const double (&startAngles)[3], rexos_datatypes::MotorRotation* (&rotations)[3]) const{
+		double relativeAngles[3];
+		double moveTime = 0;
+		for(int i = 0; i < 3; i++){
+			relativeAngles[i] = fabs(rotations[i]->angle - startAngles[i]);
+			if(relativeAngles[i] < minAngle){
+				// The motor does not have to move at all.
+				relativeAngles[i] = 0;
+			} else{
+				double motorMoveTime = getMoveTime(relativeAngles[i], maxSpeeds[i], maxAccelerations[i]);
+				if(motorMoveTime > moveTime){
+					moveTime = motorMoveTime;
+				}
+			}
+		}
+
+		for(int i = 0; i < 3; i++){
+			double speed = maxSpeeds[i];
+			double acceleration = minAcceleration;
+			if(relativeAngles[i] == 0){
+				rotations[i]->angle = startAngles[i];
+			} else{
+				speed = 2 * relativeAngles[i] / moveTime;
+				if(speed <= maxSpeeds[i]){
+					// Half acceleration and half deceleration.
+					acceleration = 4 * relativeAngles[i] / (moveTime * moveTime);
+				} else{
+					// The motor has to reach its top speed.
+					speed = maxSpeeds[i];
+					acceleration = (speed * speed) / (speed * moveTime - relativeAngles[i]);
+				}
+
+				if(acceleration < minAcceleration){
+					// The motion is too slow for the minimum acceleration, so a period of constant speed is added.
+					acceleration = minAcceleration;
+					speed = (acceleration / 2) * (moveTime - sqrt((moveTime * moveTime) - (4 * relativeAngles[i] / acceleration)));
+				} else if(acceleration > maxAccelerations[i]){
+					// Rounding errors on the slowest motor.
+					acceleration = maxAccelerations[i];
+				}
+			}
+			rotations[i]->speed = speed;
+			rotations[i]->acceleration = acceleration;
+			rotations[i]->deceleration = acceleration;
+		}
+		return moveTime;
+	}
+
+	/**
+	 * Links motions into a single motion that runs from one motion into the next without stopping, like the linked motion slots of the CRD514KD.
+	 * Only motions in which every motor keeps moving in the same direction, or keeps standing still, are linked, and only as long as the linked motion arrives sooner than the motions one after another.
+	 * Every motor runs through a motion at a constant speed. The motors accelerate and change speed at rates at which they all reach their top speed in the same time, and decelerate so they all arrive at the same time. While they change speed, the effector cuts the corners between the motions.
+	 *
+	 * @param startAngles The angles in radians the motors start from.
+	 * @param rotations For every motion, the rotations of the three motors. The angles of motors that do not move are set to their start angle, and the speed, acceleration and deceleration of the linked motions are overwritten.
+	 * @param durations For every motion, the time in seconds it takes on its own, as returned by synchronize.
+	 * @param numberOfMotions The amount of motions that may be linked.
+	 * @param duration The time in seconds the linked motion takes is written to this variable, unless only 1 motion is linked.
+	 *
+	 * @return The amount of motions that were linked, starting at the first one. If it is 1, the rotations are left as they are.
+	 **/
+	int MotionProfile::link(const double (&startAngles)[3], rexos_datatypes::MotorRotation* (*rotations)[3], const double* durations, int numberOfMotions, double& duration) const{
+		std::vector<double> relativeAngles(numberOfMotions * 3);
+		std::vector<double> motionTimes(numberOfMotions);
+		int directions[3] = {0, 0, 0};
+		double separateDuration = 0;
+		int linked = 1;
+		for(int i = 0; i < numberOfMotions; i++){
+			bool sameDirections = true;
+			// The slowest motor runs through a motion at the top speed it reaches in the motion on its own.
+			motionTimes[i] = durations[i] / 2;
+			for(int j = 0; j < 3; j++){
+				double relativeAngle = rotations[i][j]->angle - (i == 0 ? startAngles[j] : rotations[i - 1][j]->angle);
+				int direction = fabs(relativeAngle) < minAngle ? 0 : (relativeAngle > 0 ? 1 : -1);
+				if(i == 0){
+					directions[j] = direction;
+				} else if(direction != directions[j]){
+					sameDirections = false;
+				}
+				relativeAngles[i * 3 + j] = direction == 0 ? 0 : fabs(relativeAngle);
+				motionTimes[i] = std::max(motionTimes[i], relativeAngles[i * 3 + j] / maxSpeeds[j]);
+			}
+			separateDuration += durations[i];
+			if(!sameDirections || motionTimes[i] <= 0){
+				break;
+			}
+			if(i > 0){
+				std::vector<double> stretchedTimes(motionTimes.begin(), motionTimes.begin() + i + 1);
+				double accelerations[3], decelerations[3], delay;
+				if(getLinkedDuration(relativeAngles, stretchedTimes, accelerations, decelerations, delay) >= separateDuration){
+					break;
+				}
+				linked = i + 1;
+			}
+		}
+		if(linked == 1){
+			return 1;
+		}
+
+		double accelerations[3], decelerations[3], delay;
+		motionTimes.resize(linked);
+		duration = getLinkedDuration(relativeAngles, motionTimes, accelerations, decelerations, delay);
+		for(int i = 0; i < linked; i++){
+			for(int j = 0; j < 3; j++){
+				if(directions[j] == 0){
+					rotations[i][j]->angle = i == 0 ? startAngles[j] : rotations[i - 1][j]->angle;
+					rotations[i][j]->speed = maxSpeeds[j];
+				} else{
+					rotations[i][j]->speed = relativeAngles[i * 3 + j] / motionTimes[i];
+				}
+				rotations[i][j]->acceleration = accelerations[j];
+				rotations[i][j]->deceleration = decelerations[j];
+			}
+		}
+		return linked;
+	}
+
+	/**
+	 * Calculates the time linked motions take, after stretching the times of the motions so that every motor accelerates within the first motion, decelerates within the last motion, changes speed within the first half of the angle of a motion, and can stop within half of the remaining angle while it changes speed.
+	 * Stretching the times by a factor lowers the speeds by that factor, which shortens the time the motors take to change speed by the same factor, and the angle they turn meanwhile by the square of it.
+	 *
+	 * @param relativeAngles For every motion, the absolute relative angle in radians of every motor.
+	 * @param motionTimes For every motion, the time in seconds the motors run through it. The stretched times are written to it.
+	 * @param accelerations The acceleration in radians/s² of every motor is written to this array.
+	 * @param decelerations The deceleration in radians/s² of every motor is written to this array.
+	 * @param delay The time in seconds the motors arrive later than they would when running at the constant speeds from the start is written to this variable.
+	 *
+	 * @return The time in seconds the linked motions take.
+	 **/
+	double MotionProfile::getLinkedDuration(const std::vector<double>& relativeAngles, std::vector<double>& motionTimes,
+			double (&accelerations)[3], double (&decelerations)[3], double& delay) const{
+		int last = motionTimes.size() - 1;
+		getLinkedRamps(relativeAngles, motionTimes, accelerations, decelerations, delay);
+		double stretch = 1;
+		for(int j = 0; j < 3; j++){
+			stretch = std::max(stretch, (relativeAngles[j] / motionTimes[0] / accelerations[j]) / motionTimes[0]);
+			stretch = std::max(stretch, (relativeAngles[last * 3 + j] / motionTimes[last] / decelerations[j]) / motionTimes[last]);
+			double remainingAngle = 0;
+			for(int i = last; i >= 1; i--){
+				double previousSpeed = relativeAngles[(i - 1) * 3 + j] / motionTimes[i - 1];
+				double speed = relativeAngles[i * 3 + j] / motionTimes[i];
+				double speedChangeAngle = (previousSpeed + speed) / 2 * fabs(speed - previousSpeed) / accelerations[j];
+				remainingAngle += relativeAngles[i * 3 + j];
+				if(speedChangeAngle > 0){
+					stretch = std::max(stretch, speedChangeAngle / (relativeAngles[i * 3 + j] / 2));
+					// The motor controller starts to decelerate as soon as the remaining angle gets too short to stop from the current speed, half of it is kept as a margin.
+					double fastestSpeed = std::max(previousSpeed, speed);
+					stretch = std::max(stretch, (fastestSpeed * fastestSpeed / (2 * decelerations[j])) / (remainingAngle / 2));
+				}
+			}
+		}
+
+		double linkedDuration = 0;
+		if(stretch > 1){
+			// The time of a speed change shrinks by the factor the motion time grows by.
+			stretch = sqrt(stretch);
+			for(int i = 0; i <= last; i++){
+				motionTimes[i] *= stretch;
+			}
+			getLinkedRamps(relativeAngles, motionTimes, accelerations, decelerations, delay);
+		}
+		for(int i = 0; i <= last; i++){
+			linkedDuration += motionTimes[i];
+		}
+		return linkedDuration + delay;
+	}
+
+	/**
+	 * Calculates the acceleration and deceleration of every motor for linked motions.
+	 * Every motor accelerates and changes speed at a rate at which it reaches its top speed in the linked motions in the same time as the other motors, which keeps the differences between the lags of the motors small.
+	 * The decelerations are chosen so that all motors arrive at the same time.
+	 *
+	 * @param relativeAngles For every motion, the absolute relative angle in radians of every motor.
+	 * @param motionTimes For every motion, the time in seconds the motors run through it.
+	 * @param accelerations The acceleration in radians/s² of every motor is written to this array.
+	 * @param decelerations The deceleration in radians/s² of every motor is written to this array.
+	 * @param delay The time in seconds the motors arrive later than they would when running at the constant speeds from the start is written to this variable.
+	 **/
+	void MotionProfile::getLinkedRamps(const std::vector<double>& relativeAngles, const std::vector<double>& motionTimes,
+			double (&accelerations)[3], double (&decelerations)[3], double& delay) const{
+		int last = motionTimes.size() - 1;
+		double topSpeeds[3] = {0, 0, 0};
+		double accelerationTime = 0;
+		for(int j = 0; j < 3; j++){
+			for(int i = 0; i <= last; i++){
+				topSpeeds[j] = std::max(topSpeeds[j], relativeAngles[i * 3 + j] / motionTimes[i]);
+			}
+			accelerationTime = std::max(accelerationTime, topSpeeds[j] / maxAccelerations[j]);
+		}
+
+		// Changing speed from v to w at rate a makes a motor fall (w - v)² / 2aw behind the constant speed w, or get ahead as much when slowing down. Decelerating from v at rate d adds v / 2d.
+		double lags[3];
+		delay = 0;
+		for(int j = 0; j < 3; j++){
+			accelerations[j] = std::max(topSpeeds[j] / accelerationTime, minAcceleration);
+			lags[j] = 0;
+			double previousSpeed = 0;
+			for(int i = 0; i <= last; i++){
+				double speed = relativeAngles[i * 3 + j] / motionTimes[i];
+				if(speed > 0){
+					double speedChange = speed - previousSpeed;
+					lags[j] += (speedChange > 0 ? 1 : -1) * speedChange * speedChange / (2 * accelerations[j] * speed);
+				}
+				previousSpeed = speed;
+			}
+			delay = std::max(delay, lags[j] + previousSpeed / (2 * maxAccelerations[j]));
+		}
+		for(int j = 0; j < 3; j++){
+			double lastSpeed = relativeAngles[last * 3 + j] / motionTimes[last];
+			decelerations[j] = minAcceleration;
+			if(lastSpeed > 0){
+				decelerations[j] = std::min(std::max(lastSpeed / (2 * (delay - lags[j])), minAcceleration), maxAccelerations[j]);
+			}
+		}
+	}
+}
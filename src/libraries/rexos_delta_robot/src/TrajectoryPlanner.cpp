@@ -0,0 +1,134 @@
+/**
+ * @file TrajectoryPlanner.cpp
+ * @brief Queue of cartesian waypoints that skips the waypoints of a path lying within a tolerance of a straight motion.
+ *
+ * @section LICENSE
+ * License: newBSD
+ *  
+ * Copyright © 2012, HU University of Applied Sciences Utrecht.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **/
+
+#include <cmath>
+#include <stdexcept>
+#include <rexos_delta_robot/TrajectoryPlanner.h>
+
+namespace rexos_delta_robot{
+	/**
+	 * Constructor of the trajectory planner.
+	 *
+	 * @param skipTolerance The maximum distance in millimeters the effector may pass a skipped waypoint by. 0 moves to every waypoint exactly.
+	 **/
+	TrajectoryPlanner::TrajectoryPlanner(double skipTolerance) : waypoints(), skipTolerance(0){
+		setSkipTolerance(skipTolerance);
+	}
+
+	/**
+	 * Sets the skip tolerance.
+	 *
+	 * @param skipTolerance The maximum distance in millimeters the effector may pass a skipped waypoint by. 0 moves to every waypoint exactly.
+	 **/
+	void TrajectoryPlanner::setSkipTolerance(double skipTolerance){
+		if(skipTolerance < 0){
+			throw std::out_of_range("skipTolerance is negative");
+		}
+		this->skipTolerance = skipTolerance;
+	}
+
+	/**
+	 * Adds a waypoint to the end of the queue.
+	 *
+	 * @param point The point to move to.
+	 * @param maxAcceleration The acceleration in radians/s² for the motor with the biggest motion towards the point.
+	 **/
+	void TrajectoryPlanner::addWaypoint(const rexos_datatypes::Point3D<double>& point, double maxAcceleration){
+		waypoints.push_back(Waypoint(point, maxAcceleration));
+	}
+
+	/**
+	 * Removes all waypoints from the queue.
+	 **/
+	void TrajectoryPlanner::clear(){
+		waypoints.clear();
+	}
+
+	/**
+	 * Takes the next motion from the queue. Waypoints are skipped for as long as every skipped waypoint stays within the skip tolerance of the straight motion, and that motion stays within the boundaries.
+	 * The motion uses the lowest acceleration of the waypoints it replaces.
+	 * Both checks assume the effector moves in a straight line, so no waypoints are skipped for motions that are not straight.
+	 *
+	 * @param currentLocation The location the motion starts from.
+	 * @param boundaries The boundaries the combined motions have to stay within, or NULL to not check them.
+	 * @param straightMotions Whether the effector moves in a straight line between waypoints, as with linear interpolation.
+	 *
+	 * @return The waypoint to move to.
+	 **/
+	TrajectoryPlanner::Waypoint TrajectoryPlanner::nextWaypoint(const rexos_datatypes::Point3D<double>& currentLocation, const EffectorBoundaries* boundaries, bool straightMotions){
+		if(waypoints.empty()){
+			throw std::out_of_range("no waypoints left");
+		}
+
+		int lastWaypoint = 0;
+		int numberOfWaypoints = waypoints.size() < (size_t)MAX_SKIP_LOOKAHEAD ? waypoints.size() : MAX_SKIP_LOOKAHEAD;
+		if(straightMotions && skipTolerance > 0){
+			for(int candidate = 1; candidate < numberOfWaypoints; candidate++){
+				bool withinTolerance = true;
+				for(int i = 0; i < candidate && withinTolerance; i++){
+					withinTolerance = distanceToSegment(waypoints[i].point, currentLocation, waypoints[candidate].point) <= skipTolerance;
+				}
+				if(!withinTolerance || (boundaries != NULL && !boundaries->checkPath(currentLocation, waypoints[candidate].point))){
+					break;
+				}
+				lastWaypoint = candidate;
+			}
+		}
+
+		Waypoint waypoint = waypoints[lastWaypoint];
+		for(int i = 0; i < lastWaypoint; i++){
+			if(waypoints[i].maxAcceleration < waypoint.maxAcceleration){
+				waypoint.maxAcceleration = waypoints[i].maxAcceleration;
+			}
+		}
+		// Popping from the front of the deque is constant time, so a path takes linear time in its amount of waypoints.
+		for(int i = 0; i <= lastWaypoint; i++){
+			waypoints.pop_front();
+		}
+		return waypoint;
+	}
+
+	/**
+	 * Calculates the distance between a point and a line segment.
+	 *
+	 * @param point The point.
+	 * @param from The start of the segment.
+	 * @param to The end of the segment.
+	 *
+	 * @return The distance in millimeters.
+	 **/
+	double TrajectoryPlanner::distanceToSegment(const rexos_datatypes::Point3D<double>& point, const rexos_datatypes::Point3D<double>& from, const rexos_datatypes::Point3D<double>& to){
+		double dx = to.x - from.x, dy = to.y - from.y, dz = to.z - from.z;
+		double lengthSquared = dx * dx + dy * dy + dz * dz;
+		double t = 0;
+		if(lengthSquared > 0){
+			t = ((point.x - from.x) * dx + (point.y - from.y) * dy + (point.z - from.z) * dz) / lengthSquared;
+			t = t < 0 ? 0 : (t > 1 ? 1 : t);
+		}
+		return point.distance(rexos_datatypes::Point3D<double>(from.x + t * dx, from.y + t * dy, from.z + t * dz));
+	}
+}
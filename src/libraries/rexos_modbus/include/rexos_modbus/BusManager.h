@@ -0,0 +1,71 @@
+/**
+ * @file BusManager.h
+ * @brief Owns the modbus controllers of the buses the slaves are spread over.
+ *
+ * @section LICENSE
+ * License: newBSD
+ * 
+ * Copyright © 2012, HU University of Applied Sciences Utrecht.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **/
+
+#pragma once
+
+#include <map>
+#include <string>
+
+#include <rexos_modbus/ModbusController.h>
+
+namespace rexos_modbus{
+	/**
+	 * Creates and owns a ModbusController for every bus: a serial line or a Modbus TCP gateway.
+	 * Every bus has its own bus thread, so transactions on different buses are executed in parallel.
+	 * Slaves that are given the same bus address share a single ModbusController.
+	 **/
+	class BusManager{
+	public:
+		BusManager(void);
+		~BusManager(void);
+
+		ModbusController* getRtuBus(const std::string& device, int baudRate, char parity, int dataBits, int stopBits);
+		ModbusController* getTcpBus(const std::string& ip, int port);
+		ModbusController* getBus(const std::string& address, int baudRate, char parity, int dataBits, int stopBits);
+
+		/**
+		 * Returns the amount of buses that have been connected.
+		 *
+		 * @return The amount of buses.
+		 **/
+		inline unsigned int getNumberOfBuses(void) const{ return buses.size(); }
+
+	private:
+		/**
+		 * Typedef for the buses, the key is the bus address in the form accepted by getBus.
+		 **/
+		typedef std::map<std::string, ModbusController*> BusMap;
+
+		/**
+		 * @var BusMap buses
+		 * The modbus controllers of the buses that have been connected.
+		 **/
+		BusMap buses;
+
+		ModbusController* addBus(const std::string& key, modbus_t* context, int baudRate, char parity, int dataBits, int stopBits);
+	};
+}
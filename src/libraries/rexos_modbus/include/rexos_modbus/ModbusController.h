@@ -38,13 +38,18 @@ extern "C"{
 
 #include <stdint.h>
 #include <string>
+#include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
+#include <deque>
 #include <map>
+#include <vector>
 
 #include <fstream>
 #include <iostream>
 #include <string>
 
+#include <rexos_modbus/RegisterFile.h>
+
 /**
  * @cond HIDE_FROM_DOXYGEN
  * Turn on for modbus logging
@@ -57,18 +62,124 @@ extern "C"{
 namespace rexos_modbus{
 	/**
 	 * Wrapper class for libmodbus with some extra functionality.
+	 * The transactions are executed in order of priority by a bus thread, which keeps the interval between them.
 	 **/
 	class ModbusController{
 	public:
-		ModbusController(modbus_t* context);
+		enum{
+			/**
+			 * The time in nanoseconds a start time for writes on several buses is chosen after the moment all buses are free, so every bus thread is already waiting for it.
+			 **/
+			START_TIME_MARGIN = 1000000
+		};
+
+		/**
+		 * The priorities of transactions. A queued transaction is overtaken by transactions of a higher priority, transactions of the same priority are executed in order.
+		 **/
+		enum Priority{
+			/**
+			 * Stop commands and alarm handling.
+			 **/
+			PRIORITY_URGENT,
+			/**
+			 * Commands that start motions.
+			 **/
+			PRIORITY_MOTION,
+			/**
+			 * Parameter writes and reads.
+			 **/
+			PRIORITY_NORMAL,
+			/**
+			 * Status polls.
+			 **/
+			PRIORITY_POLL
+		};
+
+		/**
+		 * The ways the values read from a register are cached.
+		 **/
+		enum CachePolicy{
+			/**
+			 * The register is read from the bus every time. The default for every register.
+			 **/
+			CACHE_NEVER,
+			/**
+			 * The register only changes when it is written, its value is cached until then.
+			 **/
+			CACHE_STATIC,
+			/**
+			 * The register changes by itself, its value is cached for a time to live or until the slave is written.
+			 **/
+			CACHE_TIME_TO_LIVE
+		};
+
+		/**
+		 * Typedef for the result of a transaction. Holds the registers that were read, or nothing for a write.
+		 **/
+		typedef boost::shared_future<std::vector<uint16_t> > TransactionResult;
+
+		/**
+		 * A run of staged registers that is being written by a flush.
+		 **/
+		struct FlushedRun{
+			/**
+			 * @var uint16_t slave
+			 * The slave address, which may be the broadcast address.
+			 **/
+			uint16_t slave;
+
+			/**
+			 * @var uint16_t firstAddress
+			 * The address of the first register of the run.
+			 **/
+			uint16_t firstAddress;
+
+			/**
+			 * @var std::vector<uint16_t> data
+			 * The values that are written.
+			 **/
+			std::vector<uint16_t> data;
+
+			/**
+			 * @var std::vector<bool> useShadow
+			 * For every register, whether its shadow register is updated once the write succeeded.
+			 **/
+			std::vector<bool> useShadow;
+
+			/**
+			 * @var TransactionResult result
+			 * The result of the write.
+			 **/
+			TransactionResult result;
+		};
+
+		ModbusController(modbus_t* context, int baudRate = 0, char parity = 'N', int dataBits = 8, int stopBits = 1);
 		~ModbusController(void);
 
-		void writeU16(uint16_t slave, uint16_t address, uint16_t data, bool useShadow = false);
-		void writeU16(uint16_t slave, uint16_t firstAddress, uint16_t* data, unsigned int length);
-		void writeU32(uint16_t slave, uint16_t address, uint32_t data, bool useShadow = false);
-		uint16_t readU16(uint16_t slave, uint16_t address);
-		void readU16(uint16_t slave, uint16_t firstAddress, uint16_t* data, unsigned int length);
-		uint32_t readU32(uint16_t slave, uint16_t address);
+		void writeU16(uint16_t slave, uint16_t address, uint16_t data, bool useShadow = false, Priority priority = PRIORITY_NORMAL);
+		void writeU16(uint16_t slave, uint16_t firstAddress, uint16_t* data, unsigned int length, Priority priority = PRIORITY_NORMAL);
+		void writeU32(uint16_t slave, uint16_t address, uint32_t data, bool useShadow = false, Priority priority = PRIORITY_NORMAL);
+		uint16_t readU16(uint16_t slave, uint16_t address, Priority priority = PRIORITY_NORMAL);
+		void readU16(uint16_t slave, uint16_t firstAddress, uint16_t* data, unsigned int length, Priority priority = PRIORITY_NORMAL);
+		uint32_t readU32(uint16_t slave, uint16_t address, Priority priority = PRIORITY_NORMAL);
+
+		TransactionResult writeU16Async(uint16_t slave, uint16_t firstAddress, const uint16_t* data, unsigned int length, Priority priority = PRIORITY_NORMAL, int64_t startTime = 0);
+		TransactionResult readU16Async(uint16_t slave, uint16_t firstAddress, unsigned int length, Priority priority = PRIORITY_NORMAL);
+
+		void setCachePolicy(uint16_t firstAddress, unsigned int length, CachePolicy policy, long timeToLive = 0);
+		void invalidateCache(uint16_t slave);
+		void invalidateCache(void);
+
+		int64_t getNextTransactionTime(void);
+
+		void reserveRegisters(uint16_t slave, unsigned int numberOfRegisters);
+		void stageU16(uint16_t slave, uint16_t address, uint16_t data, bool useShadow = false);
+		void stageU32(uint16_t slave, uint16_t address, uint32_t data, bool useShadow = false);
+		void flush(uint16_t slave);
+		void flush(const uint16_t* slaves, unsigned int numberOfSlaves);
+		void flush(void);
+		void flushAsync(const uint16_t* slaves, unsigned int numberOfSlaves, std::vector<FlushedRun>& runs);
+		void finishFlush(std::vector<FlushedRun>& runs);
 
 	private:
 		enum{
@@ -78,15 +189,20 @@ namespace rexos_modbus{
 			MODBUS_ERRNO_TIMEOUT = 0x6E,
 
 			/**
-			 * The interval between writing on the modbus in unicast mode milliseconds.
+			 * The interval the slaves need after a unicast transaction before processing the next request, in milliseconds.
 			 **/
 			WRITE_INTERVAL_UNICAST = 8,
 
 			/**
-			 * The interval between writing on the modbus in broadcast mode in milliseconds.
+			 * The interval the slaves need after a broadcast before processing the next request, in milliseconds.
 			 **/
 			WRITE_INTERVAL_BROADCAST = 16,
 
+			/**
+			 * The silent interval between RTU frames in nanoseconds for baud rates above 19200, where the Modbus specification fixes it instead of using 3.5 characters.
+			 **/
+			FIXED_SILENT_INTERVAL = 1750000,
+
 			/**
 			 * Timeout for bytes in a response. This timeout will occur when a message is delayed while being send.
 			 * Value in microseconds.
@@ -98,6 +214,82 @@ namespace rexos_modbus{
 			 * Value in microseconds.
 			 **/
 			TIMEOUT_RESPONE = 150000,
+
+			/**
+			 * The maximum amount of registers written in a single transaction.
+			 **/
+			MAX_WRITE_REGISTERS = 10,
+
+			/**
+			 * The slave address every slave on the bus accepts a write from, without responding to it.
+			 **/
+			SLAVE_BROADCAST = 0,
+
+			/**
+			 * The amount of slave addresses, the broadcast address included.
+			 **/
+			NUMBER_OF_SLAVES = 248,
+
+			/**
+			 * The amount of transaction priorities.
+			 **/
+			NUMBER_OF_PRIORITIES = PRIORITY_POLL + 1
+		};
+
+		/**
+		 * A request for the bus thread.
+		 **/
+		struct Transaction{
+			/**
+			 * The modbus functions a transaction can use.
+			 **/
+			enum Type{
+				WRITE_REGISTER,
+				WRITE_REGISTERS,
+				READ_REGISTERS
+			};
+
+			/**
+			 * @var Type type
+			 * The modbus function of the transaction.
+			 **/
+			Type type;
+
+			/**
+			 * @var uint16_t slave
+			 * The slave address.
+			 **/
+			uint16_t slave;
+
+			/**
+			 * @var uint16_t firstAddress
+			 * The address of the first register.
+			 **/
+			uint16_t firstAddress;
+
+			/**
+			 * @var unsigned int length
+			 * The amount of registers.
+			 **/
+			unsigned int length;
+
+			/**
+			 * @var std::vector<uint16_t> data
+			 * The values that will be written. Empty for reads.
+			 **/
+			std::vector<uint16_t> data;
+
+			/**
+			 * @var int64_t startTime
+			 * The time, on the monotonic clock in nanoseconds, the transaction is not started before. 0 when it is started as soon as the bus is free.
+			 **/
+			int64_t startTime;
+
+			/**
+			 * @var boost::shared_ptr<boost::promise<std::vector<uint16_t> > > result
+			 * Fulfilled with the registers that were read once the transaction is done, or broken with a ModbusException.
+			 **/
+			boost::shared_ptr<boost::promise<std::vector<uint16_t> > > result;
 		};
 
 		/**
@@ -107,24 +299,102 @@ namespace rexos_modbus{
 		modbus_t* context;
 
 		/**
-		 * @var long nextWriteTime
-		 * Next time is used for synchronisation on the modbus interface.
+		 * @var int64_t characterTime
+		 * The time in nanoseconds it takes to transmit a character at the baud rate of the line, 0 when the line is not serial.
+		 **/
+		int64_t characterTime;
+
+		/**
+		 * @var int64_t silentInterval
+		 * The time in nanoseconds the line has to be silent between two RTU frames.
+		 **/
+		int64_t silentInterval;
+
+		/**
+		 * @var int64_t nextTransactionTime
+		 * Next time, on the monotonic clock in nanoseconds, is used for synchronisation on the modbus interface. Guarded by queueMutex.
 		 * Some devices require a certain wait time before a next request can be processed.
 		 **/
-		long nextWriteTime;
+		int64_t nextTransactionTime;
+
+		/**
+		 * @var std::deque<Transaction> transactions[NUMBER_OF_PRIORITIES]
+		 * The queued transactions, one queue for every priority.
+		 **/
+		std::deque<Transaction> transactions[NUMBER_OF_PRIORITIES];
+
+		/**
+		 * @var bool stopping
+		 * Tells the bus thread to stop.
+		 **/
+		bool stopping;
+
+		/**
+		 * @var boost::mutex queueMutex
+		 * Guards the transaction queues.
+		 **/
+		boost::mutex queueMutex;
+
+		/**
+		 * @var boost::condition_variable queueChanged
+		 * Notified when a transaction is queued.
+		 **/
+		boost::condition_variable queueChanged;
+
+		/**
+		 * @var boost::thread* busThread
+		 * Thread that executes the queued transactions.
+		 **/
+		boost::thread* busThread;
+
+		/**
+		 * @var std::vector<RegisterFile> registerFiles
+		 * The shadow, staged and cached registers of each slave, indexed by slave address. The register file of the broadcast address only holds staged registers.
+		 **/
+		std::vector<RegisterFile> registerFiles;
+
+		/**
+		 * The cache policy of a register address.
+		 **/
+		struct RegisterPolicy{
+			RegisterPolicy(void) : policy(CACHE_NEVER), timeToLive(0){}
+
+			/**
+			 * @var CachePolicy policy
+			 * The way the register is cached.
+			 **/
+			CachePolicy policy;
+
+			/**
+			 * @var int64_t timeToLive
+			 * The time in nanoseconds a value of a CACHE_TIME_TO_LIVE register stays valid.
+			 **/
+			int64_t timeToLive;
+		};
+
+		/**
+		 * @var std::vector<RegisterPolicy> cachePolicies
+		 * The cache policy of each register address, for all slaves. Addresses beyond the end are never cached.
+		 **/
+		std::vector<RegisterPolicy> cachePolicies;
+
+		/**
+		 * @var std::vector<uint16_t> timeToLiveAddresses
+		 * The addresses with the CACHE_TIME_TO_LIVE policy, which every write to their slave invalidates.
+		 **/
+		std::vector<uint16_t> timeToLiveAddresses;
 
 		/**
-		 * Typedef for a shadowMap registers spread over multiple slaves.
-		 * Key is slave address. 64bit for multiple slaves.
+		 * @var boost::mutex cacheMutex
+		 * Guards the cache policies and the cached registers in the register files. Never held while waiting for the bus.
 		 **/
-		typedef std::map<uint64_t, uint16_t> ShadowMap;
+		boost::mutex cacheMutex;
 
 		/**
-		 * @var ShadowMap shadowRegisters
-		 * Actual shadowmap instance.
-		 * @see ShadowMap
+		 * @var boost::recursive_mutex mutex
+		 * Guards the register files. Recursive because flush calls finishFlush.
 		 **/
-		ShadowMap shadowRegisters;
+		boost::recursive_mutex mutex;
 
 		#ifdef MODBUS_LOGGING
 			/**
@@ -134,11 +404,18 @@ namespace rexos_modbus{
 			std::ofstream logFile;
 		#endif
 
-		void wait(void);
+		TransactionResult submit(Transaction& transaction, Priority priority);
+		void runTransactions(void);
+		void execute(Transaction& transaction);
+		int64_t getTransactionInterval(const Transaction& transaction);
+		bool getCached(uint16_t slave, uint16_t firstAddress, unsigned int length, std::vector<uint16_t>& values);
+		void storeCached(uint16_t slave, uint16_t firstAddress, const std::vector<uint16_t>& values);
+		void invalidateWritten(uint16_t slave, uint16_t firstAddress, unsigned int length);
 
-		uint64_t getShadowAddress(uint16_t slave, uint16_t address);
 		bool getShadow(uint16_t slave, uint32_t address, uint16_t& outValue);
 		void setShadow(uint16_t slave, uint32_t address, uint16_t value);
 		void setShadow32(uint16_t slave, uint32_t address, uint32_t value);
+		RegisterFile& getRegisterFile(uint16_t slave);
+		void flushRuns(uint16_t slave, std::vector<FlushedRun>& runs);
 	};
 }
@@ -0,0 +1,136 @@
+/**
+ * @file RegisterFile.h
+ * @brief Dense shadow and staged registers of a modbus slave.
+ *
+ * @section LICENSE
+ * License: newBSD
+ * 
+ * Copyright © 2012, HU University of Applied Sciences Utrecht.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **/
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+namespace rexos_modbus{
+	/**
+	 * The registers of a single slave as known to the master: the value last written to each register (the shadow) and the values waiting to be written (the staged registers).
+	 * Registers are stored in arrays indexed by their address, which grow to the highest address used. Reserving the register space of the slave up front avoids allocations while writing.
+	 * Staged registers are marked in a dirty bitmap, which is scanned for runs of contiguous registers.
+	 * The values read from the slave are cached in arrays of their own, which grow separately, so the cache can be guarded by a different mutex than the shadow and staged registers.
+	 **/
+	class RegisterFile{
+	public:
+		RegisterFile(void);
+
+		void reserve(unsigned int numberOfRegisters);
+
+		bool getShadow(uint16_t address, uint16_t& value) const;
+		void setShadow(uint16_t address, uint16_t value);
+
+		void stage(uint16_t address, uint16_t value, bool useShadow);
+		void unstage(uint16_t address);
+		bool getStaged(uint16_t address, uint16_t& value, bool& useShadow) const;
+		bool findDirtyRun(unsigned int from, uint16_t& firstAddress, unsigned int& length, unsigned int maxLength) const;
+
+		/**
+		 * Returns whether registers are staged.
+		 *
+		 * @return true if at least one register is staged, false otherwise.
+		 **/
+		inline bool isDirty(void) const{ return numberOfDirtyRegisters > 0; }
+
+		bool getCached(uint16_t address, int64_t now, uint16_t& value) const;
+		void setCached(uint16_t address, uint16_t value, int64_t expiryTime);
+		void invalidateCached(uint16_t firstAddress, unsigned int length);
+		void invalidateCached(void);
+
+	private:
+		enum{
+			/**
+			 * The amount of registers in a word of a bitmap.
+			 **/
+			BITS_PER_WORD = 32
+		};
+
+		enum RegisterFlags{
+			/**
+			 * The shadow value of the register is known.
+			 **/
+			FLAG_SHADOWED = 0x01,
+
+			/**
+			 * The staged value updates the shadow once it is written.
+			 **/
+			FLAG_STAGED_USE_SHADOW = 0x02
+		};
+
+		/**
+		 * @var std::vector<uint16_t> shadowValues
+		 * The shadow value of each register, valid if FLAG_SHADOWED is set.
+		 **/
+		std::vector<uint16_t> shadowValues;
+
+		/**
+		 * @var std::vector<uint16_t> stagedValues
+		 * The staged value of each register, valid if its dirty bit is set.
+		 **/
+		std::vector<uint16_t> stagedValues;
+
+		/**
+		 * @var std::vector<uint8_t> flags
+		 * The RegisterFlags of each register.
+		 **/
+		std::vector<uint8_t> flags;
+
+		/**
+		 * @var std::vector<uint32_t> dirtyBits
+		 * Bitmap of the staged registers, bit n of word w is register w * BITS_PER_WORD + n.
+		 **/
+		std::vector<uint32_t> dirtyBits;
+
+		/**
+		 * @var unsigned int numberOfDirtyRegisters
+		 * The amount of bits set in dirtyBits.
+		 **/
+		unsigned int numberOfDirtyRegisters;
+
+		/**
+		 * @var std::vector<uint16_t> cachedValues
+		 * The value last read from each register, valid until its expiry time.
+		 **/
+		std::vector<uint16_t> cachedValues;
+
+		/**
+		 * @var std::vector<int64_t> cacheExpiryTimes
+		 * The time on the monotonic clock, in nanoseconds, after which the cached value of each register is no longer valid. 0 when the register is not cached.
+		 **/
+		std::vector<int64_t> cacheExpiryTimes;
+
+		/**
+		 * @var unsigned int numberOfCachedRegisters
+		 * The amount of registers with a non-zero expiry time, so files without cached registers are skipped when invalidating.
+		 **/
+		unsigned int numberOfCachedRegisters;
+
+		bool isStaged(unsigned int address) const;
+	};
+}
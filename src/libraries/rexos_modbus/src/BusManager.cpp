@@ -0,0 +1,150 @@
+/**
+ * @file BusManager.cpp
+ * @brief Owns the modbus controllers of the buses the slaves are spread over.
+ *
+ * @section LICENSE
+ * License: newBSD
+ * 
+ * Copyright © 2012, HU University of Applied Sciences Utrecht.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **/
+
+#include <rexos_modbus/BusManager.h>
+#include <rexos_modbus/ModbusException.h>
+
+#include <cstdlib>
+#include <sstream>
+
+namespace rexos_modbus{
+	/**
+	 * Constructor of a bus manager without buses.
+	 **/
+	BusManager::BusManager(void) : buses(){}
+
+	/**
+	 * Deconstructor of a bus manager. Stops the bus threads and closes the connections.
+	 * The motors using the buses must have been deleted.
+	 **/
+	BusManager::~BusManager(void){
+		for(BusMap::iterator it = buses.begin(); it != buses.end(); ++it){
+			delete it->second;
+		}
+	}
+
+	/**
+	 * Returns the controller of a serial line, connecting it when it is used for the first time.
+	 *
+	 * @param device The serial port, for instance /dev/ttyS0.
+	 * @param baudRate The baud rate of the serial line.
+	 * @param parity The parity of the serial line: 'N', 'E' or 'O'.
+	 * @param dataBits The amount of data bits in a character.
+	 * @param stopBits The amount of stop bits in a character.
+	 *
+	 * @return The controller of the serial line. The serial settings of a line that was already connected are not changed.
+	 **/
+	ModbusController* BusManager::getRtuBus(const std::string& device, int baudRate, char parity, int dataBits, int stopBits){
+		std::string key = "rtu:" + device;
+		BusMap::iterator it = buses.find(key);
+		if(it != buses.end()){
+			return it->second;
+		}
+		return addBus(key, modbus_new_rtu(device.c_str(), baudRate, parity, dataBits, stopBits), baudRate, parity, dataBits, stopBits);
+	}
+
+	/**
+	 * Returns the controller of a Modbus TCP gateway, connecting it when it is used for the first time.
+	 * The slave address of a transaction is sent as the unit identifier, which the gateway uses to address the slave on its serial line.
+	 *
+	 * @param ip The IP address of the gateway.
+	 * @param port The TCP port of the gateway.
+	 *
+	 * @return The controller of the gateway.
+	 **/
+	ModbusController* BusManager::getTcpBus(const std::string& ip, int port){
+		std::stringstream stream;
+		stream << "tcp:" << ip << ":" << port;
+		std::string key = stream.str();
+		BusMap::iterator it = buses.find(key);
+		if(it != buses.end()){
+			return it->second;
+		}
+		return addBus(key, modbus_new_tcp(ip.c_str(), port), 0, 'N', 8, 1);
+	}
+
+	/**
+	 * Returns the controller of a bus given by its address, connecting it when it is used for the first time.
+	 * The address is either "tcp:<ip>[:<port>]" for a Modbus TCP gateway, or "rtu:<device>" or just "<device>" for a serial line.
+	 *
+	 * @param address The address of the bus.
+	 * @param baudRate The baud rate of a serial line.
+	 * @param parity The parity of a serial line: 'N', 'E' or 'O'.
+	 * @param dataBits The amount of data bits in a character of a serial line.
+	 * @param stopBits The amount of stop bits in a character of a serial line.
+	 *
+	 * @return The controller of the bus.
+	 **/
+	ModbusController* BusManager::getBus(const std::string& address, int baudRate, char parity, int dataBits, int stopBits){
+		if(address.compare(0, 4, "tcp:") == 0){
+			std::string endpoint = address.substr(4);
+			std::string::size_type colon = endpoint.rfind(':');
+			if(colon == std::string::npos){
+				return getTcpBus(endpoint, MODBUS_TCP_DEFAULT_PORT);
+			}
+
+			int port = std::atoi(endpoint.c_str() + colon + 1);
+			if(port <= 0){
+				throw ModbusException("Invalid port in bus address " + address);
+			}
+			return getTcpBus(endpoint.substr(0, colon), port);
+		}
+
+		if(address.compare(0, 4, "rtu:") == 0){
+			return getRtuBus(address.substr(4), baudRate, parity, dataBits, stopBits);
+		}
+		return getRtuBus(address, baudRate, parity, dataBits, stopBits);
+	}
+
+	/**
+	 * Connects a bus and adds its controller.
+	 *
+	 * @param key The key of the bus in the bus map.
+	 * @param context The libmodbus context of the bus, freed when the connection fails.
+	 * @param baudRate The baud rate of a serial line, or 0 for a TCP connection.
+	 * @param parity The parity of a serial line.
+	 * @param dataBits The amount of data bits in a character of a serial line.
+	 * @param stopBits The amount of stop bits in a character of a serial line.
+	 *
+	 * @return The controller of the bus.
+	 **/
+	ModbusController* BusManager::addBus(const std::string& key, modbus_t* context, int baudRate, char parity, int dataBits, int stopBits){
+		if(context == NULL){
+			throw ModbusException("Unable to allocate libmodbus context for " + key);
+		}
+
+		ModbusController* controller;
+		try{
+			controller = new ModbusController(context, baudRate, parity, dataBits, stopBits);
+		} catch(ModbusException&){
+			modbus_free(context);
+			throw;
+		}
+		buses[key] = controller;
+		return controller;
+	}
+}
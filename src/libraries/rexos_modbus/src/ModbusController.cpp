@@ -34,27 +34,45 @@
 #include <rexos_modbus/ModbusException.h>
 #include <rexos_utilities/Utilities.h>
 
+#include <algorithm>
 #include <sstream>
 #include <string>
 #include <stdexcept>
 #include <boost/thread.hpp>
 #include <cstdio>
 #include <iostream>
+#include <limits>
 
 namespace rexos_modbus{
 	/**
-	 * Constructor of a modbuscontroller.
+	 * Constructor of a modbuscontroller. Connects and starts the bus thread.
+	 * The settings of a serial line determine the silent interval between frames. They are the settings the context was created with by modbus_new_rtu.
 	 * 
 	 * @param context Initialized modbus_t.
+	 * @param baudRate The baud rate of the serial line, or 0 when the connection is not serial.
+	 * @param parity The parity of the serial line: 'N', 'E' or 'O'.
+	 * @param dataBits The amount of data bits in a character.
+	 * @param stopBits The amount of stop bits in a character.
 	 **/
-    ModbusController::ModbusController(modbus_t* context) : 
+    ModbusController::ModbusController(modbus_t* context, int baudRate, char parity, int dataBits, int stopBits) : 
     context(context),
-    nextWriteTime(0), 
-    shadowRegisters(){
+    characterTime(0),
+    silentInterval(0),
+    nextTransactionTime(rexos_utilities::monotonicTimeNow()), 
+    stopping(false),
+    busThread(NULL),
+    registerFiles(NUMBER_OF_SLAVES){
 		if(context == NULL){
 			throw ModbusException("Error uninitialized connection");
 		}
 
+		if(baudRate > 0){
+			// A character consists of a start bit, the data bits, an optional parity bit and the stop bits.
+			int bitsPerCharacter = 1 + dataBits + (parity == 'N' ? 0 : 1) + stopBits;
+			characterTime = (int64_t)bitsPerCharacter * 1000000000 / baudRate;
+			silentInterval = baudRate > 19200 ? (int64_t)FIXED_SILENT_INTERVAL : characterTime * 7 / 2;
+		}
+
 		// Set timeout.
 		struct timeval timeoutEnd;
 		struct timeval timeoutBegin;
@@ -78,12 +96,23 @@ namespace rexos_modbus{
 		if(modbus_connect(context) == -1){
 			throw ModbusException("Unable to connect modbus");
 		}
+
+		busThread = new boost::thread(boost::bind(&ModbusController::runTransactions, this));
 	}
 
 	/**
-	 * Deconstructor of a modbuscontroller, ends logging and closes modbus connection.
+	 * Deconstructor of a modbuscontroller, stops the bus thread, ends logging and closes modbus connection.
+	 * Transactions that are still queued fail.
 	 **/
 	ModbusController::~ModbusController(void){
+		{
+			boost::lock_guard<boost::mutex> lock(queueMutex);
+			stopping = true;
+			queueChanged.notify_all();
+		}
+		busThread->join();
+		delete busThread;
+
 		#ifdef MODBUS_LOGGING
 			logFile.close();
 		#endif
@@ -92,25 +121,301 @@ namespace rexos_modbus{
 	}
 
 	/**
-	* Utility function. used to wait the remaining time till nextWriteTime.
-	**/
-	void ModbusController::wait(void){
-		long delta = nextWriteTime - rexos_utilities::timeNow();
-		if(delta > 0){
-			rexos_utilities::sleep(delta);
+	 * Queues a transaction for the bus thread.
+	 * 
+	 * @param transaction The transaction, its result is set by this function.
+	 * @param priority The priority of the transaction.
+	 * 
+	 * @return The result of the transaction.
+	 **/
+	ModbusController::TransactionResult ModbusController::submit(Transaction& transaction, Priority priority){
+		transaction.result.reset(new boost::promise<std::vector<uint16_t> >());
+		TransactionResult result(transaction.result->get_future());
+
+		boost::lock_guard<boost::mutex> lock(queueMutex);
+		if(stopping){
+			throw ModbusException("Modbus controller is stopped");
 		}
+		transactions[priority].push_back(transaction);
+		queueChanged.notify_all();
+		return result;
 	}
 
 	/**
-	 * Calculates a 64-bit value representing the crd514-kd motorcontroller and register address.
+	 * Body of the bus thread. Waits for the interval after the previous transaction, then executes the queued transaction with the highest priority.
+	 * The transaction is chosen after the interval, so a transaction queued meanwhile can still overtake the transactions of a lower priority.
+	 **/
+	void ModbusController::runTransactions(void){
+		boost::unique_lock<boost::mutex> lock(queueMutex);
+		while(!stopping){
+			int priority = 0;
+			while(priority < NUMBER_OF_PRIORITIES && transactions[priority].empty()){
+				priority++;
+			}
+
+			if(priority == NUMBER_OF_PRIORITIES){
+				queueChanged.wait(lock);
+				continue;
+			}
+
+			int64_t startTime = std::max(nextTransactionTime, transactions[priority].front().startTime);
+			if(rexos_utilities::monotonicTimeNow() < startTime){
+				// The queue is reexamined afterwards, for transactions that were queued meanwhile.
+				lock.unlock();
+				rexos_utilities::sleepUntil(startTime);
+				lock.lock();
+				continue;
+			}
+
+			Transaction transaction = transactions[priority].front();
+			transactions[priority].pop_front();
+			lock.unlock();
+			execute(transaction);
+			lock.lock();
+		}
+
+		for(int priority = 0; priority < NUMBER_OF_PRIORITIES; priority++){
+			for(std::deque<Transaction>::iterator it = transactions[priority].begin(); it != transactions[priority].end(); ++it){
+				it->result->set_exception(boost::copy_exception(ModbusException("Modbus controller is stopped")));
+			}
+			transactions[priority].clear();
+		}
+	}
+
+	/**
+	 * Executes a transaction on the bus and sets its result. Only used by the bus thread.
 	 * 
-	 * @param slave crd514-kd motorcontroller address.
-	 * @param address The register address.
+	 * @param transaction The transaction.
+	 **/
+	void ModbusController::execute(Transaction& transaction){
+		std::vector<uint16_t> values;
+		modbus_set_slave(context, transaction.slave);
+		int r;
+		switch(transaction.type){
+		case Transaction::WRITE_REGISTER:
+			r = modbus_write_register(context, (int)transaction.firstAddress, (int)transaction.data[0]);
+			break;
+		case Transaction::WRITE_REGISTERS:
+			r = modbus_write_registers(context, transaction.firstAddress, transaction.length, &transaction.data[0]);
+			break;
+		default:
+			values.resize(transaction.length);
+			r = modbus_read_registers(context, (int)transaction.firstAddress, transaction.length, &values[0]);
+			break;
+		}
+
+		{
+			boost::lock_guard<boost::mutex> lock(queueMutex);
+			nextTransactionTime = rexos_utilities::monotonicTimeNow() + getTransactionInterval(transaction);
+		}
+
+		if(transaction.type != Transaction::READ_REGISTERS){
+			// A failed write may still have reached the slave.
+			invalidateWritten(transaction.slave, transaction.firstAddress, transaction.length);
+		} else if(r != -1){
+			storeCached(transaction.slave, transaction.firstAddress, values);
+		}
+
+		if(r == -1){
+			// When broadcasting; ignore timeout errors.
+			if(transaction.type != Transaction::READ_REGISTERS && transaction.slave == 0 && errno == MODBUS_ERRNO_TIMEOUT){
+				transaction.result->set_value(values);
+				return;
+			}
+
+			const char* message;
+			switch(transaction.type){
+			case Transaction::WRITE_REGISTER:
+				message = "Error writing u16";
+				break;
+			case Transaction::WRITE_REGISTERS:
+				message = "Error writing u16 array";
+				break;
+			default:
+				message = transaction.length == 1 ? "Error reading u16" : "Error reading u16 array";
+				break;
+			}
+			transaction.result->set_exception(boost::copy_exception(ModbusException(message)));
+			return;
+		}
+		transaction.result->set_value(values);
+	}
+
+	/**
+	 * Calculates the time the bus has to stay idle after a transaction has returned.
+	 * After a unicast the response has been received, so the line only has to stay silent for the silent interval.
+	 * After a broadcast no response is awaited, so the request frame may still be transmitted when the transaction returns.
+	 * The interval is at least the interval the slaves need to process the transaction.
+	 * 
+	 * @param transaction The transaction that has returned.
+	 * 
+	 * @return The interval in nanoseconds.
+	 **/
+	int64_t ModbusController::getTransactionInterval(const Transaction& transaction){
+		// TODO: fix the broadcast issue slave == crd514_kd::slaves::BROADCAST temporary == 0
+		if(transaction.slave != 0){
+			return std::max(silentInterval, (int64_t)WRITE_INTERVAL_UNICAST * 1000000);
+		}
+
+		// An RTU request holds the slave address, the function, the first address and a CRC, and for a multiple write the register count, the byte count and the values.
+		int64_t frameLength = transaction.type == Transaction::WRITE_REGISTERS ? 9 + 2 * transaction.length : 8;
+		return std::max(frameLength * characterTime + silentInterval, (int64_t)WRITE_INTERVAL_BROADCAST * 1000000);
+	}
+
+	/**
+	 * Sets the way the values read from a range of registers are cached. The policy applies to the registers of every slave.
+	 * Values that were cached under the previous policy are dropped.
 	 * 
-	 * @return the 64-bit motorcontroller and register address value.
+	 * @param firstAddress The first register's address.
+	 * @param length The amount of registers.
+	 * @param policy The way the registers are cached.
+	 * @param timeToLive The time in milliseconds a value stays valid, only used by CACHE_TIME_TO_LIVE.
 	 **/
-	uint64_t ModbusController::getShadowAddress(uint16_t slave, uint16_t address){
-		return (slave << 16) | address;
+	void ModbusController::setCachePolicy(uint16_t firstAddress, unsigned int length, CachePolicy policy, long timeToLive){
+		boost::lock_guard<boost::mutex> lock(cacheMutex);
+		if(length == 0){
+			return;
+		}
+		if(firstAddress + length > cachePolicies.size()){
+			cachePolicies.resize(firstAddress + length);
+		}
+		for(unsigned int i = 0; i < length; i++){
+			RegisterPolicy& registerPolicy = cachePolicies[firstAddress + i];
+			registerPolicy.policy = policy;
+			registerPolicy.timeToLive = (int64_t)timeToLive * 1000000;
+		}
+
+		timeToLiveAddresses.clear();
+		for(unsigned int address = 0; address < cachePolicies.size(); address++){
+			if(cachePolicies[address].policy == CACHE_TIME_TO_LIVE){
+				timeToLiveAddresses.push_back(address);
+			}
+		}
+
+		for(uint16_t slave = 0; slave < NUMBER_OF_SLAVES; slave++){
+			registerFiles[slave].invalidateCached(firstAddress, length);
+		}
+	}
+
+	/**
+	 * Drops the cached values of a slave, for instance after the slave has been reset.
+	 * 
+	 * @param slave Slave address, the broadcast address drops the cached values of all slaves.
+	 **/
+	void ModbusController::invalidateCache(uint16_t slave){
+		boost::lock_guard<boost::mutex> lock(cacheMutex);
+		if(slave == SLAVE_BROADCAST){
+			for(uint16_t i = 0; i < NUMBER_OF_SLAVES; i++){
+				registerFiles[i].invalidateCached();
+			}
+		} else{
+			getRegisterFile(slave).invalidateCached();
+		}
+	}
+
+	/**
+	 * Drops the cached values of all slaves.
+	 **/
+	void ModbusController::invalidateCache(void){
+		invalidateCache(SLAVE_BROADCAST);
+	}
+
+	/**
+	 * Gets the time the slaves can process the next request after the last executed transaction. Transactions that are queued or being executed are not taken into account.
+	 * 
+	 * @return The time on the monotonic clock in nanoseconds, in the past when the bus has been idle long enough.
+	 **/
+	int64_t ModbusController::getNextTransactionTime(void){
+		boost::lock_guard<boost::mutex> lock(queueMutex);
+		return nextTransactionTime;
+	}
+
+	/**
+	 * Looks up a range of registers in the cache.
+	 * 
+	 * @param slave Slave address.
+	 * @param firstAddress The first register's address.
+	 * @param length The amount of registers.
+	 * @param values Output parameter, the cached values are stored here.
+	 * 
+	 * @return true if all registers in the range hold a valid cached value, false otherwise.
+	 **/
+	bool ModbusController::getCached(uint16_t slave, uint16_t firstAddress, unsigned int length, std::vector<uint16_t>& values){
+		boost::lock_guard<boost::mutex> lock(cacheMutex);
+		if(slave == SLAVE_BROADCAST || cachePolicies.empty()){
+			return false;
+		}
+
+		RegisterFile& registerFile = getRegisterFile(slave);
+		int64_t now = rexos_utilities::monotonicTimeNow();
+		values.resize(length);
+		for(unsigned int i = 0; i < length; i++){
+			if(!registerFile.getCached(firstAddress + i, now, values[i])){
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Stores the values read from a range of registers in the cache, for the registers that have a cache policy.
+	 * 
+	 * @param slave Slave address.
+	 * @param firstAddress The first register's address.
+	 * @param values The values that were read.
+	 **/
+	void ModbusController::storeCached(uint16_t slave, uint16_t firstAddress, const std::vector<uint16_t>& values){
+		boost::lock_guard<boost::mutex> lock(cacheMutex);
+		if(cachePolicies.empty()){
+			return;
+		}
+
+		RegisterFile& registerFile = getRegisterFile(slave);
+		int64_t now = rexos_utilities::monotonicTimeNow();
+		for(unsigned int i = 0; i < values.size() && firstAddress + i < cachePolicies.size(); i++){
+			const RegisterPolicy& policy = cachePolicies[firstAddress + i];
+			if(policy.policy != CACHE_NEVER){
+				registerFile.setCached(firstAddress + i, values[i], policy.policy == CACHE_STATIC ? std::numeric_limits<int64_t>::max() : now + policy.timeToLive);
+			}
+		}
+	}
+
+	/**
+	 * Drops the cached values a write may have changed: the written registers, and the time to live registers of the slave, since writing a command changes the status of a slave.
+	 * 
+	 * @param slave Slave address, a broadcast affects all slaves.
+	 * @param firstAddress The first written register's address.
+	 * @param length The amount of written registers.
+	 **/
+	void ModbusController::invalidateWritten(uint16_t slave, uint16_t firstAddress, unsigned int length){
+		boost::lock_guard<boost::mutex> lock(cacheMutex);
+		if(cachePolicies.empty()){
+			return;
+		}
+
+		uint16_t first = slave == SLAVE_BROADCAST ? 0 : slave;
+		uint16_t last = slave == SLAVE_BROADCAST ? NUMBER_OF_SLAVES - 1 : slave;
+		for(uint16_t i = first; i <= last; i++){
+			RegisterFile& registerFile = getRegisterFile(i);
+			registerFile.invalidateCached(firstAddress, length);
+			for(unsigned int j = 0; j < timeToLiveAddresses.size(); j++){
+				registerFile.invalidateCached(timeToLiveAddresses[j], 1);
+			}
+		}
+	}
+
+	/**
+	 * Returns the register file of a slave.
+	 * 
+	 * @param slave Slave address.
+	 * 
+	 * @return The register file of the slave.
+	 **/
+	RegisterFile& ModbusController::getRegisterFile(uint16_t slave){
+		if(slave >= NUMBER_OF_SLAVES){
+			throw ModbusException("Invalid slave address");
+		}
+		return registerFiles[slave];
 	}
 
 	/**
@@ -123,13 +428,7 @@ namespace rexos_modbus{
 	 * @return true if the value was shadowed, false otherwise.
 	 **/
 	bool ModbusController::getShadow(uint16_t slave, uint32_t address, uint16_t& outValue){
-		uint64_t shadowAddress = getShadowAddress(slave, address);
-		ShadowMap::iterator it = shadowRegisters.find(shadowAddress);
-		if(it == shadowRegisters.end()){
-			return false;
-		}
-		outValue = it->second;
-		return true;
+		return getRegisterFile(slave).getShadow(address, outValue);
 	}
 
 	/**
@@ -140,7 +439,7 @@ namespace rexos_modbus{
 	 * @param value The value that will be written.
 	 **/
 	void ModbusController::setShadow(uint16_t slave, uint32_t address, uint16_t value){
-		shadowRegisters[getShadowAddress(slave, address)] = value;
+		getRegisterFile(slave).setShadow(address, value);
 	}
 
 	/**
@@ -151,8 +450,9 @@ namespace rexos_modbus{
 	 * @param value The value that will be written.
 	 **/
 	void ModbusController::setShadow32(uint16_t slave, uint32_t address, uint32_t value){
-		shadowRegisters[getShadowAddress(slave, address+0)] = (value >> 16) & 0xFFFF;
-		shadowRegisters[getShadowAddress(slave, address+1)] = value & 0xFFFF;
+		RegisterFile& registerFile = getRegisterFile(slave);
+		registerFile.setShadow(address+0, (value >> 16) & 0xFFFF);
+		registerFile.setShadow(address+1, value & 0xFFFF);
 	}
 
 	/**
@@ -162,35 +462,24 @@ namespace rexos_modbus{
 	 * @param address The register address.
 	 * @param data Data that will be written.
 	 * @param useShadow If true is passed, it will check if writing is necessary by first checking the shadow registers.
+	 * @param priority The priority of the transaction.
 	 **/
-	void ModbusController::writeU16(uint16_t slave, uint16_t address, uint16_t data, bool useShadow){
+	void ModbusController::writeU16(uint16_t slave, uint16_t address, uint16_t data, bool useShadow, Priority priority){
 		#ifdef MODBUS_LOGGING
 			logFile << "WriteU16\t" << slave << "\t" << address << "\t" << data << std::endl;
 		#endif
 		if(useShadow){
+			boost::lock_guard<boost::recursive_mutex> lock(mutex);
 			uint16_t shadowData;
 			if(getShadow(slave, address, shadowData) && shadowData == data){
 				return;
 			}
 		}
 
-		wait();
-		modbus_set_slave(context, slave);
-		int r = modbus_write_register(context, (int)address, (int)data);
-
-		// TODO: fix the broadcast issue slave == crd514_kd::slaves::BROADCAST temporary == 0
-		nextWriteTime = rexos_utilities::timeNow() + (slave == 0 ? WRITE_INTERVAL_BROADCAST : WRITE_INTERVAL_UNICAST);
-
-		if(r == -1){
-			// When broadcasting; ignore timeout errors.
-			if(slave == 0 && errno == MODBUS_ERRNO_TIMEOUT){
-				return;
-			}
-			
-			throw ModbusException("Error writing u16");
-		}
+		writeU16Async(slave, address, &data, 1, priority).get();
 
 		if(useShadow){
+			boost::lock_guard<boost::recursive_mutex> lock(mutex);
 			setShadow(slave, address, data);
 		}
 	}
@@ -202,34 +491,16 @@ namespace rexos_modbus{
 	 * @param firstAddress The first register's address.
 	 * @param data Data that will be written.
 	 * @param length Data length (in words).
+	 * @param priority The priority of the transaction.
 	 **/
-	void ModbusController::writeU16(uint16_t slave, uint16_t firstAddress, uint16_t* data, unsigned int length){
-		if(length > 10){
-			throw ModbusException("length > 10");
-		}
-
-		wait();
-
+	void ModbusController::writeU16(uint16_t slave, uint16_t firstAddress, uint16_t* data, unsigned int length, Priority priority){
 		#ifdef MODBUS_LOGGING
 			for(unsigned int i = 0; i < length; i++){
 				logFile << "WriteU16Array\t" << slave << "\t" << (firstAddress + i) << "\t" << data[i] << std::endl;
 			}
 		#endif
 
-		modbus_set_slave(context, slave);
-		int r = modbus_write_registers(context, firstAddress, length, data);
-
-		// TODO: fix the broadcast issue slave == crd514_kd::slaves::BROADCAST temporary == 0
-		nextWriteTime = rexos_utilities::timeNow() + (slave == 0 ? WRITE_INTERVAL_BROADCAST : WRITE_INTERVAL_UNICAST);
-
-		if(r == -1){
-			// When broadcasting; ignore timeout errors
-			if(slave == 0 && errno == MODBUS_ERRNO_TIMEOUT){
-				return;
-			}
-
-			throw ModbusException("Error writing u16 array");
-		}
+		writeU16Async(slave, firstAddress, data, length, priority).get();
 	}
 
 	/**
@@ -239,8 +510,9 @@ namespace rexos_modbus{
 	 * @param address The register's address.
 	 * @param data Data that will be written.
 	 * @param useShadow If true is passed, it will check if writing is necessary by first checking the shadow registers.
+	 * @param priority The priority of the transaction.
 	 **/
-	void ModbusController::writeU32(uint16_t slave, uint16_t address, uint32_t data, bool useShadow){
+	void ModbusController::writeU32(uint16_t slave, uint16_t address, uint32_t data, bool useShadow, Priority priority){
 		#ifdef MODBUS_LOGGING
 			logFile << "WriteU32\t" << slave << "\t" << address << "\t" << data << std::endl;
 		#endif
@@ -252,28 +524,32 @@ namespace rexos_modbus{
 			if(useShadow){
 				uint16_t shadowHigh;
 				uint16_t shadowLow;
-				bool skipHigh = getShadow(slave, address+0, shadowHigh) && shadowHigh == _data[0];
-				bool skipLow = getShadow(slave, address+1, shadowLow) && shadowLow == _data[1];
+				bool skipHigh;
+				bool skipLow;
+				{
+					boost::lock_guard<boost::recursive_mutex> lock(mutex);
+					skipHigh = getShadow(slave, address+0, shadowHigh) && shadowHigh == _data[0];
+					skipLow = getShadow(slave, address+1, shadowLow) && shadowLow == _data[1];
+				}
 
 				if(skipHigh && skipLow){
 					return;
 				} else if(skipLow){
 					// Write high only
-					writeU16(slave, address, _data[0]);
-					setShadow(slave, address, _data[0]);
+					writeU16(slave, address, _data[0], true, priority);
 					return;
 				} else if(skipHigh){
 					// Write low only
-					writeU16(slave, address+1, _data[1]);
-					setShadow(slave, address+1, _data[1]);
+					writeU16(slave, address+1, _data[1], true, priority);
 					return;
 				}
 			}
 
 			// Write high & low
-			writeU16(slave, address, _data, 2);
+			writeU16(slave, address, _data, 2, priority);
 
 			if(useShadow){
+				boost::lock_guard<boost::recursive_mutex> lock(mutex);
 				setShadow32(slave, address, data);
 			}
 		} catch(ModbusException& exception){
@@ -286,21 +562,12 @@ namespace rexos_modbus{
 	 * 
 	 * @param slave Slave address.
 	 * @param address Address that will be read from.
+	 * @param priority The priority of the transaction.
 	 * 
 	 * @return the value that was read.
 	 **/
-	uint16_t ModbusController::readU16(uint16_t slave, uint16_t address){
-		wait();
-		modbus_set_slave(context, slave);
-		uint16_t data;
-		int r = modbus_read_registers(context, (int)address, 1, &data);
-
-		// TODO: fix the broadcast issue slave == crd514_kd::slaves::BROADCAST temporary == 0
-		nextWriteTime = rexos_utilities::timeNow() + (slave == 0 ? WRITE_INTERVAL_BROADCAST : WRITE_INTERVAL_UNICAST);
-
-		if(r == -1){
-			throw ModbusException("Error reading u16");
-		}
+	uint16_t ModbusController::readU16(uint16_t slave, uint16_t address, Priority priority){
+		uint16_t data = readU16Async(slave, address, 1, priority).get()[0];
 
 		#ifdef MODBUS_LOGGING
 			logFile << "ReadU16\t" << slave << "\t" << address << "\t" << data << std::endl;
@@ -315,18 +582,11 @@ namespace rexos_modbus{
 	 * @param firstAddress First registers address from which on data will be read.
 	 * @param data Will be stored here.
 	 * @param length Data length (in words).
+	 * @param priority The priority of the transaction.
 	 **/
-	void ModbusController::readU16(uint16_t slave, uint16_t firstAddress, uint16_t* data, unsigned int length){
-		wait();
-		modbus_set_slave(context, slave);
-		int r = modbus_read_registers(context, (int)firstAddress, length, data);
-
-		// TODO: fix the broadcast issue slave == crd514_kd::slaves::BROADCAST temporary == 0
-		nextWriteTime = rexos_utilities::timeNow() + (slave == 0 ? WRITE_INTERVAL_BROADCAST : WRITE_INTERVAL_UNICAST);
-
-		if(r == -1){
-			throw ModbusException("Error reading u16 array");
-		}
+	void ModbusController::readU16(uint16_t slave, uint16_t firstAddress, uint16_t* data, unsigned int length, Priority priority){
+		std::vector<uint16_t> values = readU16Async(slave, firstAddress, length, priority).get();
+		std::copy(values.begin(), values.end(), data);
 
 		#ifdef MODBUS_LOGGING
 			for(unsigned int i = 0; i < length; i++){
@@ -340,13 +600,14 @@ namespace rexos_modbus{
 	 * 
 	 * @param slave The slave address.
 	 * @param address Address from which will be read.
+	 * @param priority The priority of the transaction.
 	 * 
 	 * @return value that was read.
 	 **/	
-	uint32_t ModbusController::readU32(uint16_t slave, uint16_t address){
+	uint32_t ModbusController::readU32(uint16_t slave, uint16_t address, Priority priority){
 		try{
 			uint16_t data[2];
-			readU16(slave, address, data, 2);
+			readU16(slave, address, data, 2, priority);
 
 			#ifdef MODBUS_LOGGING
 				logFile << "ReadU32\t" << slave << "\t" << address << "\t" << (((data[0] << 16) & 0xFFFF0000) | data[1]) << std::endl;
@@ -360,4 +621,289 @@ namespace rexos_modbus{
 		// To suppress warning.
 		return 0;
 	}
+
+	/**
+	 * Queues a write of 16-bit values and returns without waiting for the bus.
+	 * A single value is written with the "write single register" function, more values with "write multiple registers".
+	 * 
+	 * @param slave Slave address.
+	 * @param firstAddress The first register's address.
+	 * @param data Data that will be written, it is copied.
+	 * @param length Data length (in words).
+	 * @param priority The priority of the transaction.
+	 * @param startTime The time, on the monotonic clock in nanoseconds, the write is not started before, or 0 to start it as soon as the bus is free. The bus is kept idle until then, so writes on several buses can be started together.
+	 * 
+	 * @return The result of the transaction, which rethrows the ModbusException if the write failed.
+	 **/
+	ModbusController::TransactionResult ModbusController::writeU16Async(uint16_t slave, uint16_t firstAddress, const uint16_t* data, unsigned int length, Priority priority, int64_t startTime){
+		if(length == 0 || length > MAX_WRITE_REGISTERS){
+			throw ModbusException("length > 10");
+		}
+
+		Transaction transaction;
+		transaction.type = length == 1 ? Transaction::WRITE_REGISTER : Transaction::WRITE_REGISTERS;
+		transaction.slave = slave;
+		transaction.firstAddress = firstAddress;
+		transaction.length = length;
+		transaction.data.assign(data, data + length);
+		transaction.startTime = startTime;
+		// Dropped once more when the write is executed, in case a read has cached the old values meanwhile.
+		invalidateWritten(slave, firstAddress, length);
+		return submit(transaction, priority);
+	}
+
+	/**
+	 * Queues a read of 16-bit values and returns without waiting for the bus.
+	 * 
+	 * @param slave Slave address.
+	 * @param firstAddress First registers address from which on data will be read.
+	 * @param length Data length (in words).
+	 * @param priority The priority of the transaction.
+	 * 
+	 * @return The result of the transaction, which holds the values that were read. It is ready at once when all values are cached.
+	 **/
+	ModbusController::TransactionResult ModbusController::readU16Async(uint16_t slave, uint16_t firstAddress, unsigned int length, Priority priority){
+		std::vector<uint16_t> values;
+		if(getCached(slave, firstAddress, length, values)){
+			boost::promise<std::vector<uint16_t> > cached;
+			cached.set_value(values);
+			return TransactionResult(cached.get_future());
+		}
+
+		Transaction transaction;
+		transaction.type = Transaction::READ_REGISTERS;
+		transaction.slave = slave;
+		transaction.firstAddress = firstAddress;
+		transaction.length = length;
+		transaction.startTime = 0;
+		return submit(transaction, priority);
+	}
+
+	/**
+	 * Allocates the shadow and staged registers of a slave, so writing and staging do not allocate memory.
+	 * The registers of the broadcast address are allocated as well, for the registers a flush broadcasts.
+	 * Registers outside the reserved space can still be used, the register file of the slave grows when they are.
+	 * 
+	 * @param slave Slave address.
+	 * @param numberOfRegisters The size of the register space of the slave, the highest address used plus one.
+	 **/
+	void ModbusController::reserveRegisters(uint16_t slave, unsigned int numberOfRegisters){
+		boost::lock_guard<boost::recursive_mutex> lock(mutex);
+		getRegisterFile(slave).reserve(numberOfRegisters);
+		getRegisterFile(SLAVE_BROADCAST).reserve(numberOfRegisters);
+	}
+
+	/**
+	 * Stages a 16-bit value to be written by the next flush of its slave.
+	 * Staged registers that follow each other are written in a single transaction.
+	 * 
+	 * @param slave Slave address.
+	 * @param address The register's address.
+	 * @param data Data that will be written.
+	 * @param useShadow If true is passed, the value is not staged when the shadow register already holds it.
+	 **/
+	void ModbusController::stageU16(uint16_t slave, uint16_t address, uint16_t data, bool useShadow){
+		boost::lock_guard<boost::recursive_mutex> lock(mutex);
+		RegisterFile& registerFile = getRegisterFile(slave);
+		if(useShadow){
+			uint16_t shadowData;
+			if(registerFile.getShadow(address, shadowData) && shadowData == data){
+				// A value staged earlier may have been overridden by the value the register already holds.
+				registerFile.unstage(address);
+				return;
+			}
+		}
+		registerFile.stage(address, data, useShadow);
+	}
+
+	/**
+	 * Stages a 32-bit value to be written by the next flush of its slave. Only the words that differ from the shadow registers are staged.
+	 * 
+	 * @param slave Slave address.
+	 * @param address The register's address.
+	 * @param data Data that will be written.
+	 * @param useShadow If true is passed, a word is not staged when the shadow register already holds it.
+	 **/
+	void ModbusController::stageU32(uint16_t slave, uint16_t address, uint32_t data, bool useShadow){
+		boost::lock_guard<boost::recursive_mutex> lock(mutex);
+		stageU16(slave, address, (data >> 16) & 0xFFFF, useShadow);
+		stageU16(slave, address + 1, data & 0xFFFF, useShadow);
+	}
+
+	/**
+	 * Writes the staged registers of a slave, combining contiguous registers into a single transaction of at most MAX_WRITE_REGISTERS registers.
+	 * When a transaction fails, its registers stay staged.
+	 * 
+	 * @param slave Slave address.
+	 **/
+	void ModbusController::flush(uint16_t slave){
+		boost::lock_guard<boost::recursive_mutex> lock(mutex);
+		std::vector<FlushedRun> runs;
+		flushRuns(slave, runs);
+		finishFlush(runs);
+		for(unsigned int i = 0; i < runs.size(); i++){
+			runs[i].result.get();
+		}
+	}
+
+	/**
+	 * Writes the staged registers of a group of slaves, as flushAsync does, and waits for the writes.
+	 * 
+	 * @param slaves The addresses of the slaves in the group.
+	 * @param numberOfSlaves The amount of slaves in the group.
+	 **/
+	void ModbusController::flush(const uint16_t* slaves, unsigned int numberOfSlaves){
+		std::vector<FlushedRun> runs;
+		flushAsync(slaves, numberOfSlaves, runs);
+		finishFlush(runs);
+		for(unsigned int i = 0; i < runs.size(); i++){
+			runs[i].result.get();
+		}
+	}
+
+	/**
+	 * Queues the writes of the staged registers of a group of slaves and returns without waiting for the bus. A register that is staged with the same value for every slave of the group is broadcast once, when that takes less time than writing it to every slave.
+	 * The slaves do not answer a broadcast, so a lost broadcast goes unnoticed. Registers staged with useShadow are therefore never broadcast: their shadow registers are only updated after a slave acknowledged the write.
+	 * The remaining registers are written to each slave separately.
+	 * A broadcast reaches every slave on the bus, so the group has to consist of all slaves on the bus.
+	 * The queued registers are no longer staged. finishFlush has to be called with the runs once they are written, to update the shadow registers and stage the registers of failed writes again.
+	 * 
+	 * @param slaves The addresses of the slaves in the group.
+	 * @param numberOfSlaves The amount of slaves in the group.
+	 * @param runs Output parameter, the queued runs are appended to it.
+	 **/
+	void ModbusController::flushAsync(const uint16_t* slaves, unsigned int numberOfSlaves, std::vector<FlushedRun>& runs){
+		boost::lock_guard<boost::recursive_mutex> lock(mutex);
+		if(numberOfSlaves == 0){
+			return;
+		}
+
+		if(numberOfSlaves * WRITE_INTERVAL_UNICAST > WRITE_INTERVAL_BROADCAST){
+			// A run of contiguous registers is only broadcast when it is common to all slaves, a partial broadcast would not spare the slaves a transaction.
+			RegisterFile& firstRegisterFile = getRegisterFile(slaves[0]);
+			RegisterFile& broadcastRegisterFile = getRegisterFile(SLAVE_BROADCAST);
+			uint16_t firstAddress;
+			unsigned int length;
+			unsigned int from = 0;
+			while(firstRegisterFile.findDirtyRun(from, firstAddress, length, std::numeric_limits<unsigned int>::max())){
+				bool common = true;
+				for(unsigned int offset = 0; offset < length && common; offset++){
+					uint16_t value;
+					bool useShadow;
+					firstRegisterFile.getStaged(firstAddress + offset, value, useShadow);
+					common = !useShadow;
+					for(unsigned int i = 1; i < numberOfSlaves && common; i++){
+						uint16_t otherValue;
+						bool otherUseShadow;
+						common = getRegisterFile(slaves[i]).getStaged(firstAddress + offset, otherValue, otherUseShadow) && otherValue == value && !otherUseShadow;
+					}
+				}
+
+				if(common){
+					for(unsigned int offset = 0; offset < length; offset++){
+						uint16_t address = firstAddress + offset;
+						uint16_t value;
+						bool useShadow;
+						firstRegisterFile.getStaged(address, value, useShadow);
+						broadcastRegisterFile.stage(address, value, false);
+						for(unsigned int i = 0; i < numberOfSlaves; i++){
+							getRegisterFile(slaves[i]).unstage(address);
+						}
+					}
+				}
+				from = firstAddress + length;
+			}
+
+			flushRuns(SLAVE_BROADCAST, runs);
+		}
+
+		for(unsigned int i = 0; i < numberOfSlaves; i++){
+			flushRuns(slaves[i], runs);
+		}
+	}
+
+	/**
+	 * Waits for the writes of a flush. Updates the shadow registers of the runs that were written, and stages the registers of the runs that failed again, unless they have been staged anew meanwhile.
+	 * Does not throw for failed writes, the result of every run holds its exception.
+	 * 
+	 * @param runs The runs queued by flushAsync.
+	 **/
+	void ModbusController::finishFlush(std::vector<FlushedRun>& runs){
+		for(unsigned int i = 0; i < runs.size(); i++){
+			runs[i].result.wait();
+		}
+
+		boost::lock_guard<boost::recursive_mutex> lock(mutex);
+		for(unsigned int i = 0; i < runs.size(); i++){
+			FlushedRun& run = runs[i];
+			bool written = !run.result.has_exception();
+			RegisterFile& registerFile = getRegisterFile(run.slave);
+			for(unsigned int j = 0; j < run.data.size(); j++){
+				uint16_t address = run.firstAddress + j;
+				uint16_t value;
+				bool useShadow;
+				if(written){
+					if(run.useShadow[j]){
+						setShadow(run.slave, address, run.data[j]);
+					}
+				} else if(!registerFile.getStaged(address, value, useShadow)){
+					registerFile.stage(address, run.data[j], run.useShadow[j]);
+				}
+			}
+		}
+	}
+
+	/**
+	 * Queues the writes of the staged registers of a slave, combining contiguous registers into a single transaction of at most MAX_WRITE_REGISTERS registers, and unstages them.
+	 * The register file mutex must be held.
+	 * 
+	 * @param slave Slave address, which may be the broadcast address.
+	 * @param runs Output parameter, the queued runs are appended to it.
+	 **/
+	void ModbusController::flushRuns(uint16_t slave, std::vector<FlushedRun>& runs){
+		RegisterFile& registerFile = getRegisterFile(slave);
+		uint16_t firstAddress;
+		unsigned int length;
+		unsigned int from = 0;
+		while(registerFile.findDirtyRun(from, firstAddress, length, MAX_WRITE_REGISTERS)){
+			runs.push_back(FlushedRun());
+			FlushedRun& run = runs.back();
+			run.slave = slave;
+			run.firstAddress = firstAddress;
+			run.data.resize(length);
+			run.useShadow.resize(length);
+			for(unsigned int i = 0; i < length; i++){
+				bool useShadow;
+				registerFile.getStaged(firstAddress + i, run.data[i], useShadow);
+				run.useShadow[i] = useShadow;
+			}
+			try{
+				run.result = writeU16Async(slave, firstAddress, &run.data[0], length);
+			} catch(ModbusException&){
+				runs.pop_back();
+				throw;
+			}
+			for(unsigned int i = 0; i < length; i++){
+				registerFile.unstage(firstAddress + i);
+			}
+			from = firstAddress + length;
+		}
+	}
+
+	/**
+	 * Writes the staged registers of all slaves.
+	 **/
+	void ModbusController::flush(void){
+		boost::lock_guard<boost::recursive_mutex> lock(mutex);
+		std::vector<FlushedRun> runs;
+		for(uint16_t slave = 0; slave < NUMBER_OF_SLAVES; slave++){
+			if(registerFiles[slave].isDirty()){
+				flushRuns(slave, runs);
+			}
+		}
+		finishFlush(runs);
+		for(unsigned int i = 0; i < runs.size(); i++){
+			runs[i].result.get();
+		}
+	}
 }
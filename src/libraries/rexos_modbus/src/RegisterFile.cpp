@@ -0,0 +1,242 @@
+/**
+ * @file RegisterFile.cpp
+ * @brief Dense shadow and staged registers of a modbus slave.
+ *
+ * @section LICENSE
+ * License: newBSD
+ * 
+ * Copyright © 2012, HU University of Applied Sciences Utrecht.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **/
+
+#include <rexos_modbus/RegisterFile.h>
+#include <algorithm>
+
+namespace rexos_modbus{
+	/**
+	 * Constructor of an empty register file. The arrays grow when registers are used.
+	 **/
+	RegisterFile::RegisterFile(void) : numberOfDirtyRegisters(0), numberOfCachedRegisters(0){}
+
+	/**
+	 * Grows the register file to hold at least the given amount of registers. Registers already in the file keep their state.
+	 *
+	 * @param numberOfRegisters The amount of registers, the highest address used plus one.
+	 **/
+	void RegisterFile::reserve(unsigned int numberOfRegisters){
+		if(numberOfRegisters <= shadowValues.size()){
+			return;
+		}
+		shadowValues.resize(numberOfRegisters, 0);
+		stagedValues.resize(numberOfRegisters, 0);
+		flags.resize(numberOfRegisters, 0);
+		dirtyBits.resize((numberOfRegisters + BITS_PER_WORD - 1) / BITS_PER_WORD, 0);
+	}
+
+	/**
+	 * Reads a shadow register.
+	 *
+	 * @param address The register address.
+	 * @param value Output parameter, the value gets stored here.
+	 *
+	 * @return true if the value was shadowed, false otherwise.
+	 **/
+	bool RegisterFile::getShadow(uint16_t address, uint16_t& value) const{
+		if(address >= flags.size() || !(flags[address] & FLAG_SHADOWED)){
+			return false;
+		}
+		value = shadowValues[address];
+		return true;
+	}
+
+	/**
+	 * Writes a value to a shadow register.
+	 *
+	 * @param address The register address.
+	 * @param value The value that was written to the slave.
+	 **/
+	void RegisterFile::setShadow(uint16_t address, uint16_t value){
+		reserve(address + 1);
+		shadowValues[address] = value;
+		flags[address] |= FLAG_SHADOWED;
+	}
+
+	/**
+	 * Stages a value, replacing a value staged earlier.
+	 *
+	 * @param address The register address.
+	 * @param value The value that will be written.
+	 * @param useShadow Whether the shadow register is updated once the value is written.
+	 **/
+	void RegisterFile::stage(uint16_t address, uint16_t value, bool useShadow){
+		reserve(address + 1);
+		if(!isStaged(address)){
+			dirtyBits[address / BITS_PER_WORD] |= 1u << (address % BITS_PER_WORD);
+			numberOfDirtyRegisters++;
+		}
+		stagedValues[address] = value;
+		if(useShadow){
+			flags[address] |= FLAG_STAGED_USE_SHADOW;
+		} else{
+			flags[address] &= ~FLAG_STAGED_USE_SHADOW;
+		}
+	}
+
+	/**
+	 * Discards the staged value of a register, if any.
+	 *
+	 * @param address The register address.
+	 **/
+	void RegisterFile::unstage(uint16_t address){
+		if(isStaged(address)){
+			dirtyBits[address / BITS_PER_WORD] &= ~(1u << (address % BITS_PER_WORD));
+			numberOfDirtyRegisters--;
+		}
+	}
+
+	/**
+	 * Reads a staged register.
+	 *
+	 * @param address The register address.
+	 * @param value Output parameter, the staged value gets stored here.
+	 * @param useShadow Output parameter, whether the shadow register is updated once the value is written.
+	 *
+	 * @return true if a value is staged, false otherwise.
+	 **/
+	bool RegisterFile::getStaged(uint16_t address, uint16_t& value, bool& useShadow) const{
+		if(!isStaged(address)){
+			return false;
+		}
+		value = stagedValues[address];
+		useShadow = (flags[address] & FLAG_STAGED_USE_SHADOW) != 0;
+		return true;
+	}
+
+	/**
+	 * Finds the first run of contiguous staged registers at or after an address. Words of the bitmap without staged registers are skipped at once.
+	 *
+	 * @param from The address the search starts at.
+	 * @param firstAddress Output parameter, the address of the first register of the run.
+	 * @param length Output parameter, the amount of registers in the run.
+	 * @param maxLength The maximum amount of registers in the run, a longer run is split.
+	 *
+	 * @return true if a run was found, false otherwise.
+	 **/
+	bool RegisterFile::findDirtyRun(unsigned int from, uint16_t& firstAddress, unsigned int& length, unsigned int maxLength) const{
+		if(numberOfDirtyRegisters == 0){
+			return false;
+		}
+
+		unsigned int address = from;
+		while(address < stagedValues.size() && !isStaged(address)){
+			if(address % BITS_PER_WORD == 0 && dirtyBits[address / BITS_PER_WORD] == 0){
+				address += BITS_PER_WORD;
+			} else{
+				address++;
+			}
+		}
+		if(address >= stagedValues.size()){
+			return false;
+		}
+
+		firstAddress = address;
+		length = 0;
+		while(length < maxLength && address < stagedValues.size() && isStaged(address)){
+			length++;
+			address++;
+		}
+		return true;
+	}
+
+	/**
+	 * Reads a cached register.
+	 *
+	 * @param address The register address.
+	 * @param now The current time on the monotonic clock in nanoseconds.
+	 * @param value Output parameter, the cached value gets stored here.
+	 *
+	 * @return true if the register holds a cached value that has not expired, false otherwise.
+	 **/
+	bool RegisterFile::getCached(uint16_t address, int64_t now, uint16_t& value) const{
+		if(address >= cacheExpiryTimes.size() || cacheExpiryTimes[address] <= now){
+			return false;
+		}
+		value = cachedValues[address];
+		return true;
+	}
+
+	/**
+	 * Caches a value read from a register.
+	 *
+	 * @param address The register address.
+	 * @param value The value that was read.
+	 * @param expiryTime The time on the monotonic clock, in nanoseconds, after which the value is no longer valid.
+	 **/
+	void RegisterFile::setCached(uint16_t address, uint16_t value, int64_t expiryTime){
+		if(address >= cacheExpiryTimes.size()){
+			cachedValues.resize(address + 1, 0);
+			cacheExpiryTimes.resize(address + 1, 0);
+		}
+		if(cacheExpiryTimes[address] == 0){
+			numberOfCachedRegisters++;
+		}
+		cachedValues[address] = value;
+		cacheExpiryTimes[address] = expiryTime;
+	}
+
+	/**
+	 * Drops the cached values of a range of registers.
+	 *
+	 * @param firstAddress The first register's address.
+	 * @param length The amount of registers.
+	 **/
+	void RegisterFile::invalidateCached(uint16_t firstAddress, unsigned int length){
+		if(numberOfCachedRegisters == 0){
+			return;
+		}
+		unsigned int end = std::min((unsigned int)firstAddress + length, (unsigned int)cacheExpiryTimes.size());
+		for(unsigned int address = firstAddress; address < end; address++){
+			if(cacheExpiryTimes[address] != 0){
+				cacheExpiryTimes[address] = 0;
+				numberOfCachedRegisters--;
+			}
+		}
+	}
+
+	/**
+	 * Drops the cached values of all registers.
+	 **/
+	void RegisterFile::invalidateCached(void){
+		if(numberOfCachedRegisters > 0){
+			std::fill(cacheExpiryTimes.begin(), cacheExpiryTimes.end(), 0);
+			numberOfCachedRegisters = 0;
+		}
+	}
+
+	/**
+	 * Returns whether a register is staged.
+	 *
+	 * @param address The register address.
+	 *
+	 * @return true if a value is staged, false otherwise.
+	 **/
+	bool RegisterFile::isStaged(unsigned int address) const{
+		return address < stagedValues.size() && (dirtyBits[address / BITS_PER_WORD] & (1u << (address % BITS_PER_WORD))) != 0;
+	}
+}
@@ -73,11 +73,35 @@ namespace rexos_motor{
 		 **/
 		const double MOTOR_MAX_SPEED = MOTOR_STEP_ANGLE * 500000;
 
+		/**
+		 * @var int LINKED_MOTIONS_MAX
+		 * The maximum amount of motion slots the CRD514KD runs as a single linked motion, without stopping in between.
+		 **/
+		const int LINKED_MOTIONS_MAX = 4;
+
 		/**
 		 * @var int MOTION_SLOTS_USED
-		 * The amount of motion slots being used. This value can be anywhere from 1 to 63. However, there is currently no use for it being any more than 2. 
+		 * The amount of motion slots being used. This value can be anywhere from 1 to 63. Two linked motions fit, so one can be written while the other runs.
+		 **/
+		const int MOTION_SLOTS_USED = 2 * LINKED_MOTIONS_MAX;
+
+		/**
+		 * @var int MIN_POLL_INTERVAL
+		 * The time in milliseconds between the first status polls once a motion should have ended. Every poll that finds the motor still moving doubles the interval.
+		 **/
+		const int MIN_POLL_INTERVAL = 2;
+
+		/**
+		 * @var int MAX_POLL_INTERVAL
+		 * The maximum time in milliseconds between two status polls of a moving motor.
+		 **/
+		const int MAX_POLL_INTERVAL = 32;
+
+		/**
+		 * @var int NUMBER_OF_REGISTERS
+		 * The size of the register space of a CRD514KD. The last register is the dwell time of motion slot 63, at 0xC3F.
 		 **/
-		const int MOTION_SLOTS_USED = 2;
+		const int NUMBER_OF_REGISTERS = 0xC40;
 
 		namespace Slaves{
 			/**
@@ -31,6 +31,10 @@
 
 #pragma once
 
+#include <deque>
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
 #include <rexos_modbus/ModbusController.h>
 #include <rexos_motor/StepperMotor.h>
 
@@ -41,18 +45,13 @@ namespace rexos_motor{
 	 **/
 	class MotorManager{
 	public:
-		/**
-		 * Constructor for the motor manager
-		 *
-		 * @param modbus Pointer to an established modbus connection.
-		 * @param motors Pointer array containing all motors for this manager.
-		 * @param numberOfMotors Number of motors in the pointer array.
-		 **/
-		MotorManager(rexos_modbus::ModbusController* modbus, StepperMotor** motors, int numberOfMotors) :
-			modbus(modbus), motors(motors), numberOfMotors(numberOfMotors), poweredOn(false){}
+		MotorManager(StepperMotor** motors, int numberOfMotors);
+
+		~MotorManager(void);
 
 		void powerOn(void);
 		void powerOff(void);
+		void flush(void);
 
 		/**
 		 * Check whether the motormanager has been initiated.
@@ -60,13 +59,66 @@ namespace rexos_motor{
 		 **/
 		bool isPoweredOn(void){ return poweredOn; }
 		void startMovement(int motionSlot);
+		boost::shared_future<void> startMovementAsync(int motionSlot, double expectedDuration = 0);
 
 	private:
 		/**
-		 * @var ModbusController::ModbusController* modbus
-		 * Pointer to an established modbus connection.
+		 * A motion that has been handed to the I/O thread.
+		 **/
+		struct QueuedMovement{
+			/**
+			 * @var int motionSlot
+			 * The motion slot that holds the rotation data of the motion.
+			 **/
+			int motionSlot;
+
+			/**
+			 * @var int64_t expectedDuration
+			 * The time in nanoseconds the motion is expected to take, the motors are not polled before it has passed.
+			 **/
+			int64_t expectedDuration;
+
+			/**
+			 * @var boost::shared_ptr<boost::promise<void> > completion
+			 * Fulfilled when the motors have finished the motion, or broken when it failed or was cancelled.
+			 **/
+			boost::shared_ptr<boost::promise<void> > completion;
+		};
+
+		void runMovements(void);
+		void waitTillMotorsReady(int64_t expectedEnd);
+		void cancelMovements(const std::string& reason);
+		void waitTillIdle(boost::unique_lock<boost::mutex>& lock);
+		void writeCommand(uint16_t address, uint16_t data, rexos_modbus::ModbusController::Priority priority = rexos_modbus::ModbusController::PRIORITY_NORMAL);
+
+		/**
+		 * The motors on a single bus.
 		 **/
-		rexos_modbus::ModbusController* modbus;
+		struct Bus{
+			/**
+			 * @var ModbusController::ModbusController* modbus
+			 * The controller of the bus.
+			 **/
+			rexos_modbus::ModbusController* modbus;
+
+			/**
+			 * @var std::vector<int> motors
+			 * The indices in the motors array of the motors on the bus.
+			 **/
+			std::vector<int> motors;
+
+			/**
+			 * @var std::vector<uint16_t> slaves
+			 * The slave addresses of the motors on the bus.
+			 **/
+			std::vector<uint16_t> slaves;
+		};
+
+		/**
+		 * @var std::vector<Bus> buses
+		 * The buses the motors are on, in the order of their first motor.
+		 **/
+		std::vector<Bus> buses;
 
 		/**
 		 * @var StepperMotor** motors
@@ -85,5 +137,47 @@ namespace rexos_motor{
 		 * Stores whether the motor manager has been turned on.
 		 **/
 		bool poweredOn;
+
+		/**
+		 * @var std::deque<QueuedMovement> queuedMovements
+		 * Motions waiting for the running motion to finish, in the order they will be started.
+		 **/
+		std::deque<QueuedMovement> queuedMovements;
+
+		/**
+		 * @var QueuedMovement runningMovement
+		 * The motion the motors are executing. Its completion is NULL when the I/O thread has no motion running.
+		 **/
+		QueuedMovement runningMovement;
+
+		/**
+		 * @var int64_t runningMovementEnd
+		 * The time, on the monotonic clock in nanoseconds, the running motion is expected to end.
+		 **/
+		int64_t runningMovementEnd;
+
+		/**
+		 * @var bool stopping
+		 * Tells the I/O thread to stop.
+		 **/
+		bool stopping;
+
+		/**
+		 * @var boost::mutex queueMutex
+		 * Guards the queue, the running motion and the power state against the I/O thread.
+		 **/
+		boost::mutex queueMutex;
+
+		/**
+		 * @var boost::condition_variable queueChanged
+		 * Notified when a motion is queued, started or finished.
+		 **/
+		boost::condition_variable queueChanged;
+
+		/**
+		 * @var boost::thread* ioThread
+		 * Thread that polls the motors and starts the queued motions. Started by the first asynchronous motion.
+		 **/
+		boost::thread* ioThread;
 	};
 }
@@ -52,6 +52,9 @@ namespace rexos_motor{
 
 		void powerOn(void);
 		void powerOff(void);
+		void stageConfiguration(void);
+		void markPoweredOn(void);
+		void markPoweredOff(void);
 		void stop(void);
 
 		void resetCounter(void);
@@ -59,13 +62,30 @@ namespace rexos_motor{
 		void moveTo(const rexos_datatypes::MotorRotation& motorRotation, int motionSlot);
 		void moveTo(const rexos_datatypes::MotorRotation& motorRotation);
 
-		void writeRotationData(const rexos_datatypes::MotorRotation& motorRotation, int motionSlot, bool useDeviation = true);
+		void writeRotationData(const rexos_datatypes::MotorRotation& motorRotation, int motionSlot, bool useDeviation = true, bool flush = true);
+		void setLinkedMotion(int motionSlot, bool linked, bool flush = true);
 
 		void startMovement(int motionSlot);
 		void waitTillReady(void);
+		bool isReady(void);
+		bool isReady(uint16_t status_1);
 
 		bool isPoweredOn(void){ return poweredOn; }
 
+		/**
+		 * Returns the modbus slave address of the motor controller.
+		 *
+		 * @return The slave address of the motor controller.
+		 **/
+		inline CRD514KD::Slaves::t getMotorIndex(void) const{ return motorIndex; }
+
+		/**
+		 * Returns the controller of the bus the motor controller is on.
+		 *
+		 * @return The controller of the bus the motor controller is on.
+		 **/
+		inline rexos_modbus::ModbusController* getModbusController(void) const{ return modbus; }
+
 		/**
 		 * Returns the minimum angle, in radians, the StepperMotor can travel on the theoretical plane.
 		 * 
@@ -101,10 +121,11 @@ namespace rexos_motor{
 		 **/
 		double getDeviation(void){ return deviation; }
 
-		void setDeviationAndWriteMotorLimits(double deviation);
+		void setDeviationAndWriteMotorLimits(double deviation, bool flush = true);
+		void setAngleLimitsAndWriteMotorLimits(double minAngle, double maxAngle);
 
-		void enableAngleLimitations(void);
-		void disableAngleLimitations(void);
+		void enableAngleLimitations(bool flush = true);
+		void disableAngleLimitations(bool flush = true);
 		void updateAngle(void);
 
 		void setIncrementalMode(int motionSlot);
@@ -165,6 +186,12 @@ namespace rexos_motor{
 		 **/
 		volatile bool poweredOn;
 
+		/**
+		 * @var uint64_t linkedMotionSlots
+		 * A bit for every motion slot that is linked to the next one in the motor controller, bit n for motion slot n.
+		 **/
+		uint64_t linkedMotionSlots;
+
 		void checkMotionSlot(int motionSlot);
 	};
 }
@@ -31,55 +31,393 @@
 
 #include <rexos_motor/MotorManager.h>
 #include <rexos_motor/CRD514KD.h>
+#include <rexos_motor/CRD514KDException.h>
 #include <rexos_motor/MotorException.h>
+#include <rexos_modbus/ModbusException.h>
+#include <rexos_utilities/Utilities.h>
+#include <algorithm>
+#include <vector>
 
 extern "C"{
 	#include <modbus/modbus.h>
 }
 
 namespace rexos_motor{
+	/**
+	 * Captures the exception that is being handled, so it can be rethrown by the future of a motion. The exceptions of the motor drivers keep their type.
+	 *
+	 * @return The captured exception.
+	 **/
+	static boost::exception_ptr captureException(void){
+		try{
+			throw;
+		} catch(CRD514KDException& exception){
+			return boost::copy_exception(exception);
+		} catch(MotorException& exception){
+			return boost::copy_exception(exception);
+		} catch(rexos_modbus::ModbusException& exception){
+			return boost::copy_exception(exception);
+		} catch(std::runtime_error& exception){
+			return boost::copy_exception(std::runtime_error(exception.what()));
+		} catch(...){
+			return boost::current_exception();
+		}
+	}
+
+	/**
+	 * Sleeps until the monotonic clock reaches a time, so a change of the system time does not stall the I/O thread.
+	 * The thread can be interrupted at least every CRD514KD::MAX_POLL_INTERVAL milliseconds, like the interruptible sleeps of boost.
+	 *
+	 * @param monotonicTime The time in nanoseconds, as returned by rexos_utilities::monotonicTimeNow.
+	 **/
+	static void sleepUntil(int64_t monotonicTime){
+		while(true){
+			boost::this_thread::interruption_point();
+			int64_t now = rexos_utilities::monotonicTimeNow();
+			if(now >= monotonicTime){
+				return;
+			}
+			rexos_utilities::sleepUntil(std::min(monotonicTime, now + (int64_t)CRD514KD::MAX_POLL_INTERVAL * 1000000));
+		}
+	}
+
+	/**
+	 * Constructor for the motor manager. Groups the motors by the bus they are on.
+	 *
+	 * @param motors Pointer array containing all motors for this manager.
+	 * @param numberOfMotors Number of motors in the pointer array.
+	 **/
+	MotorManager::MotorManager(StepperMotor** motors, int numberOfMotors) :
+		motors(motors), numberOfMotors(numberOfMotors), poweredOn(false), runningMovementEnd(0), stopping(false), ioThread(NULL){
+		for(int i = 0; i < numberOfMotors; ++i){
+			unsigned int bus = 0;
+			while(bus < buses.size() && buses[bus].modbus != motors[i]->getModbusController()){
+				++bus;
+			}
+			if(bus == buses.size()){
+				buses.push_back(Bus());
+				buses[bus].modbus = motors[i]->getModbusController();
+			}
+			buses[bus].motors.push_back(i);
+			buses[bus].slaves.push_back(motors[i]->getMotorIndex());
+		}
+	}
+
+	/**
+	 * Stops the I/O thread. Motions that have not been started yet are cancelled.
+	 **/
+	MotorManager::~MotorManager(void){
+		if(ioThread != NULL){
+			{
+				boost::lock_guard<boost::mutex> lock(queueMutex);
+				stopping = true;
+				queueChanged.notify_all();
+			}
+			ioThread->interrupt();
+			ioThread->join();
+			delete ioThread;
+		}
+	}
+
 	/**
 	 * Powers on all motors by doing a broadcast to turn on all excitement for the motors.
+	 * The commands and the configuration the motors share are broadcast, only the configuration that differs per motor is written to each motor.
+	 * The buses are written in parallel.
 	 **/
 	void MotorManager::powerOn(void){
+		boost::lock_guard<boost::mutex> lock(queueMutex);
 		if(!poweredOn){
+			//Reset alarm
+			writeCommand(CRD514KD::Registers::RESET_ALARM, 0, rexos_modbus::ModbusController::PRIORITY_URGENT);
+			writeCommand(CRD514KD::Registers::RESET_ALARM, 1, rexos_modbus::ModbusController::PRIORITY_URGENT);
+			writeCommand(CRD514KD::Registers::RESET_ALARM, 0, rexos_modbus::ModbusController::PRIORITY_URGENT);
+			// The motor controllers may have been restarted since the registers were cached.
+			for(unsigned int i = 0; i < buses.size(); ++i){
+				for(unsigned int j = 0; j < buses[i].slaves.size(); ++j){
+					buses[i].modbus->invalidateCache(buses[i].slaves[j]);
+				}
+			}
+
+			// Set operating modes
+			writeCommand(CRD514KD::Registers::CMD_1, 0);
 			for(int i = 0; i < numberOfMotors; ++i){
-				motors[i]->powerOn();
+				motors[i]->stageConfiguration();
+			}
+			flush();
+
+			// Excite motors
+			writeCommand(CRD514KD::Registers::CMD_1, CRD514KD::CMD1Bits::EXCITEMENT_ON);
+
+			// Clear counters
+			writeCommand(CRD514KD::Registers::CLEAR_COUNTER, 1);
+			writeCommand(CRD514KD::Registers::CLEAR_COUNTER, 0);
+
+			for(int i = 0; i < numberOfMotors; ++i){
+				motors[i]->markPoweredOn();
 			}
 		}
 		poweredOn = true;
 	}
 
 	/**
-	 * Powers off all motors by broadcasting a clear for the excitement.
+	 * Powers off all motors by broadcasting a clear for the excitement. The asynchronous motions are aborted.
 	 **/
 	void MotorManager::powerOff(void){
+		boost::lock_guard<boost::mutex> lock(queueMutex);
+		if(runningMovement.completion){
+			runningMovement.completion->set_exception(boost::copy_exception(MotorException("motors were powered off during the motion")));
+			runningMovement.completion.reset();
+		}
+		cancelMovements("motors were powered off before the motion started");
 		if(poweredOn){
+			// Stop the motors, then turn off the excitement.
+			writeCommand(CRD514KD::Registers::CMD_1, CRD514KD::CMD1Bits::STOP, rexos_modbus::ModbusController::PRIORITY_URGENT);
+			writeCommand(CRD514KD::Registers::CMD_1, CRD514KD::CMD1Bits::EXCITEMENT_ON, rexos_modbus::ModbusController::PRIORITY_URGENT);
+			writeCommand(CRD514KD::Registers::CMD_1, 0);
 			for(int i = 0; i < numberOfMotors; ++i){
-				motors[i]->powerOff();
+				motors[i]->markPoweredOff();
 			}
 		}
 		poweredOn = false;
 	}
 
 	/**
-	 * Start simultaneously movement of all motors
+	 * Writes the registers that have been staged for the motors. A register staged with the same value for every motor on a bus is broadcast once on that bus.
+	 * The motors of the manager have to be all motor controllers on their buses. The writes are queued on all buses before waiting for any of them, like writeCommand does, so the buses are written in parallel.
+	 **/
+	void MotorManager::flush(void){
+		std::vector<std::vector<rexos_modbus::ModbusController::FlushedRun> > runs(buses.size());
+		for(unsigned int i = 0; i < buses.size(); ++i){
+			buses[i].modbus->flushAsync(&buses[i].slaves[0], buses[i].slaves.size(), runs[i]);
+		}
+		for(unsigned int i = 0; i < buses.size(); ++i){
+			buses[i].modbus->finishFlush(runs[i]);
+		}
+		for(unsigned int i = 0; i < runs.size(); ++i){
+			for(unsigned int j = 0; j < runs[i].size(); ++j){
+				runs[i][j].result.get();
+			}
+		}
+	}
+
+	/**
+	 * Writes a command register of all motors. The command is broadcast on a bus with several motors, and written to the motor on a bus with a single motor, which takes less time.
+	 * The command is queued on all buses before waiting for any of them. With several buses, every bus sends it at the same start time, chosen ModbusController::START_TIME_MARGIN after the last of the buses is free, so the motors act on it together.
+	 * What remains is the difference in the wake up of the bus threads, and the latency of the serial adapters or gateways. A bus that is still busy with a transaction of someone else sends the command after it.
+	 *
+	 * @param address The register address.
+	 * @param data The value that will be written.
+	 * @param priority The priority of the transactions.
+	 **/
+	void MotorManager::writeCommand(uint16_t address, uint16_t data, rexos_modbus::ModbusController::Priority priority){
+		int64_t startTime = 0;
+		if(buses.size() > 1){
+			startTime = rexos_utilities::monotonicTimeNow();
+			for(unsigned int i = 0; i < buses.size(); ++i){
+				startTime = std::max(startTime, buses[i].modbus->getNextTransactionTime());
+			}
+			startTime += rexos_modbus::ModbusController::START_TIME_MARGIN;
+		}
+
+		std::vector<rexos_modbus::ModbusController::TransactionResult> results;
+		for(unsigned int i = 0; i < buses.size(); ++i){
+			uint16_t slave = buses[i].slaves.size() == 1 ? buses[i].slaves[0] : (uint16_t)CRD514KD::Slaves::BROADCAST;
+			results.push_back(buses[i].modbus->writeU16Async(slave, address, &data, 1, priority, startTime));
+		}
+		for(unsigned int i = 0; i < results.size(); ++i){
+			results[i].wait();
+		}
+		for(unsigned int i = 0; i < results.size(); ++i){
+			results[i].get();
+		}
+	}
+
+	/**
+	 * Start simultaneously movement of all motors. Waits for the asynchronous motions to finish first.
 	 **/
 	void MotorManager::startMovement(int motionSlot){
+		boost::unique_lock<boost::mutex> lock(queueMutex);
+		waitTillIdle(lock);
 		if(!poweredOn){
 			throw MotorException("motor manager is not powered on");
 		}
 
 		// Execute motion.
-		motors[0]->waitTillReady();
-		motors[1]->waitTillReady();
-		motors[2]->waitTillReady();
+		for(int i = 0; i < numberOfMotors; ++i){
+			motors[i]->waitTillReady();
+		}
+
+		writeCommand(CRD514KD::Registers::CMD_1, motionSlot | CRD514KD::CMD1Bits::EXCITEMENT_ON | CRD514KD::CMD1Bits::START, rexos_modbus::ModbusController::PRIORITY_MOTION);
+		writeCommand(CRD514KD::Registers::CMD_1, CRD514KD::CMD1Bits::EXCITEMENT_ON, rexos_modbus::ModbusController::PRIORITY_MOTION);
+
+		for(int i = 0; i < numberOfMotors; ++i){
+			motors[i]->updateAngle();
+		}
+	}
+
+	/**
+	 * Queues a simultaneous movement of all motors and returns without waiting for the motors.
+	 * The I/O thread starts the motion as soon as the motions queued before it have finished, so the caller can plan and write the next motion meanwhile.
+	 * The rotation data in the motion slot must not be overwritten before the motion has finished.
+	 *
+	 * @param motionSlot The motion slot that holds the rotation data of the motion.
+	 * @param expectedDuration The time in seconds the motion is expected to take. The motors are not polled before it has passed.
+	 *
+	 * @return A future that becomes ready when the motors have finished the motion. It holds the exception if the motion failed or was cancelled.
+	 **/
+	boost::shared_future<void> MotorManager::startMovementAsync(int motionSlot, double expectedDuration){
+		boost::lock_guard<boost::mutex> lock(queueMutex);
+		if(!poweredOn){
+			throw MotorException("motor manager is not powered on");
+		}
+
+		QueuedMovement movement;
+		movement.motionSlot = motionSlot;
+		movement.expectedDuration = (int64_t)(std::max(expectedDuration, 0.0) * 1000000000);
+		movement.completion.reset(new boost::promise<void>());
+		boost::shared_future<void> completion(movement.completion->get_future());
+
+		// Following motions are planned from the angles this motion ends at.
+		for(int i = 0; i < numberOfMotors; ++i){
+			motors[i]->updateAngle();
+		}
+
+		queuedMovements.push_back(movement);
+		if(ioThread == NULL){
+			ioThread = new boost::thread(boost::bind(&MotorManager::runMovements, this));
+		}
+		queueChanged.notify_all();
+		return completion;
+	}
+
+	/**
+	 * Body of the I/O thread. Waits for the running motion to finish, then starts the next queued motion.
+	 **/
+	void MotorManager::runMovements(void){
+		boost::unique_lock<boost::mutex> lock(queueMutex);
+		while(!stopping){
+			if(!runningMovement.completion && queuedMovements.empty()){
+				queueChanged.wait(lock);
+				continue;
+			}
+
+			// The motors are polled without holding the lock, so motions can be queued meanwhile.
+			int64_t expectedEnd = runningMovementEnd;
+			lock.unlock();
+			try{
+				waitTillMotorsReady(expectedEnd);
+			} catch(boost::thread_interrupted&){
+				lock.lock();
+				break;
+			} catch(...){
+				boost::exception_ptr exception = captureException();
+				lock.lock();
+				if(runningMovement.completion){
+					runningMovement.completion->set_exception(exception);
+					runningMovement.completion.reset();
+				}
+				for(std::deque<QueuedMovement>::iterator it = queuedMovements.begin(); it != queuedMovements.end(); ++it){
+					it->completion->set_exception(exception);
+				}
+				queuedMovements.clear();
+				queueChanged.notify_all();
+				continue;
+			}
+			lock.lock();
+
+			if(runningMovement.completion){
+				runningMovement.completion->set_value();
+				runningMovement.completion.reset();
+			}
 
-		modbus->writeU16(CRD514KD::Slaves::BROADCAST, CRD514KD::Registers::CMD_1, motionSlot | CRD514KD::CMD1Bits::EXCITEMENT_ON | CRD514KD::CMD1Bits::START);
-		modbus->writeU16(CRD514KD::Slaves::BROADCAST, CRD514KD::Registers::CMD_1, CRD514KD::CMD1Bits::EXCITEMENT_ON);
+			if(!queuedMovements.empty()){
+				QueuedMovement movement = queuedMovements.front();
+				queuedMovements.pop_front();
+				try{
+					// powerOff holds the lock as well, so the motors cannot be powered off in between.
+					if(!poweredOn){
+						throw MotorException("motor manager is not powered on");
+					}
+					writeCommand(CRD514KD::Registers::CMD_1, movement.motionSlot | CRD514KD::CMD1Bits::EXCITEMENT_ON | CRD514KD::CMD1Bits::START, rexos_modbus::ModbusController::PRIORITY_MOTION);
+					writeCommand(CRD514KD::Registers::CMD_1, CRD514KD::CMD1Bits::EXCITEMENT_ON, rexos_modbus::ModbusController::PRIORITY_MOTION);
+					runningMovement = movement;
+					runningMovementEnd = rexos_utilities::monotonicTimeNow() + movement.expectedDuration;
+				} catch(...){
+					movement.completion->set_exception(captureException());
+				}
+			}
+			queueChanged.notify_all();
+		}
+
+		if(runningMovement.completion){
+			runningMovement.completion->set_exception(boost::copy_exception(MotorException("motor manager stopped before the motion finished")));
+			runningMovement.completion.reset();
+		}
+		cancelMovements("motor manager stopped before the motion started");
+	}
+
+	/**
+	 * Sleeps until the expected end of a motion, then polls the motors until all of them are ready.
+	 * The interval between the polls grows from CRD514KD::MIN_POLL_INTERVAL to CRD514KD::MAX_POLL_INTERVAL while the motors keep moving.
+	 * Every bus polls the first of its motors that is not ready yet, the buses are polled in parallel.
+	 *
+	 * @param expectedEnd The time, on the monotonic clock in nanoseconds, the motion is expected to end.
+	 **/
+	void MotorManager::waitTillMotorsReady(int64_t expectedEnd){
+		sleepUntil(expectedEnd);
+
+		std::vector<unsigned int> readyMotors(buses.size(), 0);
+		int pollInterval = CRD514KD::MIN_POLL_INTERVAL;
+		while(true){
+			std::vector<unsigned int> polledBuses;
+			std::vector<rexos_modbus::ModbusController::TransactionResult> results;
+			for(unsigned int i = 0; i < buses.size(); ++i){
+				if(readyMotors[i] < buses[i].motors.size()){
+					polledBuses.push_back(i);
+					results.push_back(buses[i].modbus->readU16Async(buses[i].slaves[readyMotors[i]], CRD514KD::Registers::STATUS_1, 1, rexos_modbus::ModbusController::PRIORITY_POLL));
+				}
+			}
+			if(polledBuses.empty()){
+				return;
+			}
+
+			bool progress = false;
+			for(unsigned int i = 0; i < polledBuses.size(); ++i){
+				Bus& bus = buses[polledBuses[i]];
+				if(motors[bus.motors[readyMotors[polledBuses[i]]]]->isReady(results[i].get()[0])){
+					++readyMotors[polledBuses[i]];
+					progress = true;
+				}
+			}
 
-		motors[0]->updateAngle();
-		motors[1]->updateAngle();
-		motors[2]->updateAngle();
+			if(!progress){
+				sleepUntil(rexos_utilities::monotonicTimeNow() + (int64_t)pollInterval * 1000000);
+				pollInterval = std::min(pollInterval * 2, CRD514KD::MAX_POLL_INTERVAL);
+			}
+		}
+	}
+
+	/**
+	 * Breaks the futures of all motions that have not been started yet. The queue mutex must be held.
+	 *
+	 * @param reason The message of the exception the futures will throw.
+	 **/
+	void MotorManager::cancelMovements(const std::string& reason){
+		for(std::deque<QueuedMovement>::iterator it = queuedMovements.begin(); it != queuedMovements.end(); ++it){
+			it->completion->set_exception(boost::copy_exception(MotorException(reason)));
+		}
+		queuedMovements.clear();
+		queueChanged.notify_all();
+	}
+
+	/**
+	 * Blocks until the I/O thread has no queued or running motions.
+	 *
+	 * @param lock A lock on the queue mutex.
+	 **/
+	void MotorManager::waitTillIdle(boost::unique_lock<boost::mutex>& lock){
+		while(runningMovement.completion || !queuedMovements.empty()){
+			queueChanged.wait(lock);
+		}
 	}
 }
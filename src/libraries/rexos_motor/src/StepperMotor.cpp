@@ -31,6 +31,7 @@
 
 #include <rexos_motor/StepperMotor.h>
 
+#include <algorithm>
 #include <cstdio>
 #include <cmath>
 #include <cstdlib>
@@ -43,7 +44,8 @@
 
 namespace rexos_motor {
 	/**
-	 * Constructor of StepperMotor. Sets angles to unlimited.
+	 * Constructor of StepperMotor. Sets angles to unlimited. Allocates the registers of the motor controller in the modbus controller.
+	 * Sets the cache policies of the registers: the configuration only changes when it is written, the status is shared by the polls of a poll interval.
 	 *
 	 * @param modbusController Controller for the modbus communication.
 	 * @param motorIndex Index of the motor from 0 to N dependant on the amount of motors.
@@ -51,7 +53,26 @@ namespace rexos_motor {
 	 * @param maxAngle Maximum for the angle, in radians, the StepperMotor can travel on the theoretical plane.
 	 **/
 	StepperMotor::StepperMotor(rexos_modbus::ModbusController* modbusController, CRD514KD::Slaves::t motorIndex, double minAngle, double maxAngle):
-		MotorInterface(), currentAngle(0), setAngle(0), deviation(0), minAngle(minAngle), maxAngle(maxAngle), modbus(modbusController), motorIndex(motorIndex), anglesLimited(true), poweredOn(false){}
+		MotorInterface(), currentAngle(0), setAngle(0), deviation(0), minAngle(minAngle), maxAngle(maxAngle), modbus(modbusController), motorIndex(motorIndex), anglesLimited(true), poweredOn(false), linkedMotionSlots(0){
+		using rexos_modbus::ModbusController;
+		modbus->reserveRegisters(motorIndex, CRD514KD::NUMBER_OF_REGISTERS);
+
+		const int slotTableLength = CRD514KD::MOTION_SLOTS_USED * 2;
+		modbus->setCachePolicy(CRD514KD::Registers::OP_POS, slotTableLength, ModbusController::CACHE_STATIC);
+		modbus->setCachePolicy(CRD514KD::Registers::OP_SPEED, slotTableLength, ModbusController::CACHE_STATIC);
+		modbus->setCachePolicy(CRD514KD::Registers::OP_ACC, slotTableLength, ModbusController::CACHE_STATIC);
+		modbus->setCachePolicy(CRD514KD::Registers::OP_DEC, slotTableLength, ModbusController::CACHE_STATIC);
+		modbus->setCachePolicy(CRD514KD::Registers::OP_POSMODE, CRD514KD::MOTION_SLOTS_USED, ModbusController::CACHE_STATIC);
+		modbus->setCachePolicy(CRD514KD::Registers::OP_OPMODE, CRD514KD::MOTION_SLOTS_USED, ModbusController::CACHE_STATIC);
+		modbus->setCachePolicy(CRD514KD::Registers::OP_SEQ_MODE, CRD514KD::MOTION_SLOTS_USED, ModbusController::CACHE_STATIC);
+		modbus->setCachePolicy(CRD514KD::Registers::CFG_POSLIMIT_POSITIVE, 2, ModbusController::CACHE_STATIC);
+		modbus->setCachePolicy(CRD514KD::Registers::CFG_POSLIMIT_NEGATIVE, 2, ModbusController::CACHE_STATIC);
+		modbus->setCachePolicy(CRD514KD::Registers::CFG_START_SPEED, 2, ModbusController::CACHE_STATIC);
+		modbus->setCachePolicy(CRD514KD::Registers::OP_SOFTWARE_OVERTRAVEL, 1, ModbusController::CACHE_STATIC);
+
+		modbus->setCachePolicy(CRD514KD::Registers::STATUS_1, 1, ModbusController::CACHE_TIME_TO_LIVE, CRD514KD::MIN_POLL_INTERVAL);
+		modbus->setCachePolicy(CRD514KD::Registers::PRESENT_ALARM, 1, ModbusController::CACHE_TIME_TO_LIVE, CRD514KD::MIN_POLL_INTERVAL);
+	}
 
 	/**
 	 * Deconstructor of StepperMotor. Tries to turn to power off.
@@ -68,35 +89,60 @@ namespace rexos_motor {
 	void StepperMotor::powerOn(void){
 		if(!poweredOn){
 			//Reset alarm
-			modbus->writeU16(motorIndex, CRD514KD::Registers::RESET_ALARM, 0);
-			modbus->writeU16(motorIndex, CRD514KD::Registers::RESET_ALARM, 1);
-			modbus->writeU16(motorIndex, CRD514KD::Registers::RESET_ALARM, 0);
+			modbus->writeU16(motorIndex, CRD514KD::Registers::RESET_ALARM, 0, false, rexos_modbus::ModbusController::PRIORITY_URGENT);
+			modbus->writeU16(motorIndex, CRD514KD::Registers::RESET_ALARM, 1, false, rexos_modbus::ModbusController::PRIORITY_URGENT);
+			modbus->writeU16(motorIndex, CRD514KD::Registers::RESET_ALARM, 0, false, rexos_modbus::ModbusController::PRIORITY_URGENT);
+			// The motor controller may have been restarted since the registers were cached.
+			modbus->invalidateCache(motorIndex);
 
 			// Set operating modes
 			modbus->writeU16(motorIndex, CRD514KD::Registers::CMD_1, 0);
-
-			// set modes for all used motion slots
-			for(int i = 0; i < CRD514KD::MOTION_SLOTS_USED; i++){
-				modbus->writeU16(motorIndex, CRD514KD::Registers::OP_POSMODE + i, 1);
-				modbus->writeU16(motorIndex, CRD514KD::Registers::OP_OPMODE + i, 0);
-				modbus->writeU16(motorIndex, CRD514KD::Registers::OP_SEQ_MODE + i, 1);
-			}
+			stageConfiguration();
+			modbus->flush(motorIndex);
 
 			// Excite motor
 			modbus->writeU16(motorIndex, CRD514KD::Registers::CMD_1, CRD514KD::CMD1Bits::EXCITEMENT_ON);
-			
-			// Set motor limits
-			modbus->writeU32(motorIndex, CRD514KD::Registers::CFG_POSLIMIT_POSITIVE, (uint32_t)((maxAngle - deviation) / CRD514KD::MOTOR_STEP_ANGLE));
-			modbus->writeU32(motorIndex, CRD514KD::Registers::CFG_POSLIMIT_NEGATIVE, (uint32_t)((minAngle - deviation) / CRD514KD::MOTOR_STEP_ANGLE));
-			modbus->writeU32(motorIndex, CRD514KD::Registers::CFG_START_SPEED, 1);
-			
+
 			// Clear counter
 			modbus->writeU16(motorIndex, CRD514KD::Registers::CLEAR_COUNTER, 1);
 			modbus->writeU16(motorIndex, CRD514KD::Registers::CLEAR_COUNTER, 0);
 
-			currentAngle = 0;
-			poweredOn = true;
+			markPoweredOn();
+		}
+	}
+
+	/**
+	 * Stages the configuration written at power on: the modes of the used motion slots, the motor limits and the start speed.
+	 * The registers are written by the next flush of the modbus controller.
+	 **/
+	void StepperMotor::stageConfiguration(void){
+		// set modes for all used motion slots, the slots of a mode are adjacent and written at once.
+		for(int i = 0; i < CRD514KD::MOTION_SLOTS_USED; i++){
+			modbus->stageU16(motorIndex, CRD514KD::Registers::OP_POSMODE + i, 1);
+			modbus->stageU16(motorIndex, CRD514KD::Registers::OP_OPMODE + i, 0);
+			modbus->stageU16(motorIndex, CRD514KD::Registers::OP_SEQ_MODE + i, 1);
 		}
+
+		// Set motor limits
+		modbus->stageU32(motorIndex, CRD514KD::Registers::CFG_POSLIMIT_POSITIVE, (uint32_t)((maxAngle - deviation) / CRD514KD::MOTOR_STEP_ANGLE));
+		modbus->stageU32(motorIndex, CRD514KD::Registers::CFG_POSLIMIT_NEGATIVE, (uint32_t)((minAngle - deviation) / CRD514KD::MOTOR_STEP_ANGLE));
+		modbus->stageU32(motorIndex, CRD514KD::Registers::CFG_START_SPEED, 1);
+	}
+
+	/**
+	 * Records that the motor controller has been configured and excited, when this was done for all motors at once by the MotorManager.
+	 **/
+	void StepperMotor::markPoweredOn(void){
+		currentAngle = 0;
+		linkedMotionSlots = 0;
+		poweredOn = true;
+	}
+
+	/**
+	 * Records that the excitement of the motor controller has been turned off, when this was done for all motors at once by the MotorManager.
+	 **/
+	void StepperMotor::markPoweredOff(void){
+		poweredOn = false;
 	}
 
 	/**
@@ -121,8 +167,8 @@ namespace rexos_motor {
 		}
 		
 		try{
-			modbus->writeU16(motorIndex, CRD514KD::Registers::CMD_1, CRD514KD::CMD1Bits::STOP);
-			modbus->writeU16(motorIndex, CRD514KD::Registers::CMD_1, CRD514KD::CMD1Bits::EXCITEMENT_ON);
+			modbus->writeU16(motorIndex, CRD514KD::Registers::CMD_1, CRD514KD::CMD1Bits::STOP, false, rexos_modbus::ModbusController::PRIORITY_URGENT);
+			modbus->writeU16(motorIndex, CRD514KD::Registers::CMD_1, CRD514KD::CMD1Bits::EXCITEMENT_ON, false, rexos_modbus::ModbusController::PRIORITY_URGENT);
 		} catch(rexos_modbus::ModbusException& exception){
 			std::cerr << "steppermotor::stop failed: " << std::endl << "what(): " << exception.what() << std::endl;
 		}
@@ -171,8 +217,9 @@ namespace rexos_motor {
 	 * @param motorRotation A MotorRotation.
 	 * @param motionSlot the motion slot to be written to
 	 * @param useDeviation Sets whether or not to use the deviation. Defaults to true.
+	 * @param flush Whether the registers are written at once. If false, they are written by the next flush of the modbus controller.
 	 **/
-	void StepperMotor::writeRotationData(const rexos_datatypes::MotorRotation& motorRotation, int motionSlot, bool useDeviation){
+	void StepperMotor::writeRotationData(const rexos_datatypes::MotorRotation& motorRotation, int motionSlot, bool useDeviation, bool flush){
 		if(!poweredOn){
 			throw MotorException("motor drivers are not powered on");
 		}
@@ -206,13 +253,40 @@ namespace rexos_motor {
 		// offset for the motion slot, * 2 for 32 bit registers.
 		int motionSlotOffset = (motionSlot - 1) * 2;
 
-		modbus->writeU32(motorIndex, CRD514KD::Registers::OP_SPEED + motionSlotOffset, motorSpeed, true);
-		modbus->writeU32(motorIndex, CRD514KD::Registers::OP_POS + motionSlotOffset, motorSteps, true);
-		modbus->writeU32(motorIndex, CRD514KD::Registers::OP_ACC + motionSlotOffset, motorAcceleration, true);
-		modbus->writeU32(motorIndex, CRD514KD::Registers::OP_DEC + motionSlotOffset, motorDeceleration, true);
+		// Each parameter has its own table in the register map, so every changed parameter takes a transaction.
+		// Only the words that differ from the shadow registers are written.
+		modbus->stageU32(motorIndex, CRD514KD::Registers::OP_SPEED + motionSlotOffset, motorSpeed, true);
+		modbus->stageU32(motorIndex, CRD514KD::Registers::OP_POS + motionSlotOffset, motorSteps, true);
+		modbus->stageU32(motorIndex, CRD514KD::Registers::OP_ACC + motionSlotOffset, motorAcceleration, true);
+		modbus->stageU32(motorIndex, CRD514KD::Registers::OP_DEC + motionSlotOffset, motorDeceleration, true);
+		if(flush){
+			modbus->flush(motorIndex);
+		}
 		setAngle = motorRotation.angle;
 	}
 
+	/**
+	 * Sets whether the motor controller continues with the next motion slot after a motion slot, without stopping.
+	 * The CRD514KD runs up to CRD514KD::LINKED_MOTIONS_MAX linked motion slots, which all have to move in the same direction. The acceleration and deceleration of the first slot are used for all of them.
+	 *
+	 * @param motionSlot The motion slot to be set.
+	 * @param linked true to link the motion slot to the next one, false to stop at the end of it.
+	 * @param flush Whether the register is written at once. If false, it is written by the next flush of the modbus controller.
+	 **/
+	void StepperMotor::setLinkedMotion(int motionSlot, bool linked, bool flush){
+		checkMotionSlot(motionSlot);
+		// The configuration written at power on unlinks all motion slots, the register is only written when it changes.
+		uint64_t slotBit = (uint64_t)1 << motionSlot;
+		if(((linkedMotionSlots & slotBit) != 0) == linked){
+			return;
+		}
+		modbus->stageU16(motorIndex, CRD514KD::Registers::OP_OPMODE + motionSlot - 1, linked ? 1 : 0);
+		linkedMotionSlots ^= slotBit;
+		if(flush){
+			modbus->flush(motorIndex);
+		}
+	}
+
 	/**
 	 * Start the motor to move according to the set registers. Will wait for the motor to be ready before moving.
 	 **/
@@ -225,49 +299,105 @@ namespace rexos_motor {
 		// Execute motion.
 		waitTillReady();
 
-		modbus->writeU16(motorIndex, CRD514KD::Registers::CMD_1, motionSlot | CRD514KD::CMD1Bits::EXCITEMENT_ON | CRD514KD::CMD1Bits::START);
-		modbus->writeU16(motorIndex, CRD514KD::Registers::CMD_1, CRD514KD::CMD1Bits::EXCITEMENT_ON);
+		modbus->writeU16(motorIndex, CRD514KD::Registers::CMD_1, motionSlot | CRD514KD::CMD1Bits::EXCITEMENT_ON | CRD514KD::CMD1Bits::START, false, rexos_modbus::ModbusController::PRIORITY_MOTION);
+		modbus->writeU16(motorIndex, CRD514KD::Registers::CMD_1, CRD514KD::CMD1Bits::EXCITEMENT_ON, false, rexos_modbus::ModbusController::PRIORITY_MOTION);
 		updateAngle();
 	}
 
 	/**
 	 * Wait till the motor indicates that the end location is reached.
+	 * The interval between the polls grows from CRD514KD::MIN_POLL_INTERVAL to CRD514KD::MAX_POLL_INTERVAL while the motor keeps moving, like in MotorManager::waitTillMotorsReady. STATUS_1 is cached for CRD514KD::MIN_POLL_INTERVAL, so it is never read more often than that.
 	 **/
 	void StepperMotor::waitTillReady(void){
-		uint16_t status_1;
-		while(!((status_1 = modbus->readU16(motorIndex, CRD514KD::Registers::STATUS_1)) & CRD514KD::Status1Bits::READY)){
-			if((status_1 & CRD514KD::Status1Bits::ALARM) || (status_1 & CRD514KD::Status1Bits::WARNING)){
-				std::cerr << "Motor: " << motorIndex << " Alarm code: " << std::hex << modbus->readU16(motorIndex, CRD514KD::Registers::PRESENT_ALARM) << "h" << std::endl;
+		int pollInterval = CRD514KD::MIN_POLL_INTERVAL;
+		while(!isReady()){
+			rexos_utilities::sleep(pollInterval);
+			pollInterval = std::min(pollInterval * 2, CRD514KD::MAX_POLL_INTERVAL);
+		}
+	}
+
+	/**
+	 * Reads the status of the motor controller once.
+	 *
+	 * @return true if the motor has reached its end location and accepts a new motion, false if it is still moving.
+	 **/
+	bool StepperMotor::isReady(void){
+		return isReady(modbus->readU16(motorIndex, CRD514KD::Registers::STATUS_1, rexos_modbus::ModbusController::PRIORITY_POLL));
+	}
+
+	/**
+	 * Checks a status of the motor controller that was read by the caller, for instance by a read of the status registers of several motors at once.
+	 *
+	 * @param status_1 The value of the STATUS_1 register.
+	 *
+	 * @return true if the motor has reached its end location and accepts a new motion, false if it is still moving.
+	 **/
+	bool StepperMotor::isReady(uint16_t status_1){
+		if(status_1 & CRD514KD::Status1Bits::READY){
+			return true;
+		}
+		if((status_1 & CRD514KD::Status1Bits::ALARM) || (status_1 & CRD514KD::Status1Bits::WARNING)){
+			std::cerr << "Motor: " << motorIndex << " Alarm code: " << std::hex << modbus->readU16(motorIndex, CRD514KD::Registers::PRESENT_ALARM, rexos_modbus::ModbusController::PRIORITY_URGENT) << "h" << std::endl;
 
-				throw CRD514KDException(motorIndex, status_1 & CRD514KD::Status1Bits::WARNING, status_1 & CRD514KD::Status1Bits::ALARM);
-			}
+			throw CRD514KDException(motorIndex, status_1 & CRD514KD::Status1Bits::WARNING, status_1 & CRD514KD::Status1Bits::ALARM);
 		}
+		return false;
 	}
 
 	/**
 	 * Sets the deviation between the motors 0 degrees and the horizontal 0 degrees, then writes the new motor limits to the motor controllers.
 	 *
 	 * @param deviation The deviation between the hardware and theoretical 0 degrees.
+	 * @param flush If false is passed, the limits are only staged and written by the next flush of the modbus controller.
 	 **/
-	void StepperMotor::setDeviationAndWriteMotorLimits(double deviation){
+	void StepperMotor::setDeviationAndWriteMotorLimits(double deviation, bool flush){
 		this->deviation = deviation;
-		modbus->writeU32(motorIndex, CRD514KD::Registers::CFG_POSLIMIT_NEGATIVE, (uint32_t)((minAngle + deviation) / CRD514KD::MOTOR_STEP_ANGLE));
-		modbus->writeU32(motorIndex, CRD514KD::Registers::CFG_POSLIMIT_POSITIVE, (uint32_t)((maxAngle + deviation) / CRD514KD::MOTOR_STEP_ANGLE));
+		// The limits are adjacent and written in a single transaction.
+		modbus->stageU32(motorIndex, CRD514KD::Registers::CFG_POSLIMIT_NEGATIVE, (uint32_t)((minAngle + deviation) / CRD514KD::MOTOR_STEP_ANGLE));
+		modbus->stageU32(motorIndex, CRD514KD::Registers::CFG_POSLIMIT_POSITIVE, (uint32_t)((maxAngle + deviation) / CRD514KD::MOTOR_STEP_ANGLE));
+		if(flush){
+			modbus->flush(motorIndex);
+		}
+	}
+
+	/**
+	 * Sets the minimum and maximum angle the motor can travel on the theoretical plane, then writes the new motor limits to the motor controllers.
+	 *
+	 * @param minAngle Minimum for the angle, in radians, the StepperMotor can travel on the theoretical plane.
+	 * @param maxAngle Maximum for the angle, in radians, the StepperMotor can travel on the theoretical plane.
+	 **/
+	void StepperMotor::setAngleLimitsAndWriteMotorLimits(double minAngle, double maxAngle){
+		if(minAngle >= maxAngle){
+			throw std::out_of_range("minAngle has to be smaller than maxAngle");
+		}
+		this->minAngle = minAngle;
+		this->maxAngle = maxAngle;
+		setDeviationAndWriteMotorLimits(deviation);
 	}
 
 	/**
 	 * Disables the limitations on the angles the motor can travel to in the motor hardware.
+	 *
+	 * @param flush If false is passed, the setting is only staged and written by the next flush of the modbus controller.
 	 **/
-	void StepperMotor::disableAngleLimitations(void){
-		modbus->writeU16(motorIndex, CRD514KD::Registers::OP_SOFTWARE_OVERTRAVEL, 0);
+	void StepperMotor::disableAngleLimitations(bool flush){
+		modbus->stageU16(motorIndex, CRD514KD::Registers::OP_SOFTWARE_OVERTRAVEL, 0);
+		if(flush){
+			modbus->flush(motorIndex);
+		}
 		anglesLimited = false;
 	}
 
 	/**
 	 * Enables the limitations on the angles the motor can travel to in the motor hardware.
+	 *
+	 * @param flush If false is passed, the setting is only staged and written by the next flush of the modbus controller.
 	 **/
-	void StepperMotor::enableAngleLimitations(void){
-		modbus->writeU16(motorIndex, CRD514KD::Registers::OP_SOFTWARE_OVERTRAVEL, 1);
+	void StepperMotor::enableAngleLimitations(bool flush){
+		modbus->stageU16(motorIndex, CRD514KD::Registers::OP_SOFTWARE_OVERTRAVEL, 1);
+		if(flush){
+			modbus->flush(motorIndex);
+		}
 		anglesLimited = true;	
 	}
 
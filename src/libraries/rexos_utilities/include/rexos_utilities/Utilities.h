@@ -36,10 +36,13 @@
 #include <algorithm>
 #include <vector>
 #include <sstream>
+#include <stdint.h>
 
 namespace rexos_utilities{
     long timeNow(void);
     void sleep(long milliseconds);
+    int64_t monotonicTimeNow(void);
+    void sleepUntil(int64_t monotonicTime);
     double radiansToDegrees(double radians);
     double degreesToRadians(double degrees);
     int stringToInt(int &i, char const *s, int base = 0);
@@ -82,12 +85,12 @@ namespace rexos_utilities{
 		/**
 		 * Start method of the stopwatch, sets the starting time to the current time.
 		 **/
-		void start(void){ timeOfStart = timeNow(); }
+		void start(void){ timeOfStart = (long)(monotonicTimeNow() / 1000000); }
 
 		/**
 		 * Stop method of the stopwatch, sets the stop time to the current time.
 		 **/
-		void stop(void){ timeOfStop = timeNow(); }
+		void stop(void){ timeOfStop = (long)(monotonicTimeNow() / 1000000); }
 		
 		/**
 		 * Prints name of the stopwatch and the time elapsed between start and stop time to the stream.
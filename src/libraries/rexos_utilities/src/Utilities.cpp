@@ -29,6 +29,8 @@
  **/
 
 #include <rexos_utilities/Utilities.h>
+#include <cerrno>
+#include <time.h>
 
 namespace rexos_utilities{
     /**
@@ -51,6 +53,29 @@ namespace rexos_utilities{
         boost::this_thread::sleep(boost::posix_time::milliseconds(milliseconds));
     }
 
+    /**
+     * Get the current time of the monotonic clock, which is not affected by changes of the system time.
+     *
+     * @return time in nanoseconds since an unspecified starting point.
+     **/
+    int64_t monotonicTimeNow(void){
+        struct timespec time;
+        clock_gettime(CLOCK_MONOTONIC, &time);
+        return (int64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+    }
+
+    /**
+     * Sleep the current thread until the monotonic clock reaches a specific time. Returns immediately if that time has passed.
+     *
+     * @param monotonicTime time in nanoseconds, as returned by monotonicTimeNow.
+     **/
+    void sleepUntil(int64_t monotonicTime){
+        struct timespec time;
+        time.tv_sec = monotonicTime / 1000000000;
+        time.tv_nsec = monotonicTime % 1000000000;
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time, NULL) == EINTR){}
+    }
+
     /**
      * Converts radians to degrees.
      *
@@ -36,6 +36,7 @@
 
 #include <rexos_datatypes/Point3D.h>
 #include <rexos_delta_robot/DeltaRobot.h>
+#include <rexos_modbus/BusManager.h>
 #include <rexos_motor/StepperMotor.h>
 #include <delta_robot_node/Services.h>
 #include <delta_robot_node/Point.h>
@@ -102,15 +103,20 @@ namespace deltaRobotNodeNamespace{
 		rexos_motor::StepperMotor* motors[3];
 		/**
 		 *
-		 * @var ModbusController::ModbusController* modbus
-		 * the modbuscontroller
+		 * @var rexos_modbus::BusManager* busManager
+		 * Owns the modbus controllers of the buses the motors are on.
 		 **/
-		rexos_modbus::ModbusController* modbus;
+		rexos_modbus::BusManager* busManager;
 		/**
 		 * @var Motor::MotorManager* motorManager
 		 * The motor manager
 		 **/
 		rexos_motor::MotorManager* motorManager;
+		/**
+		 * @var rexos_delta_robot::TrajectoryPlanner trajectoryPlanner
+		 * The planner that skips the waypoints of the paths that lie on a straight motion
+		 **/
+		rexos_delta_robot::TrajectoryPlanner trajectoryPlanner;
 		/**
 		 * @var ros::ServiceServer moveToPointService_old
 		 * Service for receiving move to point commands
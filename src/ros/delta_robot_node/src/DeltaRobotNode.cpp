@@ -33,6 +33,10 @@
 #include "delta_robot_node/Point.h"
 #include <execinfo.h>
 #include <signal.h>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
 
 // @cond HIDE_NODE_NAME_FROM_DOXYGEN
 #define NODE_NAME "DeltaRobotNode"
@@ -54,8 +58,9 @@
 deltaRobotNodeNamespace::DeltaRobotNode::DeltaRobotNode(int equipletID, int moduleID) : 
 	rexos_mast::StateMachine(equipletID, moduleID),
 	deltaRobot(NULL),
-	modbus(NULL),
+	busManager(NULL),
 	motorManager(NULL),
+	trajectoryPlanner(),
 	moveToPointService_old(),
 	movePathService_old(),
 	moveToRelativePointService_old(),
@@ -103,19 +108,26 @@ deltaRobotNodeNamespace::DeltaRobotNode::DeltaRobotNode(int equipletID, int modu
 	drm.ankle = rexos_delta_robot::Measures::ANKLE;
 	drm.maxAngleHipAnkle = rexos_delta_robot::Measures::HIP_ANKLE_ANGLE_MAX;
 
-	modbus = new rexos_modbus::ModbusController(modbus_new_rtu(
-		"/dev/ttyS0",
-		rexos_motor::CRD514KD::RtuConfig::BAUDRATE,
-		rexos_motor::CRD514KD::RtuConfig::PARITY,
-		rexos_motor::CRD514KD::RtuConfig::DATA_BITS,
-		rexos_motor::CRD514KD::RtuConfig::STOP_BITS));
-
-	// Motors is declared in the header file, size = 3
-	motors[0] = new rexos_motor::StepperMotor(modbus, rexos_motor::CRD514KD::Slaves::MOTOR_0, rexos_delta_robot::Measures::MOTOR_ROT_MIN, rexos_delta_robot::Measures::MOTOR_ROT_MAX);
-	motors[1] = new rexos_motor::StepperMotor(modbus, rexos_motor::CRD514KD::Slaves::MOTOR_1, rexos_delta_robot::Measures::MOTOR_ROT_MIN, rexos_delta_robot::Measures::MOTOR_ROT_MAX);
-	motors[2] = new rexos_motor::StepperMotor(modbus, rexos_motor::CRD514KD::Slaves::MOTOR_2, rexos_delta_robot::Measures::MOTOR_ROT_MIN, rexos_delta_robot::Measures::MOTOR_ROT_MAX);
+	// Every motor can be on its own bus, a serial port ("rtu:/dev/ttyS1") or a Modbus TCP gateway ("tcp:192.168.0.3:502"). Motors on different buses are driven in parallel.
+	busManager = new rexos_modbus::BusManager();
+	const rexos_motor::CRD514KD::Slaves::t slaves[3] = {rexos_motor::CRD514KD::Slaves::MOTOR_0, rexos_motor::CRD514KD::Slaves::MOTOR_1, rexos_motor::CRD514KD::Slaves::MOTOR_2};
+	for(int i = 0; i < 3; i++){
+		std::stringstream parameter;
+		parameter << "motor_" << i << "_bus";
+		std::string busAddress;
+		ros::NodeHandle("~").param<std::string>(parameter.str(), busAddress, std::string("rtu:") + rexos_motor::CRD514KD::RtuConfig::DEVICE);
+
+		rexos_modbus::ModbusController* modbus = busManager->getBus(busAddress,
+			rexos_motor::CRD514KD::RtuConfig::BAUDRATE,
+			rexos_motor::CRD514KD::RtuConfig::PARITY,
+			rexos_motor::CRD514KD::RtuConfig::DATA_BITS,
+			rexos_motor::CRD514KD::RtuConfig::STOP_BITS);
+		// Motors is declared in the header file, size = 3
+		motors[i] = new rexos_motor::StepperMotor(modbus, slaves[i], rexos_delta_robot::Measures::MOTOR_ROT_MIN, rexos_delta_robot::Measures::MOTOR_ROT_MAX);
+	}
+	ROS_INFO("Motors on %u modbus bus(es)", busManager->getNumberOfBuses());
 
-	motorManager = new rexos_motor::MotorManager(modbus, motors, 3);
+	motorManager = new rexos_motor::MotorManager(motors, 3);
 
 	// Create a deltarobot
 	deltaRobot = new rexos_delta_robot::DeltaRobot(drm, motorManager, motors, modbusIO);
@@ -123,11 +135,12 @@ deltaRobotNodeNamespace::DeltaRobotNode::DeltaRobotNode(int equipletID, int modu
 
 deltaRobotNodeNamespace::DeltaRobotNode::~DeltaRobotNode(){
 	delete deltaRobot;
+	// The motor manager's I/O thread uses the motors and the modbus connection until it is stopped.
+	delete motorManager;
 	delete motors[0];
 	delete motors[1];
 	delete motors[2];
-	delete modbus;
-	delete motorManager;	
+	delete busManager;
 }
 
 // Calibrate service functions ------------------------------------------------
@@ -191,7 +204,9 @@ bool deltaRobotNodeNamespace::DeltaRobotNode::calibrate_json(rexos_std_srvs::Mod
  * @param z destination z-coordinate
  * @param maxAcceleration maximum acceleration
  * 
- * @return false if the path is illegal, true if the motion is executed succesfully.
+ * @return false if the path is illegal, true once the motion has finished.
+ * 
+ * @throw The exception the motion failed with, if it failed.
  **/
 bool deltaRobotNodeNamespace::DeltaRobotNode::moveToPoint(double x, double y, double z, double maxAcceleration){
 	rexos_datatypes::Point3D<double> oldLocation(deltaRobot->getEffectorLocation());
@@ -200,6 +215,7 @@ bool deltaRobotNodeNamespace::DeltaRobotNode::moveToPoint(double x, double y, do
 	if(deltaRobot->checkPath(oldLocation, newLocation)){
 		ROS_INFO("moveTo: (%f, %f, %f) maxAcceleration=%f", x, y, z, maxAcceleration);
 		deltaRobot->moveTo(newLocation, maxAcceleration);
+		deltaRobot->waitForMotions();
 		return true;
 	}
 	return false;
@@ -268,7 +284,9 @@ bool deltaRobotNodeNamespace::DeltaRobotNode::moveToPoint_json(rexos_std_srvs::M
  * @param z destination relative z-coordinate
  * @param maxAcceleration maximum acceleration
  * 
- * @return false if the path is illegal, true if the motion is executed succesfully.
+ * @return false if the path is illegal, true once the motion has finished.
+ * 
+ * @throw The exception the motion failed with, if it failed.
  **/
 bool deltaRobotNodeNamespace::DeltaRobotNode::moveToRelativePoint(double x, double y, double z, double maxAcceleration){
 	rexos_datatypes::Point3D<double> oldLocation(deltaRobot->getEffectorLocation());
@@ -278,6 +296,7 @@ bool deltaRobotNodeNamespace::DeltaRobotNode::moveToRelativePoint(double x, doub
 	if(deltaRobot->checkPath(oldLocation, newLocation)){
 		ROS_INFO("moveTo: (%f, %f, %f) maxAcceleration=%f", x, y, z, maxAcceleration);
 		deltaRobot->moveTo(newLocation, maxAcceleration);
+		deltaRobot->waitForMotions();
 		return true;
 	} else {
 		return false;
@@ -354,26 +373,27 @@ bool deltaRobotNodeNamespace::DeltaRobotNode::movePath_old(delta_robot_node::Mov
 		res.message="Cannot move path, mast state="+ std::string(rexos_mast::state_txt[getState()]);
 		ROS_INFO("%s",res.message.c_str());
 	} else {
-		if(!deltaRobot->checkPath(deltaRobot->getEffectorLocation(),rexos_datatypes::Point3D<double>(req.motion[0].x, req.motion[0].y, req.motion[0].z))){
+		// The path starts at the current effector location.
+		std::vector<rexos_datatypes::Point3D<double> > points;
+		points.push_back(deltaRobot->getEffectorLocation());
+		for(unsigned int i = 0; i < req.motion.size(); i++){
+			points.push_back(rexos_datatypes::Point3D<double>(req.motion[i].x, req.motion[i].y, req.motion[i].z));
+		}
+
+		if(deltaRobot->checkPolyline(&points[0], points.size()) != -1){
 			res.message = "Cannot move path, path is illegal";
 			ROS_INFO("%s",res.message.c_str());
 			return true;
 		}
 
-		for(unsigned int i = 0; i < req.motion.size() -1; i++){
-			if(!deltaRobot->checkPath(
-					rexos_datatypes::Point3D<double>(req.motion[i].x, req.motion[i].y, req.motion[i].z),
-					rexos_datatypes::Point3D<double>(req.motion[i+1].x, req.motion[i+1].y, req.motion[i+1].z))){
-				res.message="Cannot move path, path is illegal";
-				ROS_INFO("%s",res.message.c_str());
-				return true;
-			}
-		}
-
+		trajectoryPlanner.clear();
 		for(unsigned int i = 0; i < req.motion.size(); i++){	
 			ROS_INFO("moveTo: (%f, %f, %f) maxAcceleration=%f", req.motion[i].x, req.motion[i].y, req.motion[i].z, req.motion[i].maxAcceleration);
-			deltaRobot->moveTo(rexos_datatypes::Point3D<double>(req.motion[i].x, req.motion[i].y, req.motion[i].z), req.motion[i].maxAcceleration);
+			trajectoryPlanner.addWaypoint(rexos_datatypes::Point3D<double>(req.motion[i].x, req.motion[i].y, req.motion[i].z), req.motion[i].maxAcceleration);
 		}
+		// The motions of the path are planned while the ones before them run, the reply waits for the last one.
+		deltaRobot->moveAlongTrajectory(trajectoryPlanner);
+		deltaRobot->waitForMotions();
 		res.succeeded = true;
 	}
 	return true;
@@ -398,29 +418,31 @@ bool deltaRobotNodeNamespace::DeltaRobotNode::movePath_json(rexos_std_srvs::Modu
 		int size = 0;
 		Point * path = parsePointArray(req.json, size);
 
-		if(!deltaRobot->checkPath(deltaRobot->getEffectorLocation(),rexos_datatypes::Point3D<double>(path[0].x, path[0].y, path[0].z))){
+		// The path starts at the current effector location.
+		std::vector<rexos_datatypes::Point3D<double> > points;
+		points.push_back(deltaRobot->getEffectorLocation());
+		for(int i = 0; i < size; i++){
+			points.push_back(rexos_datatypes::Point3D<double>(path[i].x, path[i].y, path[i].z));
+		}
+
+		if(deltaRobot->checkPolyline(&points[0], points.size()) != -1){
 			res.message = "Cannot move path, path is illegal";
 			ROS_INFO("%s",res.message.c_str());
+			delete[] path;
 			return true;
 		}
 
-		for(int i = 0; i < (int)(size - 1); i++){
-			if(!deltaRobot->checkPath(
-					rexos_datatypes::Point3D<double>(path[i].x, path[i].y, path[i].z),
-					rexos_datatypes::Point3D<double>(path[i + 1].x, path[i + 1].y, path[i + 1].z))){
-				res.message = "Cannot move path, path is illegal";
-				ROS_INFO("%s",res.message.c_str());
-				return true;
-			}
-		}
-
 		// if the function gets to this point, the path is valid, we can move.
+		trajectoryPlanner.clear();
 		for(int i = 0; i < (int)size; i++){
 			ROS_INFO("moveTo: (%f, %f, %f) maxAcceleration=%f", path[i].x, path[i].y, path[i].z, path[i].maxAcceleration);
-			deltaRobot->moveTo(rexos_datatypes::Point3D<double>(path[i].x, path[i].y, path[i].z), path[i].maxAcceleration);
+			trajectoryPlanner.addWaypoint(rexos_datatypes::Point3D<double>(path[i].x, path[i].y, path[i].z), path[i].maxAcceleration);
 		}
+		// The motions of the path are planned while the ones before them run, the reply waits for the last one.
+		deltaRobot->moveAlongTrajectory(trajectoryPlanner);
+		deltaRobot->waitForMotions();
 		res.succeeded = true;
-		delete path;
+		delete[] path;
 	}
 	return true;
 }
@@ -440,33 +462,30 @@ bool deltaRobotNodeNamespace::DeltaRobotNode::moveRelativePath_old(delta_robot_n
 		res.message = "Cannot move to relative path, mast state= " + std::string(rexos_mast::state_txt[getState()]);
 		ROS_INFO("%s",res.message.c_str());
 	} else {
-		rexos_datatypes::Point3D<double> oldLocation(deltaRobot->getEffectorLocation());
-		rexos_datatypes::Point3D<double> newLocation(req.motion[0].x, req.motion[0].y, req.motion[0].z);
-		newLocation += oldLocation;
+		// The path starts at the current effector location, every point is relative to the previous one.
+		std::vector<rexos_datatypes::Point3D<double> > points;
+		points.push_back(deltaRobot->getEffectorLocation());
+		for(unsigned int i = 0; i < req.motion.size(); i++){
+			points.push_back(points.back() + rexos_datatypes::Point3D<double>(req.motion[i].x, req.motion[i].y, req.motion[i].z));
+		}
 
-		if(!deltaRobot->checkPath(oldLocation, newLocation)){
+		int invalidSegment = deltaRobot->checkPolyline(&points[0], points.size());
+		if(invalidSegment != -1){
 			res.message = "Cannot move relative path, path is illegal";
-			ROS_INFO("FROM %f, %f, %f TO %f, %f, %f Not allowed", oldLocation.x, oldLocation.y, oldLocation.z, newLocation.x, newLocation.y, newLocation.z);
+			ROS_INFO("FROM %f, %f, %f TO %f, %f, %f Not allowed", points[invalidSegment].x, points[invalidSegment].y, points[invalidSegment].z, points[invalidSegment + 1].x, points[invalidSegment + 1].y, points[invalidSegment + 1].z);
 			return true;
 		}
 
-		for(unsigned int i = 0; i < req.motion.size() - 1; i++){
-			oldLocation += rexos_datatypes::Point3D<double>(req.motion[i].x, req.motion[i].y, req.motion[i].z);
-			newLocation += rexos_datatypes::Point3D<double>(req.motion[i+1].x, req.motion[i+1].y, req.motion[i+1].z);
-
-			if(!deltaRobot->checkPath(oldLocation, newLocation)){
-				res.message="Cannot move relative path, path is illegal";
-				ROS_INFO("FROM %f, %f, %f TO %f, %f, %f Not allowed", oldLocation.x, oldLocation.y, oldLocation.z, newLocation.x, newLocation.y, newLocation.z);
-				return true; 
-			}
-		}
-
 		rexos_datatypes::Point3D<double> currentLocation(deltaRobot->getEffectorLocation());
+		trajectoryPlanner.clear();
 		for(unsigned int i = 0; i < req.motion.size(); i++){
 			currentLocation += rexos_datatypes::Point3D<double>(req.motion[i].x, req.motion[i].y, req.motion[i].z);
 			ROS_INFO("moveTo: (%f, %f, %f) maxAcceleration=%f", currentLocation.x, currentLocation.y, currentLocation.z, req.motion[i].maxAcceleration);
-			deltaRobot->moveTo(currentLocation, req.motion[i].maxAcceleration);
+			trajectoryPlanner.addWaypoint(currentLocation, req.motion[i].maxAcceleration);
 		}
+		// The motions of the path are planned while the ones before them run, the reply waits for the last one.
+		deltaRobot->moveAlongTrajectory(trajectoryPlanner);
+		deltaRobot->waitForMotions();
 		res.succeeded = true;
 	}
 	return true;
@@ -490,34 +509,33 @@ bool deltaRobotNodeNamespace::DeltaRobotNode::moveRelativePath_json(rexos_std_sr
 		int size = 0;
 		Point * path = parsePointArray(req.json, size);
 
-		rexos_datatypes::Point3D<double> oldLocation(deltaRobot->getEffectorLocation());
-		rexos_datatypes::Point3D<double> newLocation(path[0].x, path[0].y, path[0].z);
-		newLocation += oldLocation;
-
-		if(deltaRobot->checkPath(oldLocation, newLocation)){
-			res.message = "Cannot move path, path is illegal";
-			ROS_INFO("%s",res.message.c_str());
-			return true;
+		// The path starts at the current effector location, every point is relative to the previous one.
+		std::vector<rexos_datatypes::Point3D<double> > points;
+		points.push_back(deltaRobot->getEffectorLocation());
+		for(int i = 0; i < size; i++){
+			points.push_back(points.back() + rexos_datatypes::Point3D<double>(path[i].x, path[i].y, path[i].z));
 		}
 
-		for(int i = 0; i < (int)(size - 1); i++){
-			oldLocation += rexos_datatypes::Point3D<double>(path[i].x, path[i].y, path[i].z);
-			newLocation += rexos_datatypes::Point3D<double>(path[i+1].x, path[i+1].y, path[i+1].z);
-			if(!deltaRobot->checkPath(oldLocation, newLocation)){
-				res.message = "Cannot move to relative path, path is illegal";
-				ROS_INFO("FROM %f, %f, %f TO %f, %f, %f Not allowed", oldLocation.x, oldLocation.z, oldLocation.y, newLocation.x, newLocation.y, newLocation.z);
-				return true;
-			}
+		int invalidSegment = deltaRobot->checkPolyline(&points[0], points.size());
+		if(invalidSegment != -1){
+			res.message = "Cannot move to relative path, path is illegal";
+			ROS_INFO("FROM %f, %f, %f TO %f, %f, %f Not allowed", points[invalidSegment].x, points[invalidSegment].y, points[invalidSegment].z, points[invalidSegment + 1].x, points[invalidSegment + 1].y, points[invalidSegment + 1].z);
+			delete[] path;
+			return true;
 		}
 
 		rexos_datatypes::Point3D<double> currentLocation(deltaRobot->getEffectorLocation());
+		trajectoryPlanner.clear();
 		for(int i = 0; i < (int)size; i++){
 			currentLocation += rexos_datatypes::Point3D<double>(path[i].x, path[i].y, path[i].z);
 			ROS_INFO("moveTo: (%f, %f, %f) maxAcceleration=%f", currentLocation.x, currentLocation.y, currentLocation.z, path[i].maxAcceleration);
-			deltaRobot->moveTo(currentLocation, path[i].maxAcceleration);
+			trajectoryPlanner.addWaypoint(currentLocation, path[i].maxAcceleration);
 		}
+		// The motions of the path are planned while the ones before them run, the reply waits for the last one.
+		deltaRobot->moveAlongTrajectory(trajectoryPlanner);
+		deltaRobot->waitForMotions();
 		res.succeeded = true;
-		delete path;
+		delete[] path;
 	}
 	return true;
 }
@@ -530,8 +548,58 @@ int deltaRobotNodeNamespace::DeltaRobotNode::transitionSetup(){
 	ROS_INFO("Setup transition called");
 	setState(rexos_mast::setup);
 
+	// The effector boundaries are cached in the ROS home directory, unless another directory is set
+	std::string defaultCacheDirectory;
+	if(getenv("ROS_HOME") != NULL){
+		defaultCacheDirectory = getenv("ROS_HOME");
+	} else if(getenv("HOME") != NULL){
+		defaultCacheDirectory = std::string(getenv("HOME")) + "/.ros";
+	}
+	std::string cacheDirectory;
+	ros::NodeHandle("~").param<std::string>("boundaries_cache_directory", cacheDirectory, defaultCacheDirectory);
+
+	// Boards with little memory can store the boundaries as bricks instead of a dense bitmap
+	std::string storage;
+	ros::NodeHandle("~").param<std::string>("boundaries_storage", storage, "dense");
+	rexos_delta_robot::EffectorBoundaries::StorageType storageType = rexos_delta_robot::EffectorBoundaries::DENSE;
+	if(storage == "bricks"){
+		storageType = rexos_delta_robot::EffectorBoundaries::BRICKS;
+	}
+
+	// With linear interpolation, waypoints of a path within this distance in millimeters of a straight motion are skipped, 0 moves past every waypoint
+	double skipTolerance;
+	ros::NodeHandle("~").param<double>("waypoint_skip_tolerance", skipTolerance, 0);
+	trajectoryPlanner.setSkipTolerance(skipTolerance);
+
+	// The effector moves in straight lines when the interpolation is set to linear
+	std::string interpolation;
+	double maxChordalError;
+	ros::NodeHandle("~").param<std::string>("interpolation", interpolation, "joint");
+	ros::NodeHandle("~").param<double>("max_chordal_error", maxChordalError, rexos_delta_robot::Measures::LINEAR_MAX_CHORDAL_ERROR);
+	if(interpolation == "linear"){
+		deltaRobot->setInterpolationMode(rexos_delta_robot::DeltaRobot::LINEAR, maxChordalError);
+	} else{
+		deltaRobot->setInterpolationMode(rexos_delta_robot::DeltaRobot::JOINT, maxChordalError);
+	}
+
+	// Deltarobots with the same measures on one machine can share a single copy of the boundaries
+	bool sharedMemory;
+	ros::NodeHandle("~").param<bool>("boundaries_shared_memory", sharedMemory, false);
+
 	// Generate the effector boundaries with voxel size 2
-	deltaRobot->generateBoundaries(2);
+	deltaRobot->generateBoundaries(2, cacheDirectory, storageType, sharedMemory);
+	// A distance field lets short motions deep inside the boundaries skip the voxel by voxel path check, at 1 byte per voxel
+	bool distanceField;
+	ros::NodeHandle("~").param<bool>("boundaries_distance_field", distanceField, false);
+	if(distanceField){
+		deltaRobot->getBoundaries()->generateDistanceField();
+	}
+	// Motions can use a lookup table on the same grid instead of solving the kinematics for every point
+	bool kinematicsLookupTable;
+	ros::NodeHandle("~").param<bool>("kinematics_lookup_table", kinematicsLookupTable, false);
+	if(kinematicsLookupTable){
+		deltaRobot->generateKinematicsLookupTable(2);
+	}
 	// Power on the deltarobot and calibrate the motors.
 	deltaRobot->powerOn();
 	// Calibrate the motors
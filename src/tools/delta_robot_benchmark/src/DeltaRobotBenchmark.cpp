@@ -0,0 +1,430 @@
+/**
+ * @file DeltaRobotBenchmark.cpp
+ * @brief Hardware-free benchmarks of the deltarobot kinematics, boundaries and motion planning, with machine-readable output.
+ *
+ * @section LICENSE
+ * License: newBSD
+ *  
+ * Copyright © 2012, HU University of Applied Sciences Utrecht.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <rexos_datatypes/DeltaRobotMeasures.h>
+#include <rexos_datatypes/MotorRotation.h>
+#include <rexos_datatypes/Point3D.h>
+#include <rexos_delta_robot/EffectorBoundaries.h>
+#include <rexos_delta_robot/ForwardKinematics.h>
+#include <rexos_delta_robot/InverseKinematics.h>
+#include <rexos_delta_robot/InverseKinematicsLookupTable.h>
+#include <rexos_delta_robot/Measures.h>
+#include <rexos_delta_robot/MotionPlanner.h>
+
+namespace DeltaRobotBenchmarkNamespace{
+	/**
+	 * @var int DEFAULT_NUMBER_OF_SAMPLES
+	 * The amount of points, paths and moves per benchmark when no amount is given on the command line.
+	 **/
+	const int DEFAULT_NUMBER_OF_SAMPLES = 100000;
+
+	/**
+	 * @var double VOXEL_SIZE
+	 * The voxel size in millimeters of the effector boundaries used for the path and move benchmarks, the same as the deltarobot node uses.
+	 **/
+	const double VOXEL_SIZE = 2;
+
+	/**
+	 * @var double DEFAULT_VOXEL_SIZES
+	 * The voxel sizes in millimeters the boundary generation is measured for when none are given on the command line.
+	 **/
+	const double DEFAULT_VOXEL_SIZES[] = {4, 2, 1};
+
+	/**
+	 * @var double MAX_ACCELERATION
+	 * The acceleration in radians/s² of the motor with the biggest motion.
+	 **/
+	const double MAX_ACCELERATION = 50;
+
+	/**
+	 * A single measurement.
+	 **/
+	struct Result{
+		/**
+		 * @var std::string benchmark
+		 * The name of the benchmark.
+		 **/
+		std::string benchmark;
+
+		/**
+		 * @var std::string parameter
+		 * The parameter the benchmark ran with, or an empty string.
+		 **/
+		std::string parameter;
+
+		/**
+		 * @var std::string metric
+		 * The name of the measured value.
+		 **/
+		std::string metric;
+
+		/**
+		 * @var double value
+		 * The measured value.
+		 **/
+		double value;
+
+		/**
+		 * @var std::string unit
+		 * The unit of the value.
+		 **/
+		std::string unit;
+
+		Result(const std::string& benchmark, const std::string& parameter, const std::string& metric, double value, const std::string& unit) :
+			benchmark(benchmark), parameter(parameter), metric(metric), value(value), unit(unit){}
+	};
+
+	/**
+	 * @var std::vector<Result> results
+	 * All measurements, in the order they were made.
+	 **/
+	std::vector<Result> results;
+
+	/**
+	 * Gets the time of a monotonic clock.
+	 *
+	 * @return The time in nanoseconds.
+	 **/
+	long long nanoTime(){
+		timespec time;
+		clock_gettime(CLOCK_MONOTONIC, &time);
+		return (long long) time.tv_sec * 1000000000LL + time.tv_nsec;
+	}
+
+	/**
+	 * Formats a voxel size as benchmark parameter.
+	 *
+	 * @param voxelSize The voxel size in millimeters.
+	 *
+	 * @return The parameter.
+	 **/
+	std::string voxelSizeParameter(double voxelSize){
+		char parameter[32];
+		snprintf(parameter, sizeof(parameter), "voxel_size=%g", voxelSize);
+		return parameter;
+	}
+
+	/**
+	 * Adds the mean, median, 99th percentile and maximum of a list of durations to the results.
+	 *
+	 * @param benchmark The name of the benchmark.
+	 * @param parameter The parameter the benchmark ran with.
+	 * @param durations The durations in nanoseconds. Will be sorted.
+	 **/
+	void addDurations(const std::string& benchmark, const std::string& parameter, std::vector<long long>& durations){
+		std::sort(durations.begin(), durations.end());
+		long long total = 0;
+		for(unsigned int i = 0; i < durations.size(); i++){
+			total += durations[i];
+		}
+		results.push_back(Result(benchmark, parameter, "mean", (double) total / durations.size(), "ns"));
+		results.push_back(Result(benchmark, parameter, "median", durations[durations.size() / 2], "ns"));
+		results.push_back(Result(benchmark, parameter, "p99", durations[durations.size() * 99 / 100], "ns"));
+		results.push_back(Result(benchmark, parameter, "max", durations.back(), "ns"));
+	}
+
+	/**
+	 * Creates random points in the boundary box. The same seed gives the same points on every run.
+	 *
+	 * @param numberOfPoints The amount of points.
+	 * @param seed The seed for the random generator.
+	 * @param points The vector the points are added to.
+	 **/
+	void randomPoints(int numberOfPoints, unsigned int seed, std::vector<rexos_datatypes::Point3D<double> >& points){
+		srand(seed);
+		for(int i = 0; i < numberOfPoints; i++){
+			points.push_back(rexos_datatypes::Point3D<double>((rand() % 400) - 200, (rand() % 400) - 200,
+					rexos_delta_robot::Measures::BOUNDARY_BOX_MIN_Z + rand() % (int) (rexos_delta_robot::Measures::BOUNDARY_BOX_MAX_Z - rexos_delta_robot::Measures::BOUNDARY_BOX_MIN_Z)));
+		}
+	}
+
+	/**
+	 * Measures the throughput of a kinematics model.
+	 *
+	 * @param benchmark The name of the benchmark.
+	 * @param kinematics The kinematics model.
+	 * @param points The points to solve.
+	 **/
+	void benchmarkKinematics(const std::string& benchmark, const rexos_delta_robot::InverseKinematicsModel& kinematics, const std::vector<rexos_datatypes::Point3D<double> >& points){
+		int solved = 0;
+		long long start = nanoTime();
+		for(unsigned int i = 0; i < points.size(); i++){
+			double angles[3];
+			solved += kinematics.solveMotorAngles(points[i], angles) == rexos_delta_robot::InverseKinematicsModel::SOLVED;
+		}
+		long long duration = nanoTime() - start;
+		results.push_back(Result(benchmark, "scalar", "throughput", points.size() / (duration / 1e9), "points/s"));
+		results.push_back(Result(benchmark, "scalar", "solved", solved, "points"));
+	}
+
+	/**
+	 * Measures the generation of the effector boundaries, and adds a fingerprint of the checkPath results so changes in behaviour show up next to changes in speed.
+	 *
+	 * @param kinematics The kinematics model.
+	 * @param voxelSize The voxel size in millimeters.
+	 * @param storageType The way the boundaries are stored.
+	 * @param paths The begin and end points of the paths for the fingerprint.
+	 **/
+	void benchmarkBoundaries(const rexos_delta_robot::InverseKinematicsModel& kinematics, double voxelSize, rexos_delta_robot::EffectorBoundaries::StorageType storageType,
+			const std::vector<rexos_datatypes::Point3D<double> >& paths){
+		double motorMinAngles[3] = {rexos_delta_robot::Measures::MOTOR_ROT_MIN, rexos_delta_robot::Measures::MOTOR_ROT_MIN, rexos_delta_robot::Measures::MOTOR_ROT_MIN};
+		double motorMaxAngles[3] = {rexos_delta_robot::Measures::MOTOR_ROT_MAX, rexos_delta_robot::Measures::MOTOR_ROT_MAX, rexos_delta_robot::Measures::MOTOR_ROT_MAX};
+		std::string parameter = voxelSizeParameter(voxelSize) + (storageType == rexos_delta_robot::EffectorBoundaries::BRICKS ? " storage=bricks" : " storage=dense");
+
+		long long start = nanoTime();
+		rexos_delta_robot::EffectorBoundaries* boundaries = rexos_delta_robot::EffectorBoundaries::generateEffectorBoundaries(kinematics, motorMinAngles, motorMaxAngles, voxelSize, storageType);
+		long long duration = nanoTime() - start;
+		results.push_back(Result("boundaries_generation", parameter, "time", duration / 1e9, "s"));
+		results.push_back(Result("boundaries_generation", parameter, "memory", boundaries->getMemoryUsage(), "bytes"));
+
+		// FNV-1a over the results, the same fingerprint means the same boundaries along these paths.
+		uint64_t fingerprint = 14695981039346656037ULL;
+		int validPaths = 0;
+		for(unsigned int i = 0; i + 1 < paths.size(); i += 2){
+			bool valid = boundaries->checkPath(paths[i], paths[i + 1]);
+			validPaths += valid;
+			fingerprint = (fingerprint ^ (valid ? 1 : 0)) * 1099511628211ULL;
+		}
+		results.push_back(Result("boundaries_generation", parameter, "valid_paths", validPaths, "paths"));
+		results.push_back(Result("boundaries_generation", parameter, "fingerprint", (double) (fingerprint >> 11), "hash"));
+		delete boundaries;
+	}
+
+	/**
+	 * Measures the latency of checkPath for every path.
+	 *
+	 * @param boundaries The effector boundaries.
+	 * @param paths The begin and end points of the paths.
+	 **/
+	void benchmarkCheckPath(const rexos_delta_robot::EffectorBoundaries& boundaries, const std::vector<rexos_datatypes::Point3D<double> >& paths){
+		std::vector<long long> validDurations;
+		std::vector<long long> invalidDurations;
+		for(unsigned int i = 0; i + 1 < paths.size(); i += 2){
+			long long start = nanoTime();
+			bool valid = boundaries.checkPath(paths[i], paths[i + 1]);
+			long long duration = nanoTime() - start;
+			(valid ? validDurations : invalidDurations).push_back(duration);
+		}
+		if(!validDurations.empty()){
+			addDurations("check_path", voxelSizeParameter(VOXEL_SIZE) + " result=valid", validDurations);
+		}
+		if(!invalidDurations.empty()){
+			addDurations("check_path", voxelSizeParameter(VOXEL_SIZE) + " result=invalid", invalidDurations);
+		}
+	}
+
+	/**
+	 * Measures the latency of planning moves between reachable points with the planner DeltaRobot::planMotion uses, once with the rotations as values and once with the rotations allocated for every move as DeltaRobot::moveTo used to.
+	 * Moves the planner refuses are measured as well, the effector then stays where it was.
+	 *
+	 * @param benchmark The name of the benchmark.
+	 * @param motionPlanner The motion planner.
+	 * @param kinematics The kinematics model used for the start angles.
+	 * @param points The reachable points to move between.
+	 **/
+	void benchmarkPlanMove(const std::string& benchmark, const rexos_delta_robot::MotionPlanner& motionPlanner, const rexos_delta_robot::InverseKinematicsModel& kinematics,
+			const std::vector<rexos_datatypes::Point3D<double> >& points){
+		typedef rexos_datatypes::MotorRotation Rotations[3];
+		std::vector<long long> durations(points.size() - 1);
+		for(int allocated = 0; allocated < 2; allocated++){
+			rexos_datatypes::Point3D<double> from = points[0];
+			double fromAngles[3];
+			kinematics.solveMotorAngles(from, fromAngles);
+			int refused = 0;
+			for(unsigned int i = 0; i + 1 < points.size(); i++){
+				long long start = nanoTime();
+				Rotations rotationData;
+				Rotations* rotations = allocated ? new Rotations[1] : &rotationData;
+				try{
+					motionPlanner.planMotion(from, fromAngles, points[i + 1], MAX_ACCELERATION, *rotations);
+					from = points[i + 1];
+					for(int j = 0; j < 3; j++){
+						fromAngles[j] = (*rotations)[j].angle;
+					}
+				} catch(std::exception&){
+					refused++;
+				}
+				if(allocated){
+					delete[] rotations;
+				}
+				durations[i] = nanoTime() - start;
+			}
+			std::string parameter = allocated ? "rotations=allocated" : "rotations=values";
+			addDurations(benchmark, parameter, durations);
+			results.push_back(Result(benchmark, parameter, "refused", refused, "moves"));
+		}
+	}
+
+	/**
+	 * Prints the results as aligned text.
+	 **/
+	void printText(){
+		for(unsigned int i = 0; i < results.size(); i++){
+			printf("%-24s %-36s %-12s %16.6g %s\n", results[i].benchmark.c_str(), results[i].parameter.c_str(), results[i].metric.c_str(), results[i].value, results[i].unit.c_str());
+		}
+	}
+
+	/**
+	 * Prints the results as CSV, with a header line.
+	 **/
+	void printCsv(){
+		printf("benchmark,parameter,metric,value,unit\n");
+		for(unsigned int i = 0; i < results.size(); i++){
+			printf("%s,%s,%s,%.17g,%s\n", results[i].benchmark.c_str(), results[i].parameter.c_str(), results[i].metric.c_str(), results[i].value, results[i].unit.c_str());
+		}
+	}
+
+	/**
+	 * Prints the results as a JSON array of objects. None of the strings contain characters that need escaping.
+	 **/
+	void printJson(){
+		printf("[\n");
+		for(unsigned int i = 0; i < results.size(); i++){
+			printf("\t{\"benchmark\": \"%s\", \"parameter\": \"%s\", \"metric\": \"%s\", \"value\": %.17g, \"unit\": \"%s\"}%s\n",
+					results[i].benchmark.c_str(), results[i].parameter.c_str(), results[i].metric.c_str(), results[i].value, results[i].unit.c_str(), i + 1 < results.size() ? "," : "");
+		}
+		printf("]\n");
+	}
+
+	/**
+	 * Prints how to use the benchmark.
+	 *
+	 * @param name The name of the executable.
+	 **/
+	void printUsage(const char* name){
+		fprintf(stderr, "usage: %s [--format text|csv|json] [--samples N] [--voxel-size MM]...\n", name);
+	}
+}
+
+/**
+ * Runs all benchmarks and prints the results.
+ *
+ * @param argc Argument count.
+ * @param argv The output format, the amount of samples per benchmark and the voxel sizes for the boundary generation can be given as options.
+ **/
+int main(int argc, char** argv){
+	using namespace DeltaRobotBenchmarkNamespace;
+	std::string format = "text";
+	int numberOfSamples = DEFAULT_NUMBER_OF_SAMPLES;
+	std::vector<double> voxelSizes;
+	for(int i = 1; i < argc; i++){
+		if(strcmp(argv[i], "--format") == 0 && i + 1 < argc){
+			format = argv[++i];
+		} else if(strcmp(argv[i], "--samples") == 0 && i + 1 < argc){
+			numberOfSamples = atoi(argv[++i]);
+		} else if(strcmp(argv[i], "--voxel-size") == 0 && i + 1 < argc){
+			voxelSizes.push_back(atof(argv[++i]));
+		} else{
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+	if((format != "text" && format != "csv" && format != "json") || numberOfSamples < 2){
+		printUsage(argv[0]);
+		return 1;
+	}
+	for(unsigned int i = 0; i < voxelSizes.size(); i++){
+		if(voxelSizes[i] <= 0){
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+	if(voxelSizes.empty()){
+		voxelSizes.assign(DEFAULT_VOXEL_SIZES, DEFAULT_VOXEL_SIZES + sizeof(DEFAULT_VOXEL_SIZES) / sizeof(DEFAULT_VOXEL_SIZES[0]));
+	}
+
+	rexos_datatypes::DeltaRobotMeasures deltaRobotMeasures;
+	deltaRobotMeasures.base = rexos_delta_robot::Measures::BASE;
+	deltaRobotMeasures.hip = rexos_delta_robot::Measures::HIP;
+	deltaRobotMeasures.effector = rexos_delta_robot::Measures::EFFECTOR;
+	deltaRobotMeasures.ankle = rexos_delta_robot::Measures::ANKLE;
+	deltaRobotMeasures.maxAngleHipAnkle = rexos_delta_robot::Measures::HIP_ANKLE_ANGLE_MAX;
+	rexos_delta_robot::InverseKinematics kinematics(deltaRobotMeasures);
+	rexos_delta_robot::ForwardKinematics forwardKinematics(deltaRobotMeasures);
+
+	// Kinematics throughput, for the exact model and the lookup table.
+	std::vector<rexos_datatypes::Point3D<double> > points;
+	randomPoints(numberOfSamples, 1, points);
+	benchmarkKinematics("inverse_kinematics", kinematics, points);
+
+	double lookupTableMaxError = rexos_delta_robot::Measures::KINEMATICS_TOLERANCE;
+	long long start = nanoTime();
+	rexos_delta_robot::InverseKinematicsLookupTable lookupTable(kinematics, VOXEL_SIZE, lookupTableMaxError);
+	results.push_back(Result("kinematics_lookup_table", voxelSizeParameter(VOXEL_SIZE), "build_time", (nanoTime() - start) / 1e9, "s"));
+	results.push_back(Result("kinematics_lookup_table", voxelSizeParameter(VOXEL_SIZE), "memory", lookupTable.getMemoryUsage(), "bytes"));
+	benchmarkKinematics("kinematics_lookup_table", lookupTable, points);
+
+	// Boundary generation for every voxel size and storage type.
+	std::vector<rexos_datatypes::Point3D<double> > paths;
+	randomPoints(2 * numberOfSamples, 2, paths);
+	for(unsigned int i = 0; i < voxelSizes.size(); i++){
+		benchmarkBoundaries(kinematics, voxelSizes[i], rexos_delta_robot::EffectorBoundaries::DENSE, paths);
+		benchmarkBoundaries(kinematics, voxelSizes[i], rexos_delta_robot::EffectorBoundaries::BRICKS, paths);
+	}
+
+	// Path checks and move planning on the boundaries the deltarobot node uses.
+	double motorMinAngles[3] = {rexos_delta_robot::Measures::MOTOR_ROT_MIN, rexos_delta_robot::Measures::MOTOR_ROT_MIN, rexos_delta_robot::Measures::MOTOR_ROT_MIN};
+	double motorMaxAngles[3] = {rexos_delta_robot::Measures::MOTOR_ROT_MAX, rexos_delta_robot::Measures::MOTOR_ROT_MAX, rexos_delta_robot::Measures::MOTOR_ROT_MAX};
+	rexos_delta_robot::EffectorBoundaries* boundaries = rexos_delta_robot::EffectorBoundaries::generateEffectorBoundaries(kinematics, motorMinAngles, motorMaxAngles, VOXEL_SIZE);
+	benchmarkCheckPath(*boundaries, paths);
+
+	std::vector<rexos_datatypes::Point3D<double> > reachablePoints;
+	for(unsigned int i = 0; i < points.size(); i++){
+		double angles[3];
+		if(kinematics.solveMotorAngles(points[i], angles) == rexos_delta_robot::InverseKinematicsModel::SOLVED){
+			reachablePoints.push_back(points[i]);
+		}
+	}
+	if(reachablePoints.size() >= 2){
+		// The same tolerances DeltaRobot uses with and without the lookup table, see DeltaRobot::generateKinematicsLookupTable.
+		rexos_delta_robot::MotionPlanner motionPlanner(kinematics, forwardKinematics, *boundaries, rexos_delta_robot::Measures::KINEMATICS_TOLERANCE, motorMinAngles, motorMaxAngles);
+		benchmarkPlanMove("plan_move", motionPlanner, kinematics, reachablePoints);
+		rexos_delta_robot::MotionPlanner lookupTablePlanner(lookupTable, forwardKinematics, *boundaries, rexos_delta_robot::Measures::KINEMATICS_TOLERANCE + lookupTableMaxError,
+				motorMinAngles, motorMaxAngles);
+		benchmarkPlanMove("plan_move_lookup_table", lookupTablePlanner, lookupTable, reachablePoints);
+	}
+	delete boundaries;
+
+	if(format == "csv"){
+		printCsv();
+	} else if(format == "json"){
+		printJson();
+	} else{
+		printText();
+	}
+	return 0;
+}
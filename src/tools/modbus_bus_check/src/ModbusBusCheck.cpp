@@ -0,0 +1,530 @@
+/**
+ * @file ModbusBusCheck.cpp
+ * @brief Hardware-free regression checks of the modbus transactions the motor libraries send, on a simulated bus.
+ *
+ * @section LICENSE
+ * License: newBSD
+ *
+ * Copyright © 2012, HU University of Applied Sciences Utrecht.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ * - Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ * - Neither the name of the HU University of Applied Sciences Utrecht nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE HU UNIVERSITY OF APPLIED SCIENCES UTRECHT
+ * BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE
+ * GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ **/
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include <boost/thread.hpp>
+
+#include <rexos_datatypes/MotorRotation.h>
+#include <rexos_modbus/ModbusController.h>
+#include <rexos_motor/CRD514KD.h>
+#include <rexos_motor/MotorManager.h>
+#include <rexos_motor/StepperMotor.h>
+#include <rexos_utilities/Utilities.h>
+
+namespace ModbusBusCheckNamespace{
+	/**
+	 * @var int EXPECTED_POWER_ON_TRANSACTIONS
+	 * The amount of transactions MotorManager::powerOn needs for the three motors of a deltarobot on one bus.
+	 **/
+	const int EXPECTED_POWER_ON_TRANSACTIONS = 14;
+
+	/**
+	 * @var uint16_t PRIORITY_CHECK_ADDRESSES
+	 * The addresses written or read by the priority check, in the order the bus has to execute them.
+	 **/
+	const uint16_t PRIORITY_CHECK_ADDRESSES[] = {100, 500, 400, 300, 301, 302, 200, 201, 202};
+
+	/**
+	 * @var int NUMBER_OF_BUSES
+	 * The amount of simulated buses, enough to put every motor of a deltarobot on its own bus.
+	 **/
+	const int NUMBER_OF_BUSES = 3;
+
+	/**
+	 * @var int64_t TRANSACTION_TIME
+	 * The time in nanoseconds a transaction takes on the simulated buses of the multiple buses check, about a write with its response at 115200 baud and the latency of a USB serial adapter.
+	 **/
+	const int64_t TRANSACTION_TIME = 3000000;
+
+	/**
+	 * @var int NUMBER_OF_MOTIONS
+	 * The amount of motions the multiple buses check measures.
+	 **/
+	const int NUMBER_OF_MOTIONS = 10;
+
+	/**
+	 * @var int64_t MAX_START_SKEW
+	 * The maximum time in nanoseconds between the START commands of one motion on different buses. Half the interval after a unicast, by which the START commands drift apart when the buses are not synchronised.
+	 **/
+	const int64_t MAX_START_SKEW = 4000000;
+
+	/**
+	 * A simulated bus with the three motor controllers of a deltarobot. The fake libmodbus functions below execute the transactions on the bus that is passed as their context.
+	 **/
+	struct SimulatedBus{
+		/**
+		 * @var boost::mutex mutex
+		 * Guards the simulated bus against the bus threads and the check.
+		 **/
+		boost::mutex mutex;
+
+		/**
+		 * @var boost::condition_variable changed
+		 * Notified when the bus is released or a transaction starts waiting for it.
+		 **/
+		boost::condition_variable changed;
+
+		/**
+		 * @var bool held
+		 * While true, transactions wait until the bus is released, so the check can queue transactions behind them.
+		 **/
+		bool held;
+
+		/**
+		 * @var bool waiting
+		 * Whether a transaction is waiting for the bus to be released.
+		 **/
+		bool waiting;
+
+		/**
+		 * @var int slave
+		 * The slave set by modbus_set_slave.
+		 **/
+		int slave;
+
+		/**
+		 * @var int transactions
+		 * The amount of executed transactions.
+		 **/
+		int transactions;
+
+		/**
+		 * @var std::vector<uint16_t> addresses
+		 * The first address of every executed transaction, in the order of execution.
+		 **/
+		std::vector<uint16_t> addresses;
+
+		/**
+		 * @var std::map<uint32_t, uint16_t> registers
+		 * The written registers of all slaves, by slave in the upper and address in the lower 16 bits.
+		 **/
+		std::map<uint32_t, uint16_t> registers;
+
+		/**
+		 * @var int64_t transactionTime
+		 * The time in nanoseconds every transaction takes.
+		 **/
+		int64_t transactionTime;
+
+		/**
+		 * @var std::vector<int64_t> startTimes
+		 * The times, on the monotonic clock in nanoseconds, writes with the START bit of CMD_1 were sent.
+		 **/
+		std::vector<int64_t> startTimes;
+
+		SimulatedBus() : held(false), waiting(false), slave(0), transactions(0), transactionTime(0){}
+	};
+
+	/**
+	 * @var SimulatedBus simulatedBuses[NUMBER_OF_BUSES]
+	 * The buses the fake libmodbus functions act on.
+	 **/
+	SimulatedBus simulatedBuses[NUMBER_OF_BUSES];
+
+	/**
+	 * Counts a transaction and, when the bus is held, waits until it is released. Then takes the transaction time of the bus. The caller holds the lock of the simulated bus.
+	 *
+	 * @param bus The simulated bus.
+	 * @param lock The lock on the mutex of the simulated bus.
+	 * @param firstAddress The first address of the transaction.
+	 **/
+	void executeTransaction(SimulatedBus& bus, boost::unique_lock<boost::mutex>& lock, uint16_t firstAddress){
+		while(bus.held){
+			bus.waiting = true;
+			bus.changed.notify_all();
+			bus.changed.wait(lock);
+		}
+		bus.waiting = false;
+		bus.transactions++;
+		bus.addresses.push_back(firstAddress);
+		if(bus.transactionTime > 0){
+			rexos_utilities::sleepUntil(rexos_utilities::monotonicTimeNow() + bus.transactionTime);
+		}
+	}
+
+	/**
+	 * Writes a register of the current slave, or of every motor controller when broadcasting.
+	 *
+	 * @param bus The simulated bus.
+	 * @param address The address of the register.
+	 * @param value The value.
+	 **/
+	void writeRegister(SimulatedBus& bus, int address, uint16_t value){
+		if(bus.slave == rexos_motor::CRD514KD::Slaves::BROADCAST){
+			for(uint32_t slave = rexos_motor::CRD514KD::Slaves::MOTOR_0; slave <= rexos_motor::CRD514KD::Slaves::MOTOR_2; slave++){
+				bus.registers[slave << 16 | address] = value;
+			}
+		} else{
+			bus.registers[(uint32_t)bus.slave << 16 | address] = value;
+		}
+	}
+
+	/**
+	 * Clears the transactions, registers and start times of a simulated bus.
+	 *
+	 * @param bus The simulated bus.
+	 **/
+	void resetSimulatedBus(SimulatedBus& bus){
+		boost::lock_guard<boost::mutex> lock(bus.mutex);
+		bus.transactions = 0;
+		bus.addresses.clear();
+		bus.registers.clear();
+		bus.startTimes.clear();
+	}
+
+	/**
+	 * Prints the outcome of a check.
+	 *
+	 * @param check The name of the check.
+	 * @param metric The name of the checked value.
+	 * @param value The value the libraries produced.
+	 * @param expected The expected value, or the bounds it has to be within.
+	 * @param passed Whether the value is as expected.
+	 *
+	 * @return passed.
+	 **/
+	bool report(const std::string& check, const std::string& metric, const std::string& value, const std::string& expected, bool passed){
+		printf("%-20s %-24s %-40s %-40s %s\n", check.c_str(), metric.c_str(), value.c_str(), expected.c_str(), passed ? "ok" : "FAILED");
+		return passed;
+	}
+
+	/**
+	 * Prints the outcome of a check that compares a value with the expected value.
+	 *
+	 * @param check The name of the check.
+	 * @param metric The name of the compared value.
+	 * @param value The value the libraries produced.
+	 * @param expected The expected value.
+	 *
+	 * @return true if the value is the expected value.
+	 **/
+	bool report(const std::string& check, const std::string& metric, const std::string& value, const std::string& expected){
+		return report(check, metric, value, expected, value == expected);
+	}
+
+	/**
+	 * Formats an integer for report.
+	 *
+	 * @param value The integer.
+	 *
+	 * @return The integer in decimal.
+	 **/
+	std::string toString(int value){
+		char buffer[16];
+		snprintf(buffer, sizeof(buffer), "%d", value);
+		return buffer;
+	}
+
+	/**
+	 * Powers on the three motors of a deltarobot one by one and through a MotorManager. The MotorManager has to leave the same registers in the motor controllers with EXPECTED_POWER_ON_TRANSACTIONS transactions.
+	 *
+	 * @return true if the check passed.
+	 **/
+	bool checkPowerOn(){
+		SimulatedBus& simulatedBus = simulatedBuses[0];
+		modbus_t* context = reinterpret_cast<modbus_t*>(&simulatedBus);
+		std::map<uint32_t, uint16_t> individualRegisters;
+		int individualTransactions;
+		{
+			rexos_modbus::ModbusController modbus(context);
+			rexos_motor::StepperMotor motor0(&modbus, rexos_motor::CRD514KD::Slaves::MOTOR_0, -1, 1);
+			rexos_motor::StepperMotor motor1(&modbus, rexos_motor::CRD514KD::Slaves::MOTOR_1, -1, 1);
+			rexos_motor::StepperMotor motor2(&modbus, rexos_motor::CRD514KD::Slaves::MOTOR_2, -1, 1.2);
+			resetSimulatedBus(simulatedBus);
+			motor0.powerOn();
+			motor1.powerOn();
+			motor2.powerOn();
+			individualTransactions = simulatedBus.transactions;
+			individualRegisters = simulatedBus.registers;
+			motor0.markPoweredOff();
+			motor1.markPoweredOff();
+			motor2.markPoweredOff();
+		}
+
+		rexos_modbus::ModbusController modbus(context);
+		rexos_motor::StepperMotor motor0(&modbus, rexos_motor::CRD514KD::Slaves::MOTOR_0, -1, 1);
+		rexos_motor::StepperMotor motor1(&modbus, rexos_motor::CRD514KD::Slaves::MOTOR_1, -1, 1);
+		rexos_motor::StepperMotor motor2(&modbus, rexos_motor::CRD514KD::Slaves::MOTOR_2, -1, 1.2);
+		rexos_motor::StepperMotor* motors[3] = {&motor0, &motor1, &motor2};
+		rexos_motor::MotorManager motorManager(motors, 3);
+		resetSimulatedBus(simulatedBus);
+		motorManager.powerOn();
+		int transactions = simulatedBus.transactions;
+		bool registersEqual = simulatedBus.registers == individualRegisters;
+		motor0.markPoweredOff();
+		motor1.markPoweredOff();
+		motor2.markPoweredOff();
+
+		printf("# one by one the motors are powered on with %d transactions\n", individualTransactions);
+		bool passed = report("power_on", "transactions", toString(transactions), toString(EXPECTED_POWER_ON_TRANSACTIONS));
+		passed = report("power_on", "registers", registersEqual ? "as one by one" : "differ", "as one by one") && passed;
+		return passed;
+	}
+
+	/**
+	 * Queues transactions of every priority behind a transaction that holds the bus. Once the bus is released, they have to be executed in the order of PRIORITY_CHECK_ADDRESSES.
+	 *
+	 * @return true if the check passed.
+	 **/
+	bool checkPriorities(){
+		typedef rexos_modbus::ModbusController ModbusController;
+		SimulatedBus& simulatedBus = simulatedBuses[0];
+		ModbusController modbus(reinterpret_cast<modbus_t*>(&simulatedBus));
+		resetSimulatedBus(simulatedBus);
+		{
+			boost::lock_guard<boost::mutex> lock(simulatedBus.mutex);
+			simulatedBus.held = true;
+		}
+
+		// The first transaction holds the bus until all others are queued.
+		uint16_t value = 1;
+		std::vector<ModbusController::TransactionResult> results;
+		results.push_back(modbus.writeU16Async(rexos_motor::CRD514KD::Slaves::MOTOR_0, 100, &value, 1));
+		{
+			boost::unique_lock<boost::mutex> lock(simulatedBus.mutex);
+			while(!simulatedBus.waiting){
+				simulatedBus.changed.wait(lock);
+			}
+		}
+		for(uint16_t i = 0; i < 3; i++){
+			results.push_back(modbus.readU16Async(rexos_motor::CRD514KD::Slaves::MOTOR_0, 200 + i, 1, ModbusController::PRIORITY_POLL));
+		}
+		for(uint16_t i = 0; i < 3; i++){
+			results.push_back(modbus.writeU16Async(rexos_motor::CRD514KD::Slaves::MOTOR_0, 300 + i, &value, 1, ModbusController::PRIORITY_NORMAL));
+		}
+		results.push_back(modbus.writeU16Async(rexos_motor::CRD514KD::Slaves::BROADCAST, 400, &value, 1, ModbusController::PRIORITY_MOTION));
+		results.push_back(modbus.writeU16Async(rexos_motor::CRD514KD::Slaves::MOTOR_0, 500, &value, 1, ModbusController::PRIORITY_URGENT));
+
+		{
+			boost::lock_guard<boost::mutex> lock(simulatedBus.mutex);
+			simulatedBus.held = false;
+		}
+		simulatedBus.changed.notify_all();
+		for(unsigned int i = 0; i < results.size(); i++){
+			results[i].wait();
+		}
+
+		std::string order;
+		for(unsigned int i = 0; i < simulatedBus.addresses.size(); i++){
+			order += (i == 0 ? "" : " ") + toString(simulatedBus.addresses[i]);
+		}
+		std::string expectedOrder;
+		for(unsigned int i = 0; i < sizeof(PRIORITY_CHECK_ADDRESSES) / sizeof(PRIORITY_CHECK_ADDRESSES[0]); i++){
+			expectedOrder += (i == 0 ? "" : " ") + toString(PRIORITY_CHECK_ADDRESSES[i]);
+		}
+		return report("priorities", "order", order, expectedOrder);
+	}
+
+	/**
+	 * Runs NUMBER_OF_MOTIONS motions of the three motors of a deltarobot through a MotorManager, with the motors spread over a number of simulated buses.
+	 * With two buses, the first bus has two motors and gets broadcasts, the second bus has one motor and gets unicasts, which have a shorter interval.
+	 *
+	 * @param numberOfBuses The amount of buses the motors are spread over.
+	 * @param startSkew Output parameter, the biggest time in nanoseconds between the START commands of one motion on different buses.
+	 *
+	 * @return The mean time of a motion in nanoseconds.
+	 **/
+	double runMotions(int numberOfBuses, int64_t& startSkew){
+		std::vector<rexos_modbus::ModbusController*> controllers;
+		for(int i = 0; i < numberOfBuses; i++){
+			resetSimulatedBus(simulatedBuses[i]);
+			simulatedBuses[i].transactionTime = TRANSACTION_TIME;
+			controllers.push_back(new rexos_modbus::ModbusController(reinterpret_cast<modbus_t*>(&simulatedBuses[i])));
+		}
+		rexos_motor::StepperMotor* motors[3];
+		for(int i = 0; i < 3; i++){
+			motors[i] = new rexos_motor::StepperMotor(controllers[i * numberOfBuses / 3], (rexos_motor::CRD514KD::Slaves::t)(rexos_motor::CRD514KD::Slaves::MOTOR_0 + i), -1, 1);
+		}
+
+		double duration;
+		{
+			rexos_motor::MotorManager motorManager(motors, 3);
+			motorManager.powerOn();
+			int64_t start = rexos_utilities::monotonicTimeNow();
+			for(int motion = 0; motion < NUMBER_OF_MOTIONS; motion++){
+				for(int i = 0; i < 3; i++){
+					rexos_datatypes::MotorRotation rotation;
+					rotation.angle = 0.1 * (motion % 3 + 1) + 0.01 * i;
+					rotation.speed = 1 + 0.1 * i + 0.01 * motion;
+					rotation.acceleration = 100 + i + motion;
+					rotation.deceleration = 100 + i + motion;
+					motors[i]->writeRotationData(rotation, 1 + motion % 2, true, false);
+				}
+				motorManager.flush();
+				motorManager.startMovementAsync(1 + motion % 2, 0).get();
+			}
+			duration = (double) (rexos_utilities::monotonicTimeNow() - start) / NUMBER_OF_MOTIONS;
+			motorManager.powerOff();
+		}
+
+		startSkew = 0;
+		for(int motion = 0; motion < NUMBER_OF_MOTIONS; motion++){
+			int64_t first = simulatedBuses[0].startTimes[motion];
+			int64_t last = first;
+			for(int i = 1; i < numberOfBuses; i++){
+				first = std::min(first, simulatedBuses[i].startTimes[motion]);
+				last = std::max(last, simulatedBuses[i].startTimes[motion]);
+			}
+			startSkew = std::max(startSkew, last - first);
+		}
+
+		for(int i = 0; i < 3; i++){
+			delete motors[i];
+		}
+		for(int i = 0; i < numberOfBuses; i++){
+			delete controllers[i];
+			simulatedBuses[i].transactionTime = 0;
+		}
+		return duration;
+	}
+
+	/**
+	 * Runs the same motions with the three motors of a deltarobot on one, two and three buses. On a bus each, the motions have to be faster than on one bus, and every motion has to be started on all buses within MAX_START_SKEW.
+	 *
+	 * @return true if the check passed.
+	 **/
+	bool checkMultipleBuses(){
+		double durations[NUMBER_OF_BUSES];
+		int64_t startSkew = 0;
+		for(int i = 0; i < NUMBER_OF_BUSES; i++){
+			int64_t busesStartSkew;
+			durations[i] = runMotions(i + 1, busesStartSkew);
+			startSkew = std::max(startSkew, busesStartSkew);
+		}
+
+		char value[64];
+		char expected[64];
+		snprintf(value, sizeof(value), "%.1f/%.1f/%.1f ms on 1/2/3 buses", durations[0] / 1e6, durations[1] / 1e6, durations[2] / 1e6);
+		bool passed = report("multiple_buses", "motion_time", value, "faster on 3 buses", durations[NUMBER_OF_BUSES - 1] < durations[0]);
+		snprintf(value, sizeof(value), "%.3f ms", startSkew / 1e6);
+		snprintf(expected, sizeof(expected), "< %.3f ms", MAX_START_SKEW / 1e6);
+		passed = report("multiple_buses", "start_skew", value, expected, startSkew < MAX_START_SKEW) && passed;
+		return passed;
+	}
+}
+
+/**
+ * The libmodbus functions used by ModbusController, acting on the simulated bus passed as context instead of a serial port. rexos_modbus links libmodbus dynamically, so these definitions in the executable take precedence over those of libmodbus.
+ **/
+extern "C"{
+	int modbus_connect(modbus_t* context){
+		return 0;
+	}
+
+	void modbus_close(modbus_t* context){
+	}
+
+	void modbus_free(modbus_t* context){
+	}
+
+	int modbus_set_slave(modbus_t* context, int slave){
+		ModbusBusCheckNamespace::SimulatedBus& bus = *reinterpret_cast<ModbusBusCheckNamespace::SimulatedBus*>(context);
+		boost::lock_guard<boost::mutex> lock(bus.mutex);
+		bus.slave = slave;
+		return 0;
+	}
+
+	int modbus_write_register(modbus_t* context, int address, int value){
+		ModbusBusCheckNamespace::SimulatedBus& bus = *reinterpret_cast<ModbusBusCheckNamespace::SimulatedBus*>(context);
+		boost::unique_lock<boost::mutex> lock(bus.mutex);
+		if(address == rexos_motor::CRD514KD::Registers::CMD_1 && (value & rexos_motor::CRD514KD::CMD1Bits::START) != 0){
+			bus.startTimes.push_back(rexos_utilities::monotonicTimeNow());
+		}
+		ModbusBusCheckNamespace::executeTransaction(bus, lock, address);
+		ModbusBusCheckNamespace::writeRegister(bus, address, value);
+		return 1;
+	}
+
+	int modbus_write_registers(modbus_t* context, int address, int length, const uint16_t* data){
+		ModbusBusCheckNamespace::SimulatedBus& bus = *reinterpret_cast<ModbusBusCheckNamespace::SimulatedBus*>(context);
+		boost::unique_lock<boost::mutex> lock(bus.mutex);
+		ModbusBusCheckNamespace::executeTransaction(bus, lock, address);
+		for(int i = 0; i < length; i++){
+			ModbusBusCheckNamespace::writeRegister(bus, address + i, data[i]);
+		}
+		return length;
+	}
+
+	/**
+	 * Every read register of the simulated motor controllers holds a ready status.
+	 **/
+	int modbus_read_registers(modbus_t* context, int address, int length, uint16_t* data){
+		ModbusBusCheckNamespace::SimulatedBus& bus = *reinterpret_cast<ModbusBusCheckNamespace::SimulatedBus*>(context);
+		boost::unique_lock<boost::mutex> lock(bus.mutex);
+		ModbusBusCheckNamespace::executeTransaction(bus, lock, address);
+		for(int i = 0; i < length; i++){
+			data[i] = rexos_motor::CRD514KD::Status1Bits::READY;
+		}
+		return length;
+	}
+
+	void modbus_get_byte_timeout(modbus_t* context, struct timeval* timeout){
+	}
+
+	void modbus_set_byte_timeout(modbus_t* context, const struct timeval* timeout){
+	}
+
+	void modbus_get_response_timeout(modbus_t* context, struct timeval* timeout){
+	}
+
+	void modbus_set_response_timeout(modbus_t* context, const struct timeval* timeout){
+	}
+
+	const char* modbus_strerror(int errnum){
+		return "simulated bus error";
+	}
+}
+
+/**
+ * Runs all checks on the simulated bus.
+ *
+ * @param argc Argument count.
+ * @param argv Argument values, none are used.
+ *
+ * @return 0 if all checks passed, 1 otherwise.
+ **/
+int main(int argc, char** argv){
+	using namespace ModbusBusCheckNamespace;
+	bool passed = true;
+	try{
+		printf("%-20s %-24s %-40s %-40s %s\n", "check", "metric", "value", "expected", "result");
+		passed = checkPowerOn() && passed;
+		passed = checkPriorities() && passed;
+		passed = checkMultipleBuses() && passed;
+	} catch(std::exception& exception){
+		fprintf(stderr, "%s\n", exception.what());
+		passed = false;
+	}
+	return passed ? 0 : 1;
+}